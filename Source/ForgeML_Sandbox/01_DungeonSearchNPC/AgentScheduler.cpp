@@ -0,0 +1,111 @@
+#include "AgentScheduler.h"
+
+FAgentTask::~FAgentTask()
+{
+	if (mHandle)
+		mHandle.destroy();
+}
+
+FAgentTask::FAgentTask(FAgentTask&& other) noexcept
+	: mHandle(std::exchange(other.mHandle, nullptr))
+{
+}
+
+FAgentTask& FAgentTask::operator=(FAgentTask&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (mHandle)
+			mHandle.destroy();
+
+		mHandle = std::exchange(other.mHandle, nullptr);
+	}
+	return *this;
+}
+
+FAgentScheduler::FAgentScheduler(const FBatchActionSelector& actionSelector,
+								 int32 seed)
+	: mActionSelector(actionSelector),
+	mRandom(seed)
+{
+}
+
+FAgentScheduler::~FAgentScheduler()
+{
+	// The inference task writes into the in-flight batch, the coroutine frames are destroyed with the tasks.
+	if (mInFlight.mTask)
+		mInFlight.mTask->Wait();
+}
+
+void FAgentScheduler::Spawn(UObject* owner,
+							FAgentTask task)
+{
+	const FAgentTask::FHandle handle = task.GetHandle();
+	if (!handle)
+		return;
+
+	handle.promise().mOwner = owner;
+	mWaitingForFrame.push_back(handle);
+
+	mTasks.emplace_back(std::move(task));
+}
+
+void FAgentScheduler::Tick(float deltaTime_s)
+{
+	mDeltaTime_s = deltaTime_s;
+
+	// Agents suspending while resumed below wait for the following tick.
+	mResuming.swap(mWaitingForFrame);
+	mWaitingForFrame.clear();
+
+	if (mBatchInFlight && mInFlight.mTask->IsComplete())
+	{
+		for (size_t i = 0; i < mInFlight.mAgents.size(); ++i)
+		{
+			if (i < mInFlight.mActions.size())
+				*mInFlight.mResults[i] = mInFlight.mActions[i];
+
+			mResuming.push_back(mInFlight.mAgents[i]);
+		}
+
+		mInFlight.mAgents.clear();
+		mInFlight.mResults.clear();
+		mInFlight.mTask = nullptr;
+		mBatchInFlight = false;
+	}
+
+	for (FAgentTask::FHandle handle : mResuming)
+	{
+		if (!handle.done() && handle.promise().mOwner.IsValid())
+			handle.resume();
+	}
+	mResuming.clear();
+
+	if (mBatchInFlight || mGathering.mAgents.empty())
+		return;
+
+	// One batch is in flight at a time, decisions requested meanwhile gather into the next.
+	std::swap(mGathering, mInFlight);
+	mGathering.mStates.clear();
+
+	mNumBatches++;
+	mNumDecisions += mInFlight.mAgents.size();
+	mBatchInFlight = true;
+
+	mInFlight.mTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]()
+	{
+		mActionSelector(mInFlight.mStates, static_cast<int32>(mInFlight.mAgents.size()), mRandom, mInFlight.mActions);
+
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void FAgentScheduler::QueueDecision(FAgentTask::FHandle handle,
+									TArrayView<const float> state,
+									std::tuple<EMoveDirection, float>* outAction)
+{
+	check(state.Num() >= StateSize);
+
+	mGathering.mAgents.push_back(handle);
+	mGathering.mResults.push_back(outAction);
+	mGathering.mStates.insert(mGathering.mStates.end(), state.begin(), state.begin() + StateSize);
+}
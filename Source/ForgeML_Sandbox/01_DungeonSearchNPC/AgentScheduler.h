@@ -0,0 +1,201 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+#include "NPCDefines.h"
+#include "RolloutWorker.h"
+
+#include <coroutine>
+#include <tuple>
+#include <vector>
+
+
+/// <summary>
+/// A coroutine running an agent's behaviour. It starts suspended and is
+/// resumed by the FAgentScheduler it was spawned on.
+/// </summary>
+class FAgentTask
+{
+public:
+	struct promise_type
+	{
+		// Agents whose owner was destroyed are no longer resumed.
+		TWeakObjectPtr<UObject> mOwner;
+
+		FAgentTask get_return_object() { return FAgentTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { checkNoEntry(); }
+	};
+
+	using FHandle = std::coroutine_handle<promise_type>;
+public:
+	/// <summary>
+	/// Constructor initializing an empty FAgentTask instance.
+	/// </summary>
+	FAgentTask() = default;
+
+	/// <summary>
+	/// Constructor taking ownership of a coroutine.
+	/// </summary>
+	/// <param name="handle">The coroutine handle</param>
+	explicit FAgentTask(FHandle handle) : mHandle(handle) {}
+
+	/// <summary>
+	/// Destructor destroying the coroutine frame.
+	/// </summary>
+	~FAgentTask();
+
+	FAgentTask(FAgentTask&& other) noexcept;
+	FAgentTask& operator=(FAgentTask&& other) noexcept;
+
+	FAgentTask(const FAgentTask&) = delete;
+	FAgentTask& operator=(const FAgentTask&) = delete;
+public:
+	/// <summary>
+	/// Retrieves the coroutine handle.
+	/// </summary>
+	/// <returns>The handle, null for an empty task</returns>
+	inline FHandle GetHandle() const { return mHandle; }
+private:
+	FHandle mHandle = nullptr;
+};
+
+
+/// <summary>
+/// Drives agent coroutines from the game thread. Agents suspend until the next frame
+/// or until their decision has been made, decisions requested in the same frames are
+/// batched into a single inference run on a background task. Suspended agents cost
+/// their coroutine frame only, no thread.
+/// </summary>
+class FAgentScheduler
+{
+public:
+	/// <summary>
+	/// Awaits the next scheduler tick, resuming with the frame's delta time.
+	/// </summary>
+	struct FFrameAwaiter
+	{
+		FAgentScheduler& mScheduler;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(FAgentTask::FHandle handle) { mScheduler.mWaitingForFrame.push_back(handle); }
+		float await_resume() const noexcept { return mScheduler.mDeltaTime_s; }
+	};
+
+	/// <summary>
+	/// Awaits the batched decision of a state, resuming with the selected action.
+	/// </summary>
+	struct FDecisionAwaiter
+	{
+		FAgentScheduler& mScheduler;
+		TArrayView<const float> mState;
+		std::tuple<EMoveDirection, float> mAction { EMoveDirection::None, 0.0f };
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(FAgentTask::FHandle handle) { mScheduler.QueueDecision(handle, mState, &mAction); }
+		std::tuple<EMoveDirection, float> await_resume() const noexcept { return mAction; }
+	};
+public:
+	/// <summary>
+	/// Constructor initializing a FAgentScheduler instance.
+	/// </summary>
+	/// <param name="actionSelector">The batched policy callback, run on a background task</param>
+	/// <param name="seed">The seed of the random stream passed to the policy</param>
+	FAgentScheduler(const FBatchActionSelector& actionSelector,
+					int32 seed);
+
+	/// <summary>
+	/// Destructor waiting for the in-flight inference and destroying the agent coroutines.
+	/// </summary>
+	~FAgentScheduler();
+public:
+	/// <summary>
+	/// Takes ownership of an agent coroutine and starts it on the next tick.
+	/// </summary>
+	/// <param name="owner">The object the coroutine runs on</param>
+	/// <param name="task">The agent coroutine</param>
+	void Spawn(UObject* owner,
+			   FAgentTask task);
+
+	/// <summary>
+	/// Resumes the agents awaiting this frame or a completed decision batch and
+	/// dispatches the decisions gathered since the last batch.
+	/// </summary>
+	/// <param name="deltaTime_s">The frame's delta time</param>
+	void Tick(float deltaTime_s);
+
+	/// <summary>
+	/// Suspends the awaiting agent until the next tick.
+	/// </summary>
+	/// <returns>The awaiter</returns>
+	inline FFrameAwaiter NextFrame() { return { *this }; }
+
+	/// <summary>
+	/// Suspends the awaiting agent until its state has been decided on.
+	/// </summary>
+	/// <param name="state">The state input, StateSize floats, copied when the agent suspends</param>
+	/// <returns>The awaiter</returns>
+	inline FDecisionAwaiter Decide(TArrayView<const float> state) { return { *this, state }; }
+public:
+	/// <summary>
+	/// Retrieves the number of agent coroutines.
+	/// </summary>
+	/// <returns>The number of agents</returns>
+	inline int32 GetNumAgents() const { return static_cast<int32>(mTasks.size()); }
+
+	/// <summary>
+	/// Retrieves the number of agents suspended on a decision.
+	/// </summary>
+	/// <returns>The number of agents</returns>
+	inline int32 GetNumAwaitingDecision() const { return static_cast<int32>(mGathering.mAgents.size() + mInFlight.mAgents.size()); }
+
+	/// <summary>
+	/// Retrieves the mean number of decisions per inference batch.
+	/// </summary>
+	/// <returns>The mean batch size</returns>
+	inline double GetMeanBatchSize() const { return mNumBatches > 0 ? static_cast<double>(mNumDecisions) / mNumBatches : 0.0; }
+private:
+	/// <summary>
+	/// The decisions of one inference run.
+	/// </summary>
+	struct FDecisionBatch
+	{
+		std::vector<FAgentTask::FHandle> mAgents;
+		std::vector<std::tuple<EMoveDirection, float>*> mResults;
+		std::vector<float> mStates;
+		std::vector<std::tuple<EMoveDirection, float>> mActions;
+
+		FGraphEventRef mTask;
+	};
+
+	/// <summary>
+	/// Adds a suspended agent's decision to the gathering batch.
+	/// </summary>
+	/// <param name="handle">The suspended agent</param>
+	/// <param name="state">The state input</param>
+	/// <param name="outAction">The awaiter's action, written before the agent is resumed</param>
+	void QueueDecision(FAgentTask::FHandle handle,
+					   TArrayView<const float> state,
+					   std::tuple<EMoveDirection, float>* outAction);
+private:
+	FBatchActionSelector mActionSelector;
+	FRandomStream mRandom;
+
+	std::vector<FAgentTask> mTasks;
+
+	std::vector<FAgentTask::FHandle> mWaitingForFrame;
+	std::vector<FAgentTask::FHandle> mResuming;
+
+	FDecisionBatch mGathering;
+	FDecisionBatch mInFlight;
+	bool mBatchInFlight = false;
+
+	float mDeltaTime_s = 0;
+
+	uint64 mNumBatches = 0;
+	uint64 mNumDecisions = 0;
+};
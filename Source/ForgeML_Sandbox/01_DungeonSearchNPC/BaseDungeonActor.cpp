@@ -3,6 +3,8 @@
 #include "Components/CapsuleComponent.h"
 #include "Components/StaticMeshComponent.h"
 
+#include "HeadlessDungeon.h"
+
 ABaseDungeonActor::ABaseDungeonActor()
 {
 	PrimaryActorTick.bCanEverTick = true;
@@ -43,7 +45,35 @@ void ABaseDungeonActor::ResetActor(const FVector& location)
 	SetActorLocation(location);
 	SetActorRotation(FRotator::ZeroRotator);
 
-	mVisitedCoins.clear();
+	mVisitedCoins.Init(false, mVisitedCoins.Num());
+}
+
+void ABaseDungeonActor::SetCoinRegistry(std::shared_ptr<const FDungeonCoinRegistry> registry)
+{
+	mpCoinRegistry = std::move(registry);
+	mVisitedCoins.Init(false, mpCoinRegistry ? mpCoinRegistry->mCoins.Num() : 0);
+}
+
+void ABaseDungeonActor::SetOverlapDetectionEnabled(bool enabled)
+{
+	if (mpCollisionComponent)
+		mpCollisionComponent->SetGenerateOverlapEvents(enabled);
+}
+
+void ABaseDungeonActor::SetKinematicLayout(std::shared_ptr<const FDungeonLayout> layout)
+{
+	mpKinematicLayout = std::move(layout);
+	mKinematicRadius_cm = mpCollisionComponent ? mpCollisionComponent->GetScaledCapsuleRadius() : 0.0f;
+}
+
+bool ABaseDungeonActor::TryCollectCoin(int32 coinId)
+{
+	if (!mVisitedCoins.IsValidIndex(coinId) || mVisitedCoins[coinId])
+		return false;
+
+	mVisitedCoins[coinId] = true;
+	OnFoundCoin();
+	return true;
 }
 
 void ABaseDungeonActor::MoveInDirection(EMoveDirection direction, 
@@ -68,6 +98,21 @@ void ABaseDungeonActor::MoveInDirection(EMoveDirection direction,
 		return; // No movement for None
 	}
 
+	const FScopedStageTimer timer(mpStageTimings, EPerformanceStage::Movement);
+
+	if (mpKinematicLayout)
+	{
+		// Resolved against the occupancy grid, the transform is teleported without sweeping.
+		SetActorLocation(mpKinematicLayout->Sweep(GetActorLocation(),
+												  MovementVector * mMoveSpeed * deltaTime,
+												  mKinematicRadius_cm,
+												  EDungeonCell::Wall),
+						 false,
+						 nullptr,
+						 ETeleportType::TeleportPhysics);
+		return;
+	}
+
 	// Attempt move
 	FHitResult Hit;
 	AddActorWorldOffset(MovementVector * mMoveSpeed * deltaTime, true, &Hit);
@@ -89,10 +134,10 @@ void ABaseDungeonActor::OnBeginOverlap(UPrimitiveComponent* OverlappedComp,
 		if (OtherActor->ActorHasTag("Treasure"))
 			OnFoundTreasure();
 
-		if (OtherActor->ActorHasTag("Coin") && !mVisitedCoins.contains(OtherActor))
+		if (OtherActor->ActorHasTag("Coin") && mpCoinRegistry)
 		{
-			mVisitedCoins.insert(OtherActor);
-			OnFoundCoin();
+			if (const int32* coinId = mpCoinRegistry->mIds.Find(OtherActor))
+				TryCollectCoin(*coinId);
 		}
 	}
 
@@ -105,10 +150,10 @@ void ABaseDungeonActor::OnBeginOverlap(UPrimitiveComponent* OverlappedComp,
 		if (OtherComp->ComponentHasTag("Treasure"))
 			OnFoundTreasure();
 
-		if (OtherComp->ComponentHasTag("Coin") && !mVisitedCoins.contains(OtherComp->GetOwner()))
+		if (OtherComp->ComponentHasTag("Coin") && mpCoinRegistry)
 		{
-			mVisitedCoins.insert(OtherComp->GetOwner());
-			OnFoundCoin();
+			if (const int32* coinId = mpCoinRegistry->mIds.Find(OtherComp->GetOwner()))
+				TryCollectCoin(*coinId);
 		}
 	}
 }
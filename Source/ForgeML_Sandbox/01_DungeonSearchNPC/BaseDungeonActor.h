@@ -3,12 +3,28 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 
+#include "Math/RandomStream.h"
+
 #include "NPCDefines.h"
+#include "StageTimings.h"
 
-#include <unordered_set>
+#include <memory>
 
 #include "BaseDungeonActor.generated.h"
 
+struct FDungeonLayout;
+
+/// <summary>
+/// The coins of a scenario, identified by dense integer ids.
+/// </summary>
+struct FDungeonCoinRegistry
+{
+	TArray<AActor*> mCoins;
+	TArray<FVector> mLocations;
+	TArray<float> mRadii;
+
+	TMap<const AActor*, int32> mIds;
+};
 
 /// <summary>
 /// Abstract base class for dungeon actors.
@@ -17,6 +33,9 @@ UCLASS(Abstract)
 class ABaseDungeonActor : public AActor
 {
 	GENERATED_BODY()
+
+	// Times both movement modes by driving MoveInDirection directly.
+	friend class AScenarioManagerActor;
 public:
 	/// <summary>
 	/// Constructor initializing a ABaseDungeonActor instance.
@@ -53,6 +72,56 @@ public:
 	/// Overridable native event called when the actor dies.
 	/// </summary>
 	virtual void OnDeath() { }
+public:
+	/// <summary>
+	/// Sets the coin registry used to track the visited coins.
+	/// </summary>
+	/// <param name="registry">The coin registry</param>
+	void SetCoinRegistry(std::shared_ptr<const FDungeonCoinRegistry> registry);
+
+	/// <summary>
+	/// Enables or disables the per-actor overlap callbacks, used
+	/// when contacts are detected by the scenario manager instead.
+	/// </summary>
+	/// <param name="enabled">Whether overlap detection is enabled</param>
+	void SetOverlapDetectionEnabled(bool enabled);
+
+	/// <summary>
+	/// Sets the occupancy layout the movement is resolved against. With a layout the
+	/// actor moves kinematically without per-tick physics sweeps, null restores the
+	/// swept movement.
+	/// </summary>
+	/// <param name="layout">The dungeon layout</param>
+	void SetKinematicLayout(std::shared_ptr<const FDungeonLayout> layout);
+
+	/// <summary>
+	/// Seeds the actor's own random stream, so its behaviour does not depend on other actors.
+	/// </summary>
+	/// <param name="seed">The seed</param>
+	inline void SetRandomSeed(int32 seed) { mRandom.Initialize(seed); }
+
+	/// <summary>
+	/// Sets the timings the actor's movement and perception are measured into.
+	/// </summary>
+	/// <param name="pTimings">The stage timings, null to disable the measurements</param>
+	inline void SetStageTimings(FStageTimings* pTimings) { mpStageTimings = pTimings; }
+
+	/// <summary>
+	/// Collects a coin if it has not been visited yet.
+	/// </summary>
+	/// <param name="coinId">The coin id</param>
+	/// <returns>True if the coin was collected</returns>
+	bool TryCollectCoin(int32 coinId);
+
+	/// <summary>
+	/// Checks whether the actor has visited a coin.
+	/// </summary>
+	/// <param name="coinId">The coin id</param>
+	/// <returns>True if visited</returns>
+	inline bool HasVisitedCoin(int32 coinId) const
+	{
+		return mVisitedCoins.IsValidIndex(coinId) && mVisitedCoins[coinId];
+	}
 protected:
 	/// <summary>
 	/// Moves the actor in a specified direction based on the DeltaTime.
@@ -93,7 +162,14 @@ public:
 protected:
 	float mTime_s = 0;
 
-	std::unordered_set<AActor*> mVisitedCoins;
+	std::shared_ptr<const FDungeonCoinRegistry> mpCoinRegistry = nullptr;
+	TBitArray<> mVisitedCoins;
+
+	std::shared_ptr<const FDungeonLayout> mpKinematicLayout = nullptr;
+	float mKinematicRadius_cm = 0;
+
+	FRandomStream mRandom;
+	FStageTimings* mpStageTimings = nullptr;
 };
 
 
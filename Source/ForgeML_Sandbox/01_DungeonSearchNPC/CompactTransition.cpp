@@ -0,0 +1,85 @@
+#include "CompactTransition.h"
+
+#include <algorithm>
+
+static const uint64 HitTypeMask = (1ull << HitTypeBits) - 1;
+
+void EncodeState(const TrainingStateInfo& state,
+				 FCompactState& outState)
+{
+	uint64 packedTypes = 0;
+	for (int32 i = 0; i < NumRayCasts; ++i)
+	{
+		const float distance = FMath::Clamp(state.mRayCollisionDistances[i], 0.0f, 1.0f);
+		outState.mRayCollisionDistances[i] = static_cast<uint8>(FMath::RoundToInt(distance * MAX_uint8));
+
+		const uint64 type = static_cast<uint64>(FMath::Clamp(FMath::RoundToInt(state.mRayCollisionHitTypes[i]), 0, static_cast<int32>(HitTypeMask)));
+		packedTypes |= type << (i * HitTypeBits);
+	}
+
+	for (int32 byte = 0; byte < PackedHitTypeBytes; ++byte)
+		outState.mRayCollisionHitTypes[byte] = static_cast<uint8>(packedTypes >> (byte * 8));
+
+	// Distances beyond the half precision range saturate.
+	outState.mTreasureDistance = FFloat16(FMath::Min(state.mTreasureDistance, 65504.0f));
+}
+
+FCompactTransition EncodeTransition(const TrainingInfo& info)
+{
+	FCompactTransition transition;
+	EncodeState(info.mState, transition.mState);
+
+	if (!info.IsTerminal() && info.mReturnSteps > 0)
+		EncodeState(info.mNextState, transition.mNextState);
+
+	transition.mDirection_f = info.mDirection_f;
+	transition.mReward = info.mReward;
+	transition.mObservationLag_s = FFloat16(info.mObservationLag_s);
+	transition.mDirection = info.mDirection;
+	transition.mEvent = info.mEvent;
+	transition.mReturnSteps = info.mReturnSteps;
+	return transition;
+}
+
+void DecodeStateInputs(const FCompactState& state,
+					   float* outInputs)
+{
+	uint64 packedTypes = 0;
+	for (int32 byte = 0; byte < PackedHitTypeBytes; ++byte)
+		packedTypes |= static_cast<uint64>(state.mRayCollisionHitTypes[byte]) << (byte * 8);
+
+	const float distanceScale = 1.0f / MAX_uint8;
+	for (int32 i = 0; i < NumRayCasts; ++i)
+	{
+		outInputs[i * 2] = state.mRayCollisionDistances[i] * distanceScale;
+		outInputs[i * 2 + 1] = static_cast<float>((packedTypes >> (i * HitTypeBits)) & HitTypeMask);
+	}
+
+	outInputs[NumRayCasts * 2] = state.mTreasureDistance.GetFloat();
+}
+
+void WriteActionValueTargets(const std::vector<FCompactTransition>& trainingData,
+							 const std::vector<size_t>& bootstrapIndices,
+							 const std::vector<float>& nextValues,
+							 float gamma,
+							 std::vector<float>& outTargets)
+{
+	const size_t numActions = static_cast<size_t>(EMoveDirection::COUNT);
+
+	std::vector<float> bootstrap(trainingData.size(), 0.0f);
+	for (size_t i = 0; i < bootstrapIndices.size(); ++i)
+	{
+		const float* values = nextValues.data() + i * numActions;
+		const FCompactTransition& info = trainingData[bootstrapIndices[i]];
+
+		// n-step returns bootstrap with the discount of the rewards they already contain.
+		const float discount = FMath::Pow(gamma, static_cast<float>(info.mReturnSteps));
+		bootstrap[bootstrapIndices[i]] = discount * *std::max_element(values, values + numActions);
+	}
+
+	for (size_t i = 0; i < trainingData.size(); ++i)
+	{
+		const FCompactTransition& info = trainingData[i];
+		outTargets[i * numActions + static_cast<size_t>(info.mDirection)] = info.mReward + bootstrap[i];
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/Float16.h"
+
+#include "NPCDefines.h"
+
+#include <array>
+#include <vector>
+
+// Hit types are small integers in [0, 4], stored as 3-bit codes.
+const int32_t HitTypeBits = 3;
+const int32_t PackedHitTypeBytes = (NumRayCasts * HitTypeBits + 7) / 8;
+
+static_assert(NumRayCasts * HitTypeBits <= 64, "Packed hit types are encoded through a 64-bit word.");
+
+
+/// <summary>
+/// Compact replay encoding of a training state: unsigned normalized 8-bit ray
+/// distances, 3-bit packed ray hit types and a half precision treasure distance.
+/// </summary>
+struct FCompactState
+{
+	std::array<uint8, NumRayCasts> mRayCollisionDistances {};
+	std::array<uint8, PackedHitTypeBytes> mRayCollisionHitTypes {};
+	FFloat16 mTreasureDistance;
+};
+
+
+/// <summary>
+/// Compact replay encoding of a TrainingInfo transition.
+/// </summary>
+struct FCompactTransition
+{
+	FCompactState mState;
+	FCompactState mNextState;
+
+	float mDirection_f = 0;
+	float mReward = 0;
+	FFloat16 mObservationLag_s;
+
+	EMoveDirection mDirection = EMoveDirection::None;
+	ETransitionEvent mEvent = ETransitionEvent::Decision;
+	uint8 mReturnSteps = 1;
+
+	inline bool IsTerminal() const
+	{
+		return mEvent == ETransitionEvent::FoundTreasure || mEvent == ETransitionEvent::Death;
+	}
+
+	/// <summary>
+	/// Checks whether the return is completed with the value of the next state, which
+	/// terminal transitions and returns running to the end of their episode are not.
+	/// </summary>
+	/// <returns>True if bootstrapped</returns>
+	inline bool BootstrapsFromNextState() const
+	{
+		return !IsTerminal() && mReturnSteps > 0;
+	}
+};
+
+
+/// <summary>
+/// Encodes a state into its compact replay form.
+/// </summary>
+/// <param name="state">The state</param>
+/// <param name="outState">The encoded state</param>
+void EncodeState(const TrainingStateInfo& state,
+				 FCompactState& outState);
+
+/// <summary>
+/// Encodes a transition into its compact replay form.
+/// </summary>
+/// <param name="info">The transition</param>
+/// <returns>The encoded transition</returns>
+FCompactTransition EncodeTransition(const TrainingInfo& info);
+
+/// <summary>
+/// Decodes a compact state directly into the flattened model input layout.
+/// </summary>
+/// <param name="state">The encoded state</param>
+/// <param name="outInputs">The output inputs, StateSize floats are written</param>
+void DecodeStateInputs(const FCompactState& state,
+					   float* outInputs);
+
+/// <summary>
+/// Writes the n-step action value target r + gamma^n * max Q(s') of every transition into the
+/// slot of its taken action, the other actions keep the estimates the targets start out with.
+/// </summary>
+/// <param name="trainingData">The transitions, each reward already holding its n-step return</param>
+/// <param name="bootstrapIndices">The transitions that bootstrap from their next state, in order</param>
+/// <param name="nextValues">The next state action values of the bootstrapped transitions</param>
+/// <param name="gamma">The discount factor</param>
+/// <param name="outTargets">The per-action targets, the current estimates on entry</param>
+void WriteActionValueTargets(const std::vector<FCompactTransition>& trainingData,
+							 const std::vector<size_t>& bootstrapIndices,
+							 const std::vector<float>& nextValues,
+							 float gamma,
+							 std::vector<float>& outTargets);
+
+/// <summary>
+/// Appends the flattened model input of a compact state.
+/// </summary>
+/// <param name="state">The encoded state</param>
+/// <param name="outInputs">The output inputs, StateSize floats are appended</param>
+inline void AppendStateInputs(const FCompactState& state,
+							  std::vector<float>& outInputs)
+{
+	const size_t offset = outInputs.size();
+	outInputs.resize(offset + StateSize);
+	DecodeStateInputs(state, outInputs.data() + offset);
+}
@@ -0,0 +1,147 @@
+#include "DecisionRecording.h"
+
+#include "Misc/FileHelper.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+static const uint32 DecisionRecordingMagic = 0x44524543;
+static const uint32 DecisionRecordingVersion = 1;
+
+FDecisionRecording::FDecisionRecording(int32 seed,
+									   float fixedStep_s)
+	: mSeed(seed),
+	mFixedStep_s(fixedStep_s)
+{
+}
+
+std::unique_ptr<FDecisionRecording> FDecisionRecording::Load(const FString& path)
+{
+	TArray<uint8> data;
+	if (!FFileHelper::LoadFileToArray(data, *path))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Read Decision Recording %s!"), *path);
+		return nullptr;
+	}
+
+	FMemoryReader reader(data);
+
+	uint32 magic = 0;
+	uint32 version = 0;
+	reader << magic << version;
+	if (magic != DecisionRecordingMagic || version != DecisionRecordingVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid Decision Recording %s!"), *path);
+		return nullptr;
+	}
+
+	int32 seed = 0;
+	float fixedStep_s = 0;
+	reader << seed << fixedStep_s;
+
+	std::unique_ptr<FDecisionRecording> recording = std::make_unique<FDecisionRecording>(seed, fixedStep_s);
+	reader << recording->mTreasureLocation;
+	reader << recording->mSpawnLocations;
+
+	int32 numAgents = 0;
+	reader << numAgents;
+	recording->mDecisions.resize(FMath::Max(0, numAgents));
+
+	for (std::vector<FRecordedDecision>& decisions : recording->mDecisions)
+	{
+		int32 numDecisions = 0;
+		reader << numDecisions;
+		if (reader.IsError() || numDecisions < 0)
+			break;
+
+		decisions.resize(numDecisions);
+		for (FRecordedDecision& decision : decisions)
+		{
+			uint8 direction = 0;
+			reader << direction << decision.mDirection_f;
+			decision.mDirection = static_cast<EMoveDirection>(direction);
+		}
+	}
+
+	if (reader.IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Truncated Decision Recording %s!"), *path);
+		return nullptr;
+	}
+
+	recording->mReplayPositions.assign(recording->mDecisions.size(), 0);
+	return recording;
+}
+
+bool FDecisionRecording::Save(const FString& path) const
+{
+	FBufferArchive writer;
+
+	uint32 magic = DecisionRecordingMagic;
+	uint32 version = DecisionRecordingVersion;
+	int32 seed = mSeed;
+	float fixedStep_s = mFixedStep_s;
+	FVector treasureLocation = mTreasureLocation;
+	TArray<FVector> spawnLocations = mSpawnLocations;
+	writer << magic << version << seed << fixedStep_s << treasureLocation << spawnLocations;
+
+	int32 numAgents = static_cast<int32>(mDecisions.size());
+	writer << numAgents;
+
+	for (const std::vector<FRecordedDecision>& decisions : mDecisions)
+	{
+		int32 numDecisions = static_cast<int32>(decisions.size());
+		writer << numDecisions;
+
+		for (const FRecordedDecision& decision : decisions)
+		{
+			uint8 direction = static_cast<uint8>(decision.mDirection);
+			float direction_f = decision.mDirection_f;
+			writer << direction << direction_f;
+		}
+	}
+
+	if (!FFileHelper::SaveArrayToFile(writer, *path))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Write Decision Recording %s!"), *path);
+		return false;
+	}
+	return true;
+}
+
+void FDecisionRecording::AddDecision(int32 agentId,
+									 EMoveDirection direction,
+									 float direction_f)
+{
+	if (agentId < 0)
+		return;
+
+	if (static_cast<size_t>(agentId) >= mDecisions.size())
+		mDecisions.resize(agentId + 1);
+
+	mDecisions[agentId].push_back({ direction, direction_f });
+}
+
+bool FDecisionRecording::NextDecision(int32 agentId,
+									  EMoveDirection& outDirection,
+									  float& outDirection_f)
+{
+	if (agentId < 0 || static_cast<size_t>(agentId) >= mDecisions.size())
+		return false;
+
+	size_t& position = mReplayPositions[agentId];
+	if (position >= mDecisions[agentId].size())
+		return false;
+
+	const FRecordedDecision& decision = mDecisions[agentId][position++];
+	outDirection = decision.mDirection;
+	outDirection_f = decision.mDirection_f;
+	return true;
+}
+
+int64 FDecisionRecording::GetNumDecisions() const
+{
+	int64 numDecisions = 0;
+	for (const std::vector<FRecordedDecision>& decisions : mDecisions)
+		numDecisions += decisions.size();
+	return numDecisions;
+}
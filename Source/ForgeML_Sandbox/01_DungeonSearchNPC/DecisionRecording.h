@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NPCDefines.h"
+
+#include <memory>
+#include <vector>
+
+
+/// <summary>
+/// A recorded run of the learning NPCs: the scenario seed and fixed time step, the
+/// initial treasure and spawn locations and every agent's decisions in order. Replaying
+/// it with the same seed and time step drives the agents through identical episodes.
+/// Decisions are recorded per agent id, so only the game thread decision path is covered.
+/// </summary>
+class FDecisionRecording
+{
+public:
+	/// <summary>
+	/// Constructor initializing an empty recording.
+	/// </summary>
+	/// <param name="seed">The scenario random seed</param>
+	/// <param name="fixedStep_s">The fixed time step, 0 if the run was not fixed step</param>
+	FDecisionRecording(int32 seed,
+					   float fixedStep_s);
+
+	/// <summary>
+	/// Loads a recording.
+	/// </summary>
+	/// <param name="path">The recording file</param>
+	/// <returns>The recording, null if it could not be read</returns>
+	static std::unique_ptr<FDecisionRecording> Load(const FString& path);
+
+	/// <summary>
+	/// Writes the recording.
+	/// </summary>
+	/// <param name="path">The recording file</param>
+	/// <returns>True if written</returns>
+	bool Save(const FString& path) const;
+public:
+	/// <summary>
+	/// Records the treasure location of the scenario.
+	/// </summary>
+	/// <param name="location">The treasure location</param>
+	inline void SetTreasureLocation(const FVector& location) { mTreasureLocation = location; }
+
+	/// <summary>
+	/// Records the spawn location of the next spawned agent.
+	/// </summary>
+	/// <param name="location">The spawn location</param>
+	inline void AddSpawn(const FVector& location) { mSpawnLocations.Add(location); }
+
+	/// <summary>
+	/// Appends a decision to an agent's recorded decisions.
+	/// </summary>
+	/// <param name="agentId">The agent id</param>
+	/// <param name="direction">The decided direction</param>
+	/// <param name="direction_f">The raw action value</param>
+	void AddDecision(int32 agentId,
+					 EMoveDirection direction,
+					 float direction_f);
+
+	/// <summary>
+	/// Reads an agent's next recorded decision.
+	/// </summary>
+	/// <param name="agentId">The agent id</param>
+	/// <param name="outDirection">The recorded direction</param>
+	/// <param name="outDirection_f">The recorded raw action value</param>
+	/// <returns>False if the agent has no decisions left</returns>
+	bool NextDecision(int32 agentId,
+					  EMoveDirection& outDirection,
+					  float& outDirection_f);
+public:
+	/// <summary>
+	/// Retrieves the scenario random seed.
+	/// </summary>
+	/// <returns>The seed</returns>
+	inline int32 GetSeed() const { return mSeed; }
+
+	/// <summary>
+	/// Retrieves the fixed time step of the recorded run.
+	/// </summary>
+	/// <returns>The time step, 0 if the run was not fixed step</returns>
+	inline float GetFixedStep_s() const { return mFixedStep_s; }
+
+	/// <summary>
+	/// Retrieves the recorded treasure location.
+	/// </summary>
+	/// <returns>The treasure location</returns>
+	inline const FVector& GetTreasureLocation() const { return mTreasureLocation; }
+
+	/// <summary>
+	/// Retrieves the recorded spawn locations in spawn order.
+	/// </summary>
+	/// <returns>The spawn locations</returns>
+	inline const TArray<FVector>& GetSpawnLocations() const { return mSpawnLocations; }
+
+	/// <summary>
+	/// Retrieves the number of recorded decisions across all agents.
+	/// </summary>
+	/// <returns>The number of decisions</returns>
+	int64 GetNumDecisions() const;
+private:
+	/// <summary>
+	/// A single recorded decision.
+	/// </summary>
+	struct FRecordedDecision
+	{
+		EMoveDirection mDirection = EMoveDirection::None;
+		float mDirection_f = 0;
+	};
+private:
+	int32 mSeed = 0;
+	float mFixedStep_s = 0;
+
+	FVector mTreasureLocation = FVector::ZeroVector;
+	TArray<FVector> mSpawnLocations;
+
+	// Indexed by agent id, with the replay position of each agent.
+	std::vector<std::vector<FRecordedDecision>> mDecisions;
+	std::vector<size_t> mReplayPositions;
+};
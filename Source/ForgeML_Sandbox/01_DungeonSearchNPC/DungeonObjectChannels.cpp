@@ -0,0 +1,33 @@
+#include "DungeonObjectChannels.h"
+
+#include "Components/PrimitiveComponent.h"
+
+#include "NPCDefines.h"
+
+void AssignDungeonObjectChannel(UPrimitiveComponent* component)
+{
+	if (component->ComponentHasTag("Treasure"))
+		component->SetCollisionObjectType(ECC_DungeonTreasure);
+	else if (component->ComponentHasTag("Coin"))
+		component->SetCollisionObjectType(ECC_DungeonCoin);
+	else if (component->ComponentHasTag("Hazard"))
+		component->SetCollisionObjectType(ECC_DungeonHazard);
+}
+
+float GetDungeonObjectHitType(const UPrimitiveComponent* component)
+{
+	if (!component)
+		return RayHitType::Wall;
+
+	switch (component->GetCollisionObjectType())
+	{
+	case ECC_DungeonHazard:
+		return RayHitType::Hazard;
+	case ECC_DungeonCoin:
+		return RayHitType::Coin;
+	case ECC_DungeonTreasure:
+		return RayHitType::Treasure;
+	default:
+		return RayHitType::Wall;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPrimitiveComponent;
+
+
+/// <summary>
+/// Moves a tagged dungeon object component onto its object channel, keeping the tag
+/// precedence Treasure over Coin over Hazard. Untagged components are left unchanged.
+/// </summary>
+/// <param name="component">The component</param>
+void AssignDungeonObjectChannel(UPrimitiveComponent* component);
+
+/// <summary>
+/// Classifies a component hit by a perception ray from its object channel.
+/// </summary>
+/// <param name="component">The hit component, null for hits without one</param>
+/// <returns>The ray hit type</returns>
+float GetDungeonObjectHitType(const UPrimitiveComponent* component);
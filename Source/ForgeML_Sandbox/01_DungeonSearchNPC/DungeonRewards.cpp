@@ -0,0 +1,198 @@
+#include "DungeonRewards.h"
+
+void FRewardBatch::Reset()
+{
+	mTreasureVisible.clear();
+	mCoinVisible.clear();
+	mLastTreasureDistance.clear();
+	mTreasureDistance.clear();
+	mLastCoinDistance.clear();
+	mCoinDistance.clear();
+}
+
+int32 FRewardBatch::Add(const std::array<float, NumRayCasts>& hitTypes,
+						float lastTreasureDistance,
+						float treasureDistance,
+						float lastCoinDistance,
+						float coinDistance)
+{
+	float treasureVisible = 0;
+	float coinVisible = 0;
+	for (float hit : hitTypes)
+	{
+		treasureVisible = FMath::Max(treasureVisible, static_cast<float>(hit == RayHitType::Treasure));
+		coinVisible = FMath::Max(coinVisible, static_cast<float>(hit == RayHitType::Coin));
+	}
+
+	mTreasureVisible.push_back(treasureVisible);
+	mCoinVisible.push_back(coinVisible);
+	mLastTreasureDistance.push_back(lastTreasureDistance);
+	mTreasureDistance.push_back(treasureDistance);
+	mLastCoinDistance.push_back(lastCoinDistance);
+	mCoinDistance.push_back(coinDistance);
+
+	return Num() - 1;
+}
+
+FRewardKernel::FRewardKernel()
+	: FRewardKernel(GetDefaultTerms())
+{
+}
+
+FRewardKernel::FRewardKernel(const TArray<FRewardTerm>& terms)
+{
+	for (const FRewardTerm& term : terms)
+	{
+		if (term.mFeature < ERewardFeature::COUNT)
+			mWeights[static_cast<size_t>(term.mFeature)] += term.mWeight;
+	}
+}
+
+TArray<FRewardTerm> FRewardKernel::GetDefaultTerms()
+{
+	return
+	{
+		// Small negative reward for each action to encourage efficiency
+		{ ERewardFeature::Step, -0.01f },
+		{ ERewardFeature::TreasureVisible, 0.2f },
+		{ ERewardFeature::CoinVisible, 0.1f },
+		{ ERewardFeature::TreasureProgress, 0.05f },
+		{ ERewardFeature::BlindProgress, -0.1f },
+		{ ERewardFeature::CoinProgress, 0.05f },
+		{ ERewardFeature::FoundCoin, 2.5f },
+		{ ERewardFeature::FoundTreasure, 100.0f },
+		{ ERewardFeature::Death, -100.0f },
+	};
+}
+
+const std::shared_ptr<const FRewardKernel>& FRewardKernel::GetDefault()
+{
+	static const std::shared_ptr<const FRewardKernel> DefaultKernel = std::make_shared<FRewardKernel>();
+	return DefaultKernel;
+}
+
+void FRewardKernel::Evaluate(const FRewardBatch& batch,
+							 float* outRewards) const
+{
+	const int32 count = batch.Num();
+	if (count == 0)
+		return;
+
+	const float stepWeight = mWeights[static_cast<size_t>(ERewardFeature::Step)];
+	const float treasureVisibleWeight = mWeights[static_cast<size_t>(ERewardFeature::TreasureVisible)];
+	const float coinVisibleWeight = mWeights[static_cast<size_t>(ERewardFeature::CoinVisible)];
+	const float treasureProgressWeight = mWeights[static_cast<size_t>(ERewardFeature::TreasureProgress)];
+	const float blindProgressWeight = mWeights[static_cast<size_t>(ERewardFeature::BlindProgress)];
+	const float coinProgressWeight = mWeights[static_cast<size_t>(ERewardFeature::CoinProgress)];
+
+	const float* treasureVisible = batch.mTreasureVisible.data();
+	const float* coinVisible = batch.mCoinVisible.data();
+	const float* lastTreasureDistance = batch.mLastTreasureDistance.data();
+	const float* treasureDistance = batch.mTreasureDistance.data();
+	const float* lastCoinDistance = batch.mLastCoinDistance.data();
+	const float* coinDistance = batch.mCoinDistance.data();
+
+	// Feature sums for the statistics, accumulated alongside so the loop stays a single pass.
+	float treasureVisibleSum = 0;
+	float coinVisibleSum = 0;
+	float treasureProgressSum = 0;
+	float blindProgressSum = 0;
+	float coinProgressSum = 0;
+
+	// Conditions are folded into the feature values so the loop has no branches to vectorize around.
+	for (int32 i = 0; i < count; ++i)
+	{
+		const float treasureProgress = lastTreasureDistance[i] - treasureDistance[i];
+		const float blindProgress = (1.0f - treasureVisible[i]) * static_cast<float>(treasureProgress > 0);
+		const float coinProgress = FMath::Max(lastCoinDistance[i] - coinDistance[i], 0.0f);
+
+		outRewards[i] = stepWeight +
+						treasureVisibleWeight * treasureVisible[i] +
+						coinVisibleWeight * coinVisible[i] +
+						treasureProgressWeight * treasureProgress +
+						blindProgressWeight * blindProgress +
+						coinProgressWeight * coinProgress;
+
+		treasureVisibleSum += treasureVisible[i];
+		coinVisibleSum += coinVisible[i];
+		treasureProgressSum += treasureProgress;
+		blindProgressSum += blindProgress;
+		coinProgressSum += coinProgress;
+	}
+
+	std::array<double, NumRewardFeatures> contributions {};
+	contributions[static_cast<size_t>(ERewardFeature::Step)] = static_cast<double>(stepWeight) * count;
+	contributions[static_cast<size_t>(ERewardFeature::TreasureVisible)] = treasureVisibleWeight * treasureVisibleSum;
+	contributions[static_cast<size_t>(ERewardFeature::CoinVisible)] = coinVisibleWeight * coinVisibleSum;
+	contributions[static_cast<size_t>(ERewardFeature::TreasureProgress)] = treasureProgressWeight * treasureProgressSum;
+	contributions[static_cast<size_t>(ERewardFeature::BlindProgress)] = blindProgressWeight * blindProgressSum;
+	contributions[static_cast<size_t>(ERewardFeature::CoinProgress)] = coinProgressWeight * coinProgressSum;
+
+	AddContributions(contributions, count);
+}
+
+float FRewardKernel::EvaluateEvent(ETransitionEvent event) const
+{
+	ERewardFeature feature = ERewardFeature::COUNT;
+	switch (event)
+	{
+	case ETransitionEvent::FoundCoin:
+		feature = ERewardFeature::FoundCoin;
+		break;
+	case ETransitionEvent::FoundTreasure:
+		feature = ERewardFeature::FoundTreasure;
+		break;
+	case ETransitionEvent::Death:
+		feature = ERewardFeature::Death;
+		break;
+	default:
+		return 0;
+	}
+
+	const float reward = mWeights[static_cast<size_t>(feature)];
+
+	std::array<double, NumRewardFeatures> contributions {};
+	contributions[static_cast<size_t>(feature)] = reward;
+	AddContributions(contributions, 1);
+
+	return reward;
+}
+
+void FRewardKernel::LogContributions() const
+{
+	const uint64 numTransitions = mNumTransitions.load(std::memory_order_relaxed);
+	if (numTransitions == 0)
+		return;
+
+	double totalMagnitude = 0;
+	for (const std::atomic<double>& contribution : mContributions)
+		totalMagnitude += FMath::Abs(contribution.load(std::memory_order_relaxed));
+
+	UE_LOG(LogTemp, Display, TEXT("Reward Terms Over %llu Transitions:"), numTransitions);
+
+	const UEnum* features = StaticEnum<ERewardFeature>();
+	for (int32 i = 0; i < NumRewardFeatures; ++i)
+	{
+		if (mWeights[i] == 0)
+			continue;
+
+		const double contribution = mContributions[i].load(std::memory_order_relaxed);
+		UE_LOG(LogTemp, Display, TEXT("  %s (x%g): %+.4f per transition, %.1f%% of the reward magnitude."),
+			   *features->GetNameStringByValue(i),
+			   mWeights[i],
+			   contribution / numTransitions,
+			   totalMagnitude > 0 ? FMath::Abs(contribution) * 100.0 / totalMagnitude : 0.0);
+	}
+}
+
+void FRewardKernel::AddContributions(const std::array<double, NumRewardFeatures>& contributions,
+									 int32 count) const
+{
+	for (int32 i = 0; i < NumRewardFeatures; ++i)
+	{
+		if (contributions[i] != 0)
+			mContributions[i].fetch_add(contributions[i], std::memory_order_relaxed);
+	}
+
+	mNumTransitions.fetch_add(count, std::memory_order_relaxed);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NPCDefines.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "DungeonRewards.generated.h"
+
+/// <summary>
+/// The features the rewards are weighted sums of. Decision features are measured
+/// between two consecutive direction decisions, event features are 1 on the event.
+/// </summary>
+UENUM(BlueprintType)
+enum class ERewardFeature : uint8
+{
+	// 1 per decision.
+	Step,
+	// 1 if a ray hit the treasure at the previous decision.
+	TreasureVisible,
+	// 1 if a ray hit a coin at the previous decision.
+	CoinVisible,
+	// The treasure distance closed since the previous decision, negative when moving away.
+	TreasureProgress,
+	// 1 if the treasure distance closed without the treasure in view.
+	BlindProgress,
+	// The nearest coin distance closed since the previous decision, 0 when moving away.
+	CoinProgress,
+	FoundCoin,
+	FoundTreasure,
+	Death,
+
+	COUNT UMETA(Hidden)
+};
+
+const int32 NumRewardFeatures = static_cast<int32>(ERewardFeature::COUNT);
+
+
+/// <summary>
+/// A single weighted reward term, terms of the same feature add up.
+/// </summary>
+USTRUCT(BlueprintType)
+struct FRewardTerm
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rewards")
+	ERewardFeature mFeature = ERewardFeature::Step;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rewards")
+	float mWeight = 0;
+};
+
+
+/// <summary>
+/// The decision reward inputs of a batch of agents in structure of arrays layout.
+/// </summary>
+struct FRewardBatch
+{
+	std::vector<float> mTreasureVisible;
+	std::vector<float> mCoinVisible;
+	std::vector<float> mLastTreasureDistance;
+	std::vector<float> mTreasureDistance;
+	std::vector<float> mLastCoinDistance;
+	std::vector<float> mCoinDistance;
+
+	/// <summary>
+	/// Removes every agent, keeping the capacity.
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Appends an agent's decision inputs.
+	/// </summary>
+	/// <param name="hitTypes">The ray hit types observed at the previous decision</param>
+	/// <param name="lastTreasureDistance">The treasure distance at the previous decision</param>
+	/// <param name="treasureDistance">The current treasure distance</param>
+	/// <param name="lastCoinDistance">The nearest coin distance at the previous decision</param>
+	/// <param name="coinDistance">The current nearest coin distance</param>
+	/// <returns>The index of the agent in the batch</returns>
+	int32 Add(const std::array<float, NumRayCasts>& hitTypes,
+			  float lastTreasureDistance,
+			  float treasureDistance,
+			  float lastCoinDistance,
+			  float coinDistance);
+
+	/// <summary>
+	/// Retrieves the number of agents in the batch.
+	/// </summary>
+	/// <returns>The number of agents</returns>
+	inline int32 Num() const { return static_cast<int32>(mTreasureDistance.size()); }
+};
+
+
+/// <summary>
+/// A reward term table compiled into one weight per feature and evaluated over
+/// whole batches without branches. Tracks the contribution of every feature to
+/// the rewards handed out, safe to evaluate from multiple threads.
+/// </summary>
+class FRewardKernel
+{
+public:
+	/// <summary>
+	/// Constructor compiling the default reward terms.
+	/// </summary>
+	FRewardKernel();
+
+	/// <summary>
+	/// Constructor compiling a reward term table.
+	/// </summary>
+	/// <param name="terms">The reward terms</param>
+	explicit FRewardKernel(const TArray<FRewardTerm>& terms);
+
+	FRewardKernel(const FRewardKernel&) = delete;
+	FRewardKernel& operator=(const FRewardKernel&) = delete;
+
+	/// <summary>
+	/// Retrieves the reward terms of the original sandbox rewards.
+	/// </summary>
+	/// <returns>The reward terms</returns>
+	static TArray<FRewardTerm> GetDefaultTerms();
+
+	/// <summary>
+	/// Retrieves a kernel of the default reward terms shared by everything not configured otherwise.
+	/// </summary>
+	/// <returns>The kernel</returns>
+	static const std::shared_ptr<const FRewardKernel>& GetDefault();
+public:
+	/// <summary>
+	/// Computes the decision rewards of a batch.
+	/// </summary>
+	/// <param name="batch">The decision inputs</param>
+	/// <param name="outRewards">The rewards, one per agent in the batch</param>
+	void Evaluate(const FRewardBatch& batch,
+				  float* outRewards) const;
+
+	/// <summary>
+	/// Retrieves the reward of a terminal or pickup event.
+	/// </summary>
+	/// <param name="event">The FoundCoin, FoundTreasure or Death event</param>
+	/// <returns>The reward</returns>
+	float EvaluateEvent(ETransitionEvent event) const;
+
+	/// <summary>
+	/// Logs the mean contribution per rewarded transition of every weighted feature.
+	/// </summary>
+	void LogContributions() const;
+private:
+	/// <summary>
+	/// Adds the contributions of an evaluation to the statistics.
+	/// </summary>
+	/// <param name="contributions">The summed contribution per feature</param>
+	/// <param name="count">The number of rewarded transitions</param>
+	void AddContributions(const std::array<double, NumRewardFeatures>& contributions,
+						  int32 count) const;
+private:
+	std::array<float, NumRewardFeatures> mWeights {};
+
+	mutable std::array<std::atomic<double>, NumRewardFeatures> mContributions {};
+	mutable std::atomic<uint64> mNumTransitions = 0;
+};
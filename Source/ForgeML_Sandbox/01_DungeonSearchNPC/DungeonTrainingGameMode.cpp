@@ -0,0 +1,273 @@
+#include "DungeonTrainingGameMode.h"
+
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+#include "ScenarioManagerActor.h"
+
+/// <summary>
+/// Replaces the weights of the reward features listed as "Feature:Weight,Feature:Weight".
+/// </summary>
+/// <param name="rewardTerms">The reward term overrides</param>
+/// <param name="terms">The reward terms to override</param>
+static void ApplyRewardTerms(const FString& rewardTerms,
+							 TArray<FRewardTerm>& terms)
+{
+	TArray<FString> overrides;
+	rewardTerms.ParseIntoArray(overrides, TEXT(","));
+
+	for (const FString& term : overrides)
+	{
+		FString name;
+		FString weight;
+		const int64 feature = term.Split(TEXT(":"), &name, &weight) ? StaticEnum<ERewardFeature>()->GetValueByNameString(name.TrimStartAndEnd()) : INDEX_NONE;
+		if (feature == INDEX_NONE || feature >= NumRewardFeatures)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Unknown Reward Term %s!"), *term);
+			continue;
+		}
+
+		terms.RemoveAll([feature](const FRewardTerm& other) { return static_cast<int64>(other.mFeature) == feature; });
+		terms.Add({ static_cast<ERewardFeature>(feature), FCString::Atof(*weight) });
+	}
+}
+
+ADungeonTrainingGameMode::ADungeonTrainingGameMode()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void ADungeonTrainingGameMode::StartPlay()
+{
+	// Managers must be configured before their BeginPlay spawns the agents.
+	for (TActorIterator<AScenarioManagerActor> it(GetWorld()); it; ++it)
+	{
+		mpManager = *it;
+		break;
+	}
+
+	if (mpManager)
+		ApplyCommandLine(mpManager);
+	else
+		UE_LOG(LogTemp, Warning, TEXT("No Scenario Manager Found For Headless Training!"));
+
+	// Simulate as fast as the machine allows.
+	if (GEngine)
+	{
+		GEngine->bUseFixedFrameRate = false;
+		GEngine->bSmoothFrameRate = false;
+		GEngine->SetMaxFPS(0);
+	}
+
+	float fixedStep_s = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("FixedStep="), fixedStep_s) && fixedStep_s > 0)
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(fixedStep_s);
+	}
+
+	mStartTime_s = FPlatformTime::Seconds();
+
+	Super::StartPlay();
+
+	// The manager spawned its agents when play began.
+	if (mpManager && mBenchmarkMovementSteps > 0)
+		mpManager->BenchmarkMovement(mBenchmarkMovementSteps);
+}
+
+void ADungeonTrainingGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (mFinished)
+		return;
+
+	mNumFrames++;
+	mSimulatedTime_s += DeltaSeconds;
+
+	if (!mpManager)
+	{
+		FinishTraining(TEXT("No Scenario Manager"));
+		return;
+	}
+
+	if (mMaxGenerations > 0 && mpManager->GetNumTrainingRounds() >= mMaxGenerations)
+		FinishTraining(TEXT("Generation Limit Reached"));
+	else if (mTimeBudget_s > 0 && FPlatformTime::Seconds() - mStartTime_s >= mTimeBudget_s)
+		FinishTraining(TEXT("Time Budget Reached"));
+}
+
+void ADungeonTrainingGameMode::ApplyCommandLine(AScenarioManagerActor* manager)
+{
+	const TCHAR* commandLine = FCommandLine::Get();
+
+	manager->mCurrentScenario = EScenarioType::Learning;
+	manager->mLiveLearning = true;
+
+	FParse::Value(commandLine, TEXT("Agents="), manager->mNumberOfAgents);
+	FParse::Value(commandLine, TEXT("MaxTrainingBatches="), manager->mMaxTrainingBatches);
+	FParse::Value(commandLine, TEXT("Batches="), manager->mTrainingBatches);
+	FParse::Value(commandLine, TEXT("AssemblyMinibatchSize="), manager->mAssemblyMinibatchSize);
+	FParse::Value(commandLine, TEXT("Epochs="), manager->mTrainingEpochs);
+	FParse::Value(commandLine, TEXT("LearningRate="), manager->mLearningRate);
+	FParse::Value(commandLine, TEXT("Gamma="), manager->mLearningGamma);
+	FParse::Value(commandLine, TEXT("RolloutWorkers="), manager->mNumRolloutWorkers);
+	FParse::Value(commandLine, TEXT("AgentsPerWorker="), manager->mAgentsPerRolloutWorker);
+	FParse::Value(commandLine, TEXT("PopulationSize="), manager->mPopulationSize);
+	FParse::Value(commandLine, TEXT("ExploitInterval="), manager->mPopulationExploitInterval);
+	FParse::Value(commandLine, TEXT("DecisionBuckets="), manager->mNumDecisionBuckets);
+	FParse::Value(commandLine, TEXT("MaxDecisionsPerFrame="), manager->mMaxDecisionsPerFrame);
+
+	if (FParse::Param(commandLine, TEXT("EvolutionStrategies")))
+		manager->mEvolutionStrategies = true;
+
+	FParse::Value(commandLine, TEXT("EvolutionPerturbations="), manager->mEvolutionPerturbations);
+	FParse::Value(commandLine, TEXT("EvolutionNoise="), manager->mEvolutionNoiseStdDev);
+	FParse::Value(commandLine, TEXT("EvolutionExportInterval="), manager->mEvolutionExportInterval);
+
+	if (FParse::Param(commandLine, TEXT("KinematicMovement")))
+		manager->mKinematicMovement = true;
+
+	FParse::Value(commandLine, TEXT("BenchmarkMovement="), mBenchmarkMovementSteps);
+
+	FParse::Value(commandLine, TEXT("Seed="), manager->mRandomSeed);
+	FParse::Value(commandLine, TEXT("RecordDecisions="), manager->mRecordDecisionsPath);
+	FParse::Value(commandLine, TEXT("ReplayDecisions="), manager->mReplayDecisionsPath);
+
+	if (FParse::Param(commandLine, TEXT("StageTimings")))
+		manager->mRecordStageTimings = true;
+
+	FParse::Value(commandLine, TEXT("StageReport="), mStageReportPath);
+	FParse::Value(commandLine, TEXT("StageBaseline="), mStageBaselinePath);
+	FParse::Value(commandLine, TEXT("StageTolerance="), mStageTolerance);
+
+	// Reports and baselines are only produced with timings enabled.
+	if (!mStageReportPath.IsEmpty() || !mStageBaselinePath.IsEmpty())
+		manager->mRecordStageTimings = true;
+
+	if (FParse::Param(commandLine, TEXT("InstancedAgents")))
+		manager->mUseInstancedAgents = true;
+
+	if (FParse::Param(commandLine, TEXT("ActionValueHead")))
+		manager->mUseActionValueHead = true;
+
+	if (FParse::Param(commandLine, TEXT("ReportFrameTimes")))
+		manager->mReportFrameTimes = true;
+
+	if (FParse::Param(commandLine, TEXT("CoroutineAgents")))
+		manager->mCoroutineAgents = true;
+
+	if (FParse::Param(commandLine, TEXT("PipelinedInference")))
+		manager->mPipelinedInference = true;
+
+	FParse::Value(commandLine, TEXT("PipelineLatency="), manager->mPipelineLatencyFrames);
+
+	if (FParse::Param(commandLine, TEXT("ContinuousTraining")))
+		manager->mContinuousTraining = true;
+
+	FParse::Value(commandLine, TEXT("MinTrainingBatches="), manager->mMinTrainingBatches);
+	FParse::Value(commandLine, TEXT("MaxEpisodeTime="), manager->mMaxEpisodeTime_s);
+
+	if (FParse::Param(commandLine, TEXT("TrajectoryReturns")))
+		manager->mUseTrajectoryReturns = true;
+
+	FParse::Value(commandLine, TEXT("ReturnSteps="), manager->mReturnSteps);
+
+	if (FParse::Param(commandLine, TEXT("EvaluateAfterTraining")))
+		manager->mEvaluateAfterTraining = true;
+
+	FParse::Value(commandLine, TEXT("EvaluationSeeds="), manager->mEvaluationSeeds);
+	FParse::Value(commandLine, TEXT("LearningCurve="), manager->mLearningCurvePath);
+
+	FString rewardTerms;
+	if (FParse::Value(commandLine, TEXT("RewardTerms="), rewardTerms, false))
+		ApplyRewardTerms(rewardTerms, manager->mRewardTerms);
+
+	if (FParse::Param(commandLine, TEXT("NormalizeObservations")))
+		manager->mNormalizeObservations = true;
+
+	FParse::Value(commandLine, TEXT("TargetFindRate="), manager->mTargetTreasureFindRate);
+
+	if (FParse::Param(commandLine, TEXT("InferenceCache")))
+		manager->mUseInferenceCache = true;
+
+	FParse::Value(commandLine, TEXT("InferenceCacheCapacity="), manager->mInferenceCacheCapacity);
+
+	if (FParse::Param(commandLine, TEXT("NoInferenceWarmUp")))
+		manager->mWarmUpInference = false;
+
+	if (FParse::Param(commandLine, TEXT("PerceptionCache")))
+		manager->mUsePerceptionCache = true;
+
+	FParse::Value(commandLine, TEXT("PerceptionCacheCapacity="), manager->mPerceptionCacheCapacity);
+	FParse::Value(commandLine, TEXT("PerceptionCellSize="), manager->mPerceptionCellSize_cm);
+
+	FString experienceRole;
+	if (FParse::Value(commandLine, TEXT("ExperienceRole="), experienceRole))
+	{
+		if (experienceRole.Equals(TEXT("Producer"), ESearchCase::IgnoreCase))
+			manager->mExperienceRole = EExperienceRole::Producer;
+		else if (experienceRole.Equals(TEXT("Learner"), ESearchCase::IgnoreCase))
+			manager->mExperienceRole = EExperienceRole::Learner;
+		else
+			UE_LOG(LogTemp, Warning, TEXT("Unknown Experience Role %s!"), *experienceRole);
+	}
+
+	FParse::Value(commandLine, TEXT("ExperienceChannel="), manager->mExperienceChannelName);
+
+	FParse::Value(commandLine, TEXT("Generations="), mMaxGenerations);
+	FParse::Value(commandLine, TEXT("TimeBudget="), mTimeBudget_s);
+
+	UE_LOG(LogTemp, Display, TEXT("Headless Training: %d Agents, %d Rollout Workers, %d Epochs, Learning Rate %f, Gamma %f."),
+		   manager->mNumberOfAgents,
+		   manager->mNumRolloutWorkers,
+		   manager->mTrainingEpochs,
+		   manager->mLearningRate,
+		   manager->mLearningGamma);
+}
+
+void ADungeonTrainingGameMode::FinishTraining(const TCHAR* reason)
+{
+	mFinished = true;
+
+	const double elapsed_s = FMath::Max(FPlatformTime::Seconds() - mStartTime_s, UE_DOUBLE_SMALL_NUMBER);
+	const int64 numSamples = mpManager ? mpManager->GetNumSamplesReceived() : 0;
+	const int64 numSamplesTrained = mpManager ? mpManager->GetNumSamplesTrained() : 0;
+	const int32 numGenerations = mpManager ? mpManager->GetNumTrainingRounds() : 0;
+
+	UE_LOG(LogTemp, Display, TEXT("Headless Training Finished (%s)."), reason);
+	UE_LOG(LogTemp, Display, TEXT("  Wall Time: %.1fs, Simulated Time: %.1fs (%.1fx)"), elapsed_s, mSimulatedTime_s, mSimulatedTime_s / elapsed_s);
+	UE_LOG(LogTemp, Display, TEXT("  Frames: %llu (%.1f frames/s)"), mNumFrames, mNumFrames / elapsed_s);
+	UE_LOG(LogTemp, Display, TEXT("  Samples: %lld (%.1f samples/s)"), numSamples, numSamples / elapsed_s);
+	UE_LOG(LogTemp, Display, TEXT("  Trained Samples: %lld (%.1f per simulated second)"), numSamplesTrained, numSamplesTrained / FMath::Max(mSimulatedTime_s, UE_DOUBLE_SMALL_NUMBER));
+	UE_LOG(LogTemp, Display, TEXT("  Generations: %d (%.2f generations/min)"), numGenerations, numGenerations * 60.0 / elapsed_s);
+
+	if (mpManager && mpManager->mReportFrameTimes)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  Frame Time: p50 %.2fms, p95 %.2fms, p99 %.2fms"),
+			   mpManager->GetFrameTimePercentile(50.0f),
+			   mpManager->GetFrameTimePercentile(95.0f),
+			   mpManager->GetFrameTimePercentile(99.0f));
+	}
+
+	if (mpManager && mpManager->mEvaluateAfterTraining)
+		UE_LOG(LogTemp, Display, TEXT("  Last Evaluation: %.1f%% Success"), mpManager->GetEvaluationSuccessRate() * 100.0f);
+
+	bool regressed = false;
+	if (const FStageTimings* timings = mpManager ? mpManager->GetStageTimings() : nullptr)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  Stage Timings:"));
+		timings->Log();
+
+		if (!mStageReportPath.IsEmpty())
+			timings->Save(mStageReportPath);
+
+		if (!mStageBaselinePath.IsEmpty())
+			regressed = !timings->CompareToBaseline(mStageBaselinePath, mStageTolerance);
+	}
+
+	FPlatformMisc::RequestExitWithStatus(false, regressed ? 1 : 0);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+
+#include "DungeonTrainingGameMode.generated.h"
+
+class AScenarioManagerActor;
+
+
+/// <summary>
+/// Game mode for unattended headless training runs. Applies the scenario
+/// settings from the command line, runs with an uncapped tick rate and
+/// exits after a number of generations or a time budget.
+///
+/// Example:
+///   ForgeML_Sandbox DungeonMap?game=/Script/ForgeML_Sandbox.DungeonTrainingGameMode
+///     -nullrhi -nosound -unattended -Agents=200 -Epochs=32 -Generations=50
+/// </summary>
+UCLASS()
+class ADungeonTrainingGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+public:
+	/// <summary>
+	/// Constructor initializing a ADungeonTrainingGameMode instance.
+	/// </summary>
+	ADungeonTrainingGameMode();
+public:
+	/// <summary>
+	/// Applies the command line overrides to the scenario before play begins.
+	/// </summary>
+	virtual void StartPlay() override;
+
+	/// <summary>
+	/// Function called every frame on this Actor.
+	/// </summary>
+	/// <param name="DeltaSeconds">Game time elapsed during last frame modified by the time dilation</param>
+	virtual void Tick(float DeltaSeconds) override;
+private:
+	/// <summary>
+	/// Applies the command line overrides to a scenario manager.
+	/// </summary>
+	/// <param name="manager">The scenario manager</param>
+	void ApplyCommandLine(AScenarioManagerActor* manager);
+
+	/// <summary>
+	/// Prints the throughput summary and requests the process to exit, with a
+	/// failing exit status if a stage regressed against the baseline report.
+	/// </summary>
+	/// <param name="reason">The exit reason</param>
+	void FinishTraining(const TCHAR* reason);
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Headless")
+	int32 mMaxGenerations = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Headless")
+	float mTimeBudget_s = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Headless")
+	int32 mBenchmarkMovementSteps = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Headless")
+	FString mStageReportPath;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Headless")
+	FString mStageBaselinePath;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Headless")
+	float mStageTolerance = 0.1f;
+private:
+	UPROPERTY()
+	AScenarioManagerActor* mpManager = nullptr;
+
+	double mStartTime_s = 0;
+	uint64 mNumFrames = 0;
+	double mSimulatedTime_s = 0;
+	bool mFinished = false;
+};
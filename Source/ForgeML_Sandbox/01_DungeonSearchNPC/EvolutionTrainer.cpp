@@ -0,0 +1,273 @@
+#include "EvolutionTrainer.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/RunnableThread.h"
+
+#include <algorithm>
+#include <numeric>
+
+// Parameters updated per parallel task of the aggregation.
+static const int32 ParameterBlockSize = 4096;
+
+/// <summary>
+/// Draws a standard normal sample with the Box-Muller transform.
+/// </summary>
+/// <param name="random">The random stream</param>
+/// <returns>The sample</returns>
+static float SampleGaussian(FRandomStream& random)
+{
+	const float u1 = FMath::Max(random.GetFraction(), UE_SMALL_NUMBER);
+	const float u2 = random.GetFraction();
+	return FMath::Sqrt(-2.0f * FMath::Loge(u1)) * FMath::Cos(UE_TWO_PI * u2);
+}
+
+FEvolutionTrainer::FEvolutionTrainer(std::shared_ptr<const FDungeonLayout> layout,
+									 const FHeadlessDungeonSettings& dungeonSettings,
+									 const TArray<FVector>& spawnPoints,
+									 const TArray<FVector>& coinPoints,
+									 const TArray<FVector>& treasurePoints,
+									 const FPolicyNetwork& network,
+									 const FEvolutionSettings& settings,
+									 const FEvolutionExportSink& exportSink)
+	: mpLayout(std::move(layout)),
+	mDungeonSettings(dungeonSettings),
+	mSpawnPoints(spawnPoints),
+	mCoinPoints(coinPoints),
+	mTreasurePoints(treasurePoints),
+	mNetwork(network),
+	mSettings(settings),
+	mExportSink(exportSink),
+	mRandom(settings.mSeed)
+{
+	// Episodes end on their own, agents are never respawned mid evaluation.
+	mDungeonSettings.mMaxEpisodeTime_s = 0;
+
+	mNetwork.InitializeParameters(mRandom, mParameters);
+	mFirstMoment.assign(mParameters.size(), 0.0f);
+	mSecondMoment.assign(mParameters.size(), 0.0f);
+}
+
+FEvolutionTrainer::~FEvolutionTrainer()
+{
+	if (mpThread)
+	{
+		mpThread->Kill(true);
+		delete mpThread;
+		mpThread = nullptr;
+	}
+}
+
+void FEvolutionTrainer::Start()
+{
+	if (mpThread)
+		return;
+
+	mStartTime_s = FPlatformTime::Seconds();
+	mpThread = FRunnableThread::Create(this, TEXT("EvolutionTrainer"));
+}
+
+uint32 FEvolutionTrainer::Run()
+{
+	if (!mpLayout || mSpawnPoints.IsEmpty() || mTreasurePoints.IsEmpty())
+		return 1;
+
+	while (!mStopRequested.load(std::memory_order_relaxed))
+	{
+		const double start_s = FPlatformTime::Seconds();
+		const float meanFitness = RunGeneration();
+		const double generationTime_s = FPlatformTime::Seconds() - start_s;
+
+		const int32 generation = mNumGenerations.load(std::memory_order_relaxed);
+		const int32 numEvaluations = FMath::Max(1, mSettings.mNumPerturbations) * 2;
+
+		UE_LOG(LogTemp, Display, TEXT("Evolution Generation %d: Mean Fitness %.3f, %d Evaluations In %.2fs (%.1f episodes/s), %.1fs Elapsed."),
+			   generation,
+			   meanFitness,
+			   numEvaluations,
+			   generationTime_s,
+			   generationTime_s > 0 ? numEvaluations * FMath::Max(1, mSettings.mAgentsPerEvaluation) / generationTime_s : 0.0,
+			   FPlatformTime::Seconds() - mStartTime_s);
+
+		if (mExportSink && generation % FMath::Max(1, mSettings.mExportInterval) == 0)
+			Export();
+	}
+
+	return 0;
+}
+
+void FEvolutionTrainer::Stop()
+{
+	mStopRequested = true;
+}
+
+float FEvolutionTrainer::RunGeneration()
+{
+	const int32 numParameters = mNetwork.GetNumParameters();
+	const int32 numPairs = FMath::Max(1, mSettings.mNumPerturbations);
+	const float noiseStdDev = FMath::Max(mSettings.mNoiseStdDev, UE_SMALL_NUMBER);
+
+	// Only the seeds are drawn serially, the noise and the episodes are generated per task.
+	std::vector<int32> noiseSeeds(numPairs);
+	std::vector<int32> episodeSeeds(numPairs);
+	for (int32 pair = 0; pair < numPairs; ++pair)
+	{
+		noiseSeeds[pair] = mRandom.RandHelper(MAX_int32);
+		episodeSeeds[pair] = mRandom.RandHelper(MAX_int32);
+	}
+
+	mNoise.resize(static_cast<size_t>(numPairs) * numParameters);
+	ParallelFor(numPairs, [&](int32 pair)
+	{
+		FRandomStream noiseRandom(noiseSeeds[pair]);
+
+		float* noise = mNoise.data() + static_cast<size_t>(pair) * numParameters;
+		for (int32 i = 0; i < numParameters; ++i)
+			noise[i] = SampleGaussian(noiseRandom);
+	});
+
+	// Both halves of a pair play the same episodes, so the fitness difference is down to the perturbation.
+	std::vector<float> fitness(static_cast<size_t>(numPairs) * 2);
+	ParallelFor(numPairs * 2, [&](int32 evaluation)
+	{
+		const int32 pair = evaluation / 2;
+		const float scale = evaluation % 2 == 0 ? noiseStdDev : -noiseStdDev;
+
+		const float* noise = mNoise.data() + static_cast<size_t>(pair) * numParameters;
+
+		std::vector<float> parameters(numParameters);
+		for (int32 i = 0; i < numParameters; ++i)
+			parameters[i] = mParameters[i] + scale * noise[i];
+
+		fitness[evaluation] = Evaluate(parameters, episodeSeeds[pair]);
+	});
+
+	// Centered ranks keep single outlier episodes from dominating the update.
+	std::vector<int32> order(fitness.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&fitness](int32 a, int32 b) { return fitness[a] < fitness[b]; });
+
+	std::vector<float> ranks(fitness.size());
+	for (size_t rank = 0; rank < order.size(); ++rank)
+		ranks[order[rank]] = static_cast<float>(rank) / (order.size() - 1) - 0.5f;
+
+	const int32 step = mNumGenerations.load(std::memory_order_relaxed) + 1;
+	const float beta1 = 0.9f;
+	const float beta2 = 0.999f;
+	const float firstCorrection = 1.0f - FMath::Pow(beta1, static_cast<float>(step));
+	const float secondCorrection = 1.0f - FMath::Pow(beta2, static_cast<float>(step));
+	const float gradientScale = 1.0f / (numPairs * 2 * noiseStdDev);
+
+	const int32 numBlocks = FMath::DivideAndRoundUp(numParameters, ParameterBlockSize);
+	ParallelFor(numBlocks, [&](int32 block)
+	{
+		const int32 begin = block * ParameterBlockSize;
+		const int32 end = FMath::Min(begin + ParameterBlockSize, numParameters);
+
+		for (int32 i = begin; i < end; ++i)
+		{
+			float gradient = 0;
+			for (int32 pair = 0; pair < numPairs; ++pair)
+				gradient += (ranks[pair * 2] - ranks[pair * 2 + 1]) * mNoise[static_cast<size_t>(pair) * numParameters + i];
+
+			gradient = gradient * gradientScale - mSettings.mWeightDecay * mParameters[i];
+
+			mFirstMoment[i] = beta1 * mFirstMoment[i] + (1.0f - beta1) * gradient;
+			mSecondMoment[i] = beta2 * mSecondMoment[i] + (1.0f - beta2) * gradient * gradient;
+
+			// Ascends the fitness.
+			mParameters[i] += mSettings.mLearningRate * (mFirstMoment[i] / firstCorrection) / (FMath::Sqrt(mSecondMoment[i] / secondCorrection) + 1e-8f);
+		}
+	});
+
+	mNumGenerations++;
+
+	return std::accumulate(fitness.begin(), fitness.end(), 0.0f) / fitness.size();
+}
+
+float FEvolutionTrainer::Evaluate(const std::vector<float>& parameters,
+								  int32 seed,
+								  std::vector<float>* outStates,
+								  int32 maxStates) const
+{
+	FHeadlessDungeon dungeon(mpLayout, mDungeonSettings, mSpawnPoints, mCoinPoints, seed);
+	dungeon.SetAutoReset(false);
+
+	FRandomStream random(seed);
+
+	const int32 numAgents = FMath::Max(1, mSettings.mAgentsPerEvaluation);
+	for (int32 i = 0; i < numAgents; ++i)
+	{
+		const FVector& spawnPoint = mSpawnPoints[random.RandRange(0, mSpawnPoints.Num() - 1)];
+		const FVector& treasurePoint = mTreasurePoints[random.RandRange(0, mTreasurePoints.Num() - 1)];
+
+		const int32 index = dungeon.AddAgent(treasurePoint);
+		dungeon.ResetAgent(index, spawnPoint, treasurePoint);
+		dungeon.RequestDecision(index);
+	}
+
+	std::vector<int32> decisions;
+	std::vector<float> states;
+	std::vector<std::tuple<EMoveDirection, float>> actions;
+	std::vector<TrainingInfo> transitions;
+
+	float totalReward = 0;
+
+	bool anyActive = true;
+	for (float time_s = 0; anyActive && time_s < mSettings.mEpisodeTime_s; time_s += mSettings.mStepTime_s)
+	{
+		decisions.clear();
+		transitions.clear();
+		dungeon.Step(mSettings.mStepTime_s, decisions, transitions);
+
+		for (const TrainingInfo& info : transitions)
+			totalReward += info.mReward;
+
+		if (!decisions.empty())
+		{
+			states.clear();
+			for (int32 index : decisions)
+				dungeon.GetObservation(index, states);
+
+			if (outStates && static_cast<int32>(outStates->size() / StateSize) < maxStates)
+			{
+				const size_t numStates = FMath::Min(decisions.size(), static_cast<size_t>(maxStates) - outStates->size() / StateSize);
+				outStates->insert(outStates->end(), states.begin(), states.begin() + numStates * StateSize);
+			}
+
+			// The policy acts greedily, the exploration comes from the parameter noise.
+			mNetwork.SelectActions(parameters.data(), states, static_cast<int32>(decisions.size()), actions);
+
+			for (size_t i = 0; i < decisions.size(); ++i)
+			{
+				const auto [dir, dir_f] = actions[i];
+				dungeon.ApplyDecision(decisions[i], dir, dir_f);
+			}
+		}
+
+		anyActive = false;
+		for (int32 i = 0; i < dungeon.GetNumAgents(); ++i)
+			anyActive |= dungeon.GetAgent(i).mActive;
+	}
+
+	return totalReward / numAgents;
+}
+
+void FEvolutionTrainer::Export()
+{
+	const int32 maxStates = FMath::Max(1, mSettings.mNumExportStates);
+
+	// The mean policy is exported on the states it visits itself.
+	std::vector<float> states;
+	states.reserve(static_cast<size_t>(maxStates) * StateSize);
+	for (int32 attempt = 0; attempt < 64 && static_cast<int32>(states.size() / StateSize) < maxStates; ++attempt)
+		Evaluate(mParameters, mRandom.RandHelper(MAX_int32), &states, maxStates);
+
+	const int32 count = static_cast<int32>(states.size() / StateSize);
+	if (count == 0)
+		return;
+
+	std::vector<float> outputs;
+	mNetwork.Forward(mParameters.data(), states.data(), count, outputs);
+
+	mExportSink(states, outputs, count, mNumGenerations.load(std::memory_order_relaxed));
+}
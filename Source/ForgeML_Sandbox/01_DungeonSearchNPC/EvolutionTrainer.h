@@ -0,0 +1,156 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+#include "HeadlessDungeon.h"
+#include "PolicyNetwork.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class FRunnableThread;
+
+
+/// <summary>
+/// Settings of the evolution strategies trainer.
+/// </summary>
+struct FEvolutionSettings
+{
+	// Antithetic pairs evaluated per generation, each pair is two evaluations.
+	int32 mNumPerturbations = 64;
+	float mNoiseStdDev = 0.05f;
+
+	float mLearningRate = 0.01f;
+	float mWeightDecay = 0.005f;
+
+	// Agents stepped in each evaluation's dungeon, their summed rewards are the fitness.
+	int32 mAgentsPerEvaluation = 8;
+	float mStepTime_s = 1.0f / 30.0f;
+	float mEpisodeTime_s = 60.0f;
+
+	// Generations between exports of the mean policy, and the states it is exported on.
+	int32 mExportInterval = 10;
+	int32 mNumExportStates = 4096;
+
+	int32 mSeed = 0;
+};
+
+
+/// <summary>
+/// Receives the mean policy's outputs on a set of visited states, called on the trainer thread.
+/// </summary>
+using FEvolutionExportSink = std::function<void(const std::vector<float>& states,
+												const std::vector<float>& outputs,
+												int32 count,
+												int32 generation)>;
+
+
+/// <summary>
+/// Gradient-free trainer running natural evolution strategies on headless dungeons.
+/// Each generation evaluates antithetic gaussian perturbations of the native policy
+/// parameters on independent episodes across the task graph workers, then moves
+/// the parameters along the rank weighted noise with Adam.
+/// </summary>
+class FEvolutionTrainer : public FRunnable
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FEvolutionTrainer instance.
+	/// </summary>
+	/// <param name="layout">The shared dungeon layout</param>
+	/// <param name="dungeonSettings">The agent settings</param>
+	/// <param name="spawnPoints">The agent spawn points</param>
+	/// <param name="coinPoints">The coin locations</param>
+	/// <param name="treasurePoints">The treasure locations</param>
+	/// <param name="network">The policy network shape</param>
+	/// <param name="settings">The trainer settings</param>
+	/// <param name="exportSink">The mean policy export callback</param>
+	FEvolutionTrainer(std::shared_ptr<const FDungeonLayout> layout,
+					  const FHeadlessDungeonSettings& dungeonSettings,
+					  const TArray<FVector>& spawnPoints,
+					  const TArray<FVector>& coinPoints,
+					  const TArray<FVector>& treasurePoints,
+					  const FPolicyNetwork& network,
+					  const FEvolutionSettings& settings,
+					  const FEvolutionExportSink& exportSink);
+
+	/// <summary>
+	/// Destructor stopping and joining the trainer thread.
+	/// </summary>
+	virtual ~FEvolutionTrainer();
+public:
+	/// <summary>
+	/// Starts the trainer thread.
+	/// </summary>
+	void Start();
+
+	/// <summary>
+	/// Runs generations until stopped.
+	/// </summary>
+	/// <returns>The exit code</returns>
+	virtual uint32 Run() override;
+
+	/// <summary>
+	/// Requests the trainer to stop after the current generation.
+	/// </summary>
+	virtual void Stop() override;
+
+	/// <summary>
+	/// Runs a single generation, updating the mean parameters.
+	/// </summary>
+	/// <returns>The mean fitness of the generation's evaluations</returns>
+	float RunGeneration();
+
+	/// <summary>
+	/// Retrieves the number of completed generations.
+	/// </summary>
+	/// <returns>The number of generations</returns>
+	inline int32 GetNumGenerations() const { return mNumGenerations.load(std::memory_order_relaxed); }
+private:
+	/// <summary>
+	/// Runs the episodes of one evaluation.
+	/// </summary>
+	/// <param name="parameters">The policy parameters</param>
+	/// <param name="seed">The episode seed, shared by both halves of an antithetic pair</param>
+	/// <param name="outStates">Optional, the visited decision states are appended</param>
+	/// <param name="maxStates">The maximum number of states to append</param>
+	/// <returns>The summed reward per agent</returns>
+	float Evaluate(const std::vector<float>& parameters,
+				   int32 seed,
+				   std::vector<float>* outStates = nullptr,
+				   int32 maxStates = 0) const;
+
+	/// <summary>
+	/// Exports the mean policy on the states it visits.
+	/// </summary>
+	void Export();
+private:
+	std::shared_ptr<const FDungeonLayout> mpLayout;
+	FHeadlessDungeonSettings mDungeonSettings;
+
+	TArray<FVector> mSpawnPoints;
+	TArray<FVector> mCoinPoints;
+	TArray<FVector> mTreasurePoints;
+
+	FPolicyNetwork mNetwork;
+	FEvolutionSettings mSettings;
+	FEvolutionExportSink mExportSink;
+
+	FRandomStream mRandom;
+
+	std::vector<float> mParameters;
+	std::vector<float> mNoise;
+
+	// Adam moments of the parameter updates.
+	std::vector<float> mFirstMoment;
+	std::vector<float> mSecondMoment;
+
+	std::atomic<bool> mStopRequested = false;
+	std::atomic<int32> mNumGenerations = 0;
+	double mStartTime_s = 0;
+
+	FRunnableThread* mpThread = nullptr;
+};
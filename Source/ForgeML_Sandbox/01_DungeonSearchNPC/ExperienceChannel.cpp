@@ -0,0 +1,172 @@
+#include "ExperienceChannel.h"
+
+static const uint32 ExperienceChannelMagic = 0x444E4758;
+
+std::unique_ptr<FExperienceChannel> FExperienceChannel::Create(const FString& name,
+															   int32 capacity)
+{
+	const uint32 slots = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(capacity, 2)));
+
+	std::unique_ptr<FExperienceChannel> channel = Map(name, slots, true);
+	if (!channel)
+		return nullptr;
+
+	FHeader* header = channel->mpHeader;
+	header->mCapacity = slots;
+	header->mEnqueuePosition.store(0, std::memory_order_relaxed);
+	header->mDequeuePosition.store(0, std::memory_order_relaxed);
+	header->mNumDropped.store(0, std::memory_order_relaxed);
+	header->mNumProducers.store(0, std::memory_order_relaxed);
+	header->mModelVersion.store(0, std::memory_order_relaxed);
+	header->mModelPublishTime_us.store(0, std::memory_order_relaxed);
+	header->mModelSaveSequence.store(0, std::memory_order_relaxed);
+	header->mBroadcastLatency_us.store(0, std::memory_order_relaxed);
+	header->mNumBroadcasts.store(0, std::memory_order_relaxed);
+
+	for (uint32 i = 0; i < slots; ++i)
+		channel->mpSlots[i].mSequence.store(i, std::memory_order_relaxed);
+
+	// Producers only use the channel once the magic is visible.
+	header->mMagic.store(ExperienceChannelMagic, std::memory_order_release);
+	return channel;
+}
+
+std::unique_ptr<FExperienceChannel> FExperienceChannel::Open(const FString& name,
+															 int32 capacity)
+{
+	const uint32 slots = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(capacity, 2)));
+
+	std::unique_ptr<FExperienceChannel> channel = Map(name, slots, false);
+	if (!channel)
+		return nullptr;
+
+	if (channel->mpHeader->mMagic.load(std::memory_order_acquire) != ExperienceChannelMagic)
+		return nullptr;
+
+	if (channel->mpHeader->mCapacity != slots)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Experience Channel Capacity Mismatch: %u Slots Expected, %u Created."), slots, channel->mpHeader->mCapacity);
+		return nullptr;
+	}
+
+	channel->mProducerIndex = channel->mpHeader->mNumProducers.fetch_add(1, std::memory_order_relaxed);
+	return channel;
+}
+
+std::unique_ptr<FExperienceChannel> FExperienceChannel::Map(const FString& name,
+															uint32 capacity,
+															bool create)
+{
+	FPlatformMemory::FSharedMemoryRegion* region = FPlatformMemory::MapNamedSharedMemoryRegion(name,
+																							   create,
+																							   static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Read) | static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Write),
+																							   GetRegionSize(capacity));
+	if (!region)
+		return nullptr;
+
+	std::unique_ptr<FExperienceChannel> channel(new FExperienceChannel());
+	channel->mpRegion = region;
+	channel->mpHeader = static_cast<FHeader*>(region->GetAddress());
+	channel->mpSlots = reinterpret_cast<FSlot*>(static_cast<uint8*>(region->GetAddress()) + Align(sizeof(FHeader), PLATFORM_CACHE_LINE_SIZE));
+	channel->mMask = capacity - 1;
+	return channel;
+}
+
+SIZE_T FExperienceChannel::GetRegionSize(uint32 capacity)
+{
+	return Align(sizeof(FHeader), PLATFORM_CACHE_LINE_SIZE) + sizeof(FSlot) * static_cast<SIZE_T>(capacity);
+}
+
+FExperienceChannel::~FExperienceChannel()
+{
+	if (mpRegion)
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(mpRegion);
+}
+
+bool FExperienceChannel::Push(const TrainingInfo& info)
+{
+	uint64 position = mpHeader->mEnqueuePosition.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		FSlot& slot = mpSlots[position & mMask];
+		const uint64 sequence = slot.mSequence.load(std::memory_order_acquire);
+		const int64 difference = static_cast<int64>(sequence) - static_cast<int64>(position);
+
+		if (difference == 0)
+		{
+			// The slot is free for this position, claim it before writing.
+			if (mpHeader->mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				slot.mTransition = info;
+				if (info.mAgentId >= 0 && mProducerIndex > 0)
+					slot.mTransition.mAgentId += mProducerIndex * ProducerAgentIdStride;
+
+				slot.mSequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			// The learner has not read this slot a lap ago, the ring is full.
+			mpHeader->mNumDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			position = mpHeader->mEnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+int32 FExperienceChannel::Pop(std::vector<TrainingInfo>& outTransitions,
+							  int32 maxCount)
+{
+	uint64 position = mpHeader->mDequeuePosition.load(std::memory_order_relaxed);
+
+	int32 count = 0;
+	while (count < maxCount)
+	{
+		FSlot& slot = mpSlots[position & mMask];
+		if (slot.mSequence.load(std::memory_order_acquire) != position + 1)
+			break;
+
+		outTransitions.push_back(slot.mTransition);
+
+		// Hands the slot back to the producers for the next lap.
+		slot.mSequence.store(position + mMask + 1, std::memory_order_release);
+		++position;
+		++count;
+	}
+
+	mpHeader->mDequeuePosition.store(position, std::memory_order_relaxed);
+	return count;
+}
+
+void FExperienceChannel::PublishModel(uint32 version)
+{
+	mpHeader->mModelPublishTime_us.store(static_cast<uint64>(FPlatformTime::Seconds() * 1000000.0), std::memory_order_relaxed);
+	mpHeader->mModelVersion.store(version, std::memory_order_release);
+}
+
+void FExperienceChannel::BeginModelSave()
+{
+	mpHeader->mModelSaveSequence.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void FExperienceChannel::EndModelSave()
+{
+	mpHeader->mModelSaveSequence.fetch_add(1, std::memory_order_release);
+}
+
+void FExperienceChannel::RecordBroadcastLatency(double latency_s)
+{
+	mpHeader->mBroadcastLatency_us.fetch_add(static_cast<uint64>(FMath::Max(0.0, latency_s) * 1000000.0), std::memory_order_relaxed);
+	mpHeader->mNumBroadcasts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FExperienceChannel::GetBroadcastLatency(double& outTotalLatency_s,
+											 uint64& outNumBroadcasts) const
+{
+	outTotalLatency_s = mpHeader->mBroadcastLatency_us.load(std::memory_order_relaxed) / 1000000.0;
+	outNumBroadcasts = mpHeader->mNumBroadcasts.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+
+#include "NPCDefines.h"
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::atomic<uint64>::is_always_lock_free, "Shared memory atomics must be lock free to work across processes.");
+static_assert(std::is_trivially_copyable_v<TrainingInfo>, "Transitions are copied through shared memory.");
+
+// Agent ids of each producer process are offset by this stride so they stay unique at the learner.
+const int32 ProducerAgentIdStride = 1 << 16;
+
+
+/// <summary>
+/// Shared memory channel between sandbox processes: a bounded multi-producer ring
+/// of transitions streamed to a single learner process, and the model version
+/// the learner publishes back to the producers after each training round.
+/// </summary>
+class FExperienceChannel
+{
+public:
+	/// <summary>
+	/// Creates and initializes the named channel, called by the learner.
+	/// </summary>
+	/// <param name="name">The shared memory region name</param>
+	/// <param name="capacity">The number of ring slots, rounded up to a power of two</param>
+	/// <returns>The channel, null if the region could not be mapped</returns>
+	static std::unique_ptr<FExperienceChannel> Create(const FString& name,
+													  int32 capacity);
+
+	/// <summary>
+	/// Opens a channel created by the learner, called by the producers.
+	/// </summary>
+	/// <param name="name">The shared memory region name</param>
+	/// <param name="capacity">The number of ring slots the learner created the channel with</param>
+	/// <returns>The channel, null if the learner has not initialized it yet</returns>
+	static std::unique_ptr<FExperienceChannel> Open(const FString& name,
+													int32 capacity);
+
+	/// <summary>
+	/// Destructor unmapping the shared memory region.
+	/// </summary>
+	~FExperienceChannel();
+public:
+	/// <summary>
+	/// Writes a transition into the ring without blocking.
+	/// </summary>
+	/// <param name="info">The transition, its agent id is offset by the producer index</param>
+	/// <returns>True if written, false if the ring was full and the transition dropped</returns>
+	bool Push(const TrainingInfo& info);
+
+	/// <summary>
+	/// Reads the transitions written so far, only called by the learner.
+	/// </summary>
+	/// <param name="outTransitions">The transitions, appended</param>
+	/// <param name="maxCount">The maximum number of transitions to read</param>
+	/// <returns>The number of transitions read</returns>
+	int32 Pop(std::vector<TrainingInfo>& outTransitions,
+			  int32 maxCount);
+
+	/// <summary>
+	/// Publishes a new model version to the producers.
+	/// </summary>
+	/// <param name="version">The model version</param>
+	void PublishModel(uint32 version);
+
+	/// <summary>
+	/// Marks the saved model as being rewritten, producers discard a model loaded meanwhile.
+	/// </summary>
+	void BeginModelSave();
+
+	/// <summary>
+	/// Marks the saved model as complete again.
+	/// </summary>
+	void EndModelSave();
+
+	/// <summary>
+	/// Records the time a producer took to pick up a published model.
+	/// </summary>
+	/// <param name="latency_s">The time between publishing and the reloaded model being used</param>
+	void RecordBroadcastLatency(double latency_s);
+public:
+	/// <summary>
+	/// Retrieves the index of this producer, assigned when the channel was opened.
+	/// </summary>
+	/// <returns>The producer index, INDEX_NONE for the learner</returns>
+	inline int32 GetProducerIndex() const { return mProducerIndex; }
+
+	/// <summary>
+	/// Retrieves the latest published model version.
+	/// </summary>
+	/// <returns>The model version</returns>
+	inline uint32 GetModelVersion() const { return mpHeader->mModelVersion.load(std::memory_order_acquire); }
+
+	/// <summary>
+	/// Retrieves the time the latest model version was published.
+	/// </summary>
+	/// <returns>The publish time in FPlatformTime seconds, shared by the processes of a machine</returns>
+	inline double GetModelPublishTime_s() const { return mpHeader->mModelPublishTime_us.load(std::memory_order_acquire) / 1000000.0; }
+
+	/// <summary>
+	/// Retrieves the model save sequence. It is odd while the learner writes the saved model,
+	/// a model loaded between two equal even reads is a complete checkpoint.
+	/// </summary>
+	/// <returns>The save sequence</returns>
+	inline uint32 GetModelSaveSequence() const { return mpHeader->mModelSaveSequence.load(std::memory_order_acquire); }
+
+	/// <summary>
+	/// Retrieves the number of producers that opened the channel.
+	/// </summary>
+	/// <returns>The number of producers</returns>
+	inline int32 GetNumProducers() const { return mpHeader->mNumProducers.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Retrieves the number of transitions dropped because the ring was full.
+	/// </summary>
+	/// <returns>The number of dropped transitions</returns>
+	inline uint64 GetNumDropped() const { return mpHeader->mNumDropped.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Retrieves the accumulated producer broadcast latencies.
+	/// </summary>
+	/// <param name="outTotalLatency_s">The summed latency</param>
+	/// <param name="outNumBroadcasts">The number of recorded model pickups</param>
+	void GetBroadcastLatency(double& outTotalLatency_s,
+							 uint64& outNumBroadcasts) const;
+private:
+	/// <summary>
+	/// The channel header at the start of the shared memory region.
+	/// </summary>
+	struct FHeader
+	{
+		std::atomic<uint32> mMagic;
+		uint32 mCapacity;
+
+		// Separate cache lines, every producer contends on the enqueue position.
+		alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> mEnqueuePosition;
+		alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> mDequeuePosition;
+
+		alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> mNumDropped;
+		std::atomic<int32> mNumProducers;
+
+		std::atomic<uint32> mModelVersion;
+		std::atomic<uint64> mModelPublishTime_us;
+		std::atomic<uint32> mModelSaveSequence;
+		std::atomic<uint64> mBroadcastLatency_us;
+		std::atomic<uint64> mNumBroadcasts;
+	};
+
+	/// <summary>
+	/// A ring slot, the sequence tells whose turn it is to write or read it.
+	/// </summary>
+	struct FSlot
+	{
+		std::atomic<uint64> mSequence;
+		TrainingInfo mTransition;
+	};
+
+	/// <summary>
+	/// Maps the named region.
+	/// </summary>
+	/// <param name="name">The shared memory region name</param>
+	/// <param name="capacity">The number of ring slots, a power of two</param>
+	/// <param name="create">Whether to create the region</param>
+	/// <returns>The channel, null if the region could not be mapped</returns>
+	static std::unique_ptr<FExperienceChannel> Map(const FString& name,
+												   uint32 capacity,
+												   bool create);
+
+	/// <summary>
+	/// Retrieves the size of the shared memory region.
+	/// </summary>
+	/// <param name="capacity">The number of ring slots</param>
+	/// <returns>The size in bytes</returns>
+	static SIZE_T GetRegionSize(uint32 capacity);
+private:
+	FPlatformMemory::FSharedMemoryRegion* mpRegion = nullptr;
+	FHeader* mpHeader = nullptr;
+	FSlot* mpSlots = nullptr;
+	uint64 mMask = 0;
+
+	int32 mProducerIndex = INDEX_NONE;
+};
@@ -0,0 +1,73 @@
+#include "FrameArena.h"
+
+// Blocks are aligned generously so any transient element type fits.
+static const SIZE_T BlockAlignment = 64;
+
+FFrameArena::FFrameArena(SIZE_T blockSize)
+{
+	AddBlock(FMath::Max<SIZE_T>(blockSize, BlockAlignment));
+}
+
+FFrameArena::~FFrameArena()
+{
+	for (FBlock& block : mBlocks)
+		FMemory::Free(block.mpData);
+}
+
+void* FFrameArena::Allocate(SIZE_T size,
+							SIZE_T alignment)
+{
+	mNumAllocations++;
+	mBytesUsed += size;
+
+	for (;;)
+	{
+		FBlock& block = mBlocks[mCurrentBlock];
+
+		const SIZE_T offset = Align(mOffset, alignment);
+		if (offset + size <= block.mSize)
+		{
+			mOffset = offset + size;
+			return block.mpData + offset;
+		}
+
+		// Overflowing frames spill into the next block, growing the arena when none is left.
+		if (++mCurrentBlock == mBlocks.size())
+			AddBlock(FMath::Max(block.mSize * 2, Align(size, BlockAlignment)));
+
+		mOffset = 0;
+	}
+}
+
+void FFrameArena::Reset()
+{
+	if (mBlocks.size() > 1)
+	{
+		SIZE_T totalSize = 0;
+		for (FBlock& block : mBlocks)
+		{
+			totalSize += block.mSize;
+			FMemory::Free(block.mpData);
+		}
+
+		mBlocks.clear();
+		AddBlock(totalSize);
+	}
+
+	mPeakBytesUsed = FMath::Max(mPeakBytesUsed, mBytesUsed);
+
+	mCurrentBlock = 0;
+	mOffset = 0;
+	mNumAllocations = 0;
+	mBytesUsed = 0;
+}
+
+void FFrameArena::AddBlock(SIZE_T size)
+{
+	FBlock block;
+	block.mpData = static_cast<uint8*>(FMemory::Malloc(size, BlockAlignment));
+	block.mSize = size;
+
+	mBlocks.push_back(block);
+	mNumHeapAllocations++;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <type_traits>
+#include <vector>
+
+
+/// <summary>
+/// A linear bump allocator for transient per-frame buffers. Memory is handed out
+/// from pre-allocated blocks and released all at once when the arena is reset,
+/// without running destructors. Backs the decision inputs of the learning NPCs,
+/// the ForgeML tensors built from them are still allocated by the library.
+/// </summary>
+class FFrameArena
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FFrameArena instance.
+	/// </summary>
+	/// <param name="blockSize">The initial block size in bytes</param>
+	explicit FFrameArena(SIZE_T blockSize = 64 * 1024);
+
+	/// <summary>
+	/// Destructor cleaning up a FFrameArena instance.
+	/// </summary>
+	~FFrameArena();
+
+	FFrameArena(const FFrameArena&) = delete;
+	FFrameArena& operator=(const FFrameArena&) = delete;
+public:
+	/// <summary>
+	/// Allocates uninitialized memory valid until the next reset.
+	/// </summary>
+	/// <param name="size">The size in bytes</param>
+	/// <param name="alignment">The alignment in bytes</param>
+	/// <returns>The allocated memory</returns>
+	void* Allocate(SIZE_T size,
+				   SIZE_T alignment);
+
+	/// <summary>
+	/// Allocates an uninitialized array valid until the next reset.
+	/// </summary>
+	/// <param name="count">The number of elements</param>
+	/// <returns>The allocated array</returns>
+	template<typename T>
+	TArrayView<T> AllocateArray(int32 count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Frame arena memory is released without running destructors.");
+
+		T* data = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		return TArrayView<T>(data, count);
+	}
+
+	/// <summary>
+	/// Releases every allocation made since the last reset. When the frame overflowed
+	/// into additional blocks they are merged into a single block large enough for it.
+	/// </summary>
+	void Reset();
+public:
+	/// <summary>
+	/// Retrieves the number of allocations made since the last reset.
+	/// </summary>
+	/// <returns>The number of allocations</returns>
+	inline uint32 GetNumAllocations() const { return mNumAllocations; }
+
+	/// <summary>
+	/// Retrieves the number of bytes allocated since the last reset.
+	/// </summary>
+	/// <returns>The number of bytes</returns>
+	inline SIZE_T GetBytesUsed() const { return mBytesUsed; }
+
+	/// <summary>
+	/// Retrieves the largest number of bytes allocated within a single frame.
+	/// </summary>
+	/// <returns>The number of bytes</returns>
+	inline SIZE_T GetPeakBytesUsed() const { return FMath::Max(mPeakBytesUsed, mBytesUsed); }
+
+	/// <summary>
+	/// Retrieves the number of blocks requested from the heap over the arena's lifetime.
+	/// </summary>
+	/// <returns>The number of heap allocations</returns>
+	inline uint32 GetNumHeapAllocations() const { return mNumHeapAllocations; }
+private:
+	/// <summary>
+	/// Appends a new block to the arena.
+	/// </summary>
+	/// <param name="size">The block size in bytes</param>
+	void AddBlock(SIZE_T size);
+private:
+	struct FBlock
+	{
+		uint8* mpData = nullptr;
+		SIZE_T mSize = 0;
+	};
+
+	std::vector<FBlock> mBlocks;
+	size_t mCurrentBlock = 0;
+	SIZE_T mOffset = 0;
+
+	uint32 mNumAllocations = 0;
+	SIZE_T mBytesUsed = 0;
+	SIZE_T mPeakBytesUsed = 0;
+	uint32 mNumHeapAllocations = 0;
+};
@@ -0,0 +1,530 @@
+#include "HeadlessDungeon.h"
+
+#include "Engine/World.h"
+
+std::shared_ptr<FDungeonLayout> FDungeonLayout::Capture(UWorld* world,
+														const FBox& bounds,
+														float cellSize_cm,
+														float traceHeight_cm,
+														const TArray<AActor*>& ignoredActors)
+{
+	if (!world || !bounds.IsValid || cellSize_cm <= 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid Dungeon Layout Capture Parameters!"));
+		return nullptr;
+	}
+
+	std::shared_ptr<FDungeonLayout> layout = std::make_shared<FDungeonLayout>();
+	layout->mOrigin = FVector2D(bounds.Min.X, bounds.Min.Y);
+	layout->mCellSize_cm = cellSize_cm;
+	layout->mTraceHeight_cm = traceHeight_cm;
+	layout->mWidth = FMath::Max(1, FMath::CeilToInt((bounds.Max.X - bounds.Min.X) / cellSize_cm));
+	layout->mHeight = FMath::Max(1, FMath::CeilToInt((bounds.Max.Y - bounds.Min.Y) / cellSize_cm));
+	layout->mCells.resize(static_cast<size_t>(layout->mWidth) * layout->mHeight, EDungeonCell::Open);
+
+	FCollisionQueryParams Params;
+	Params.AddIgnoredActors(ignoredActors);
+
+	const float halfCell = cellSize_cm * 0.5f;
+	const FVector axes[] = { FVector::ForwardVector, FVector::RightVector };
+
+	for (int32 y = 0; y < layout->mHeight; ++y)
+	{
+		for (int32 x = 0; x < layout->mWidth; ++x)
+		{
+			const FVector center(layout->mOrigin.X + (x + 0.5f) * cellSize_cm,
+								 layout->mOrigin.Y + (y + 0.5f) * cellSize_cm,
+								 traceHeight_cm);
+
+			// Cross the cell with the same channel and height as the perception rays.
+			for (const FVector& axis : axes)
+			{
+				FHitResult Hit;
+				if (!world->LineTraceSingleByChannel(Hit,
+													 center - axis * halfCell,
+													 center + axis * halfCell,
+													 ECC_WorldStatic,
+													 Params))
+				{
+					continue;
+				}
+
+				EDungeonCell& cell = layout->mCells[static_cast<size_t>(y) * layout->mWidth + x];
+				if (Hit.Component.IsValid() && Hit.Component->GetCollisionObjectType() == ECC_DungeonHazard)
+				{
+					cell = EDungeonCell::Hazard;
+					break;
+				}
+
+				cell = EDungeonCell::Wall;
+			}
+		}
+	}
+
+	return layout;
+}
+
+EDungeonCell FDungeonLayout::GetCell(int32 x, int32 y) const
+{
+	if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+		return EDungeonCell::Open;
+
+	return mCells[static_cast<size_t>(y) * mWidth + x];
+}
+
+bool FDungeonLayout::IsOpen(const FBox2D& area) const
+{
+	const int32 minX = FMath::FloorToInt((area.Min.X - mOrigin.X) / mCellSize_cm);
+	const int32 maxX = FMath::FloorToInt((area.Max.X - mOrigin.X) / mCellSize_cm);
+	const int32 minY = FMath::FloorToInt((area.Min.Y - mOrigin.Y) / mCellSize_cm);
+	const int32 maxY = FMath::FloorToInt((area.Max.Y - mOrigin.Y) / mCellSize_cm);
+
+	for (int32 y = minY; y <= maxY; ++y)
+	{
+		for (int32 x = minX; x <= maxX; ++x)
+		{
+			if (GetCell(x, y) != EDungeonCell::Open)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool FDungeonLayout::IsTouching(const FVector& location,
+								float radius_cm,
+								EDungeonCell type) const
+{
+	const float localX = location.X - mOrigin.X;
+	const float localY = location.Y - mOrigin.Y;
+
+	const int32 minX = FMath::FloorToInt((localX - radius_cm) / mCellSize_cm);
+	const int32 maxX = FMath::FloorToInt((localX + radius_cm) / mCellSize_cm);
+	const int32 minY = FMath::FloorToInt((localY - radius_cm) / mCellSize_cm);
+	const int32 maxY = FMath::FloorToInt((localY + radius_cm) / mCellSize_cm);
+
+	const float radiusSq = radius_cm * radius_cm;
+
+	for (int32 y = minY; y <= maxY; ++y)
+	{
+		for (int32 x = minX; x <= maxX; ++x)
+		{
+			if (GetCell(x, y) != type)
+				continue;
+
+			// Closest point of the cell to the circle center.
+			const float closestX = FMath::Clamp(localX, x * mCellSize_cm, (x + 1) * mCellSize_cm);
+			const float closestY = FMath::Clamp(localY, y * mCellSize_cm, (y + 1) * mCellSize_cm);
+
+			if (FMath::Square(localX - closestX) + FMath::Square(localY - closestY) <= radiusSq)
+				return true;
+		}
+	}
+	return false;
+}
+
+FVector FDungeonLayout::Sweep(const FVector& start,
+							  const FVector& delta,
+							  float radius_cm,
+							  EDungeonCell type) const
+{
+	const FVector target = start + delta;
+	if (!IsTouching(target, radius_cm, type))
+		return target;
+
+	// Bisects the blocked offset down to about a centimeter, so the circle
+	// comes to rest against the wall like a swept collision would.
+	const int32 iterations = FMath::Clamp(FMath::CeilLogTwo(static_cast<uint32>(FMath::CeilToInt(delta.Size()))), 0, 16);
+
+	float reachable = 0;
+	float blocked = 1;
+	for (int32 i = 0; i < iterations; ++i)
+	{
+		const float fraction = (reachable + blocked) * 0.5f;
+		if (IsTouching(start + delta * fraction, radius_cm, type))
+			blocked = fraction;
+		else
+			reachable = fraction;
+	}
+	return start + delta * reachable;
+}
+
+float FDungeonLayout::CastRay(const FVector& start,
+							  const FVector& direction,
+							  float maxDistance_cm,
+							  EDungeonCell& outCell) const
+{
+	outCell = EDungeonCell::Open;
+
+	const float gridX = (start.X - mOrigin.X) / mCellSize_cm;
+	const float gridY = (start.Y - mOrigin.Y) / mCellSize_cm;
+
+	int32 x = FMath::FloorToInt(gridX);
+	int32 y = FMath::FloorToInt(gridY);
+
+	const int32 stepX = direction.X > 0 ? 1 : -1;
+	const int32 stepY = direction.Y > 0 ? 1 : -1;
+
+	const float tDeltaX = FMath::IsNearlyZero(direction.X) ? TNumericLimits<float>::Max() : FMath::Abs(mCellSize_cm / direction.X);
+	const float tDeltaY = FMath::IsNearlyZero(direction.Y) ? TNumericLimits<float>::Max() : FMath::Abs(mCellSize_cm / direction.Y);
+
+	float tMaxX = TNumericLimits<float>::Max();
+	if (!FMath::IsNearlyZero(direction.X))
+		tMaxX = (direction.X > 0 ? (x + 1) - gridX : gridX - x) * tDeltaX;
+
+	float tMaxY = TNumericLimits<float>::Max();
+	if (!FMath::IsNearlyZero(direction.Y))
+		tMaxY = (direction.Y > 0 ? (y + 1) - gridY : gridY - y) * tDeltaY;
+
+	// The starting cell is skipped, a trace does not report the geometry it begins inside of.
+	while (true)
+	{
+		float t = 0;
+		if (tMaxX < tMaxY)
+		{
+			t = tMaxX;
+			tMaxX += tDeltaX;
+			x += stepX;
+		}
+		else
+		{
+			t = tMaxY;
+			tMaxY += tDeltaY;
+			y += stepY;
+		}
+
+		if (t > maxDistance_cm)
+			break;
+
+		// Left the captured region heading outwards.
+		if ((x < 0 && stepX < 0) || (x >= mWidth && stepX > 0) ||
+			(y < 0 && stepY < 0) || (y >= mHeight && stepY > 0))
+		{
+			break;
+		}
+
+		const EDungeonCell cell = GetCell(x, y);
+		if (cell != EDungeonCell::Open)
+		{
+			outCell = cell;
+			return t;
+		}
+	}
+
+	return maxDistance_cm;
+}
+
+
+FHeadlessDungeon::FHeadlessDungeon(std::shared_ptr<const FDungeonLayout> layout,
+								   const FHeadlessDungeonSettings& settings,
+								   const TArray<FVector>& spawnPoints,
+								   const TArray<FVector>& coinPoints,
+								   int32 seed)
+	: mpLayout(std::move(layout)),
+	mSettings(settings),
+	mSpawnPoints(spawnPoints),
+	mCoinPoints(coinPoints),
+	mRandom(seed),
+	mpRewardKernel(settings.mpRewardKernel ? settings.mpRewardKernel : FRewardKernel::GetDefault())
+{
+}
+
+int32 FHeadlessDungeon::AddAgent(const FVector& treasureLocation)
+{
+	const int32 index = GetNumAgents();
+
+	FHeadlessAgent& agent = mAgents.emplace_back();
+	agent.mId = mAgentIdOffset + index;
+	agent.mTreasureLocation = treasureLocation;
+	agent.mVisitedCoins.Init(false, mCoinPoints.Num());
+
+	ResetAgent(index);
+	return index;
+}
+
+void FHeadlessDungeon::ResetAgent(int32 index)
+{
+	const FVector location = mSpawnPoints.IsEmpty() ? mAgents[index].mLocation : mSpawnPoints[mRandom.RandRange(0, mSpawnPoints.Num() - 1)];
+
+	ResetAgent(index, location, mAgents[index].mTreasureLocation);
+}
+
+void FHeadlessDungeon::ResetAgent(int32 index,
+								  const FVector& location,
+								  const FVector& treasureLocation)
+{
+	FHeadlessAgent& agent = mAgents[index];
+
+	agent.mLocation = location;
+	agent.mTreasureLocation = treasureLocation;
+
+	agent.mLastDirection = EMoveDirection::None;
+	agent.mLastDirection_f = 0;
+
+	agent.mTime_s = 0;
+	agent.mEpisodeTime_s = 0;
+
+	agent.mVisitedCoins.Init(false, mCoinPoints.Num());
+	agent.mCoinsCollected = 0;
+
+	agent.mActive = true;
+	agent.mEpisodeOutcome = ETransitionEvent::Decision;
+
+	agent.mLastTreasureDistance = FVector::Distance(agent.mTreasureLocation, agent.mLocation);
+	agent.mLastCoinDistance = DistanceToNearestCoin(agent);
+
+	Observe(agent, agent.mState);
+}
+
+void FHeadlessDungeon::Step(float deltaTime,
+							std::vector<int32>& outDecisions,
+							std::vector<TrainingInfo>& outTransitions)
+{
+	mRewardBatch.Reset();
+	mDecidingAgents.clear();
+
+	for (int32 i = 0; i < GetNumAgents(); ++i)
+	{
+		FHeadlessAgent& agent = mAgents[i];
+		if (!agent.mActive)
+			continue;
+
+		if (agent.mTime_s < mSettings.mTimeBetweenDirectionSwap_s)
+		{
+			Move(agent, deltaTime);
+			agent.mTime_s += deltaTime;
+			agent.mEpisodeTime_s += deltaTime;
+
+			ResolveContacts(i, outTransitions);
+		}
+		else
+		{
+			agent.mTime_s = 0;
+
+			mRewardBatch.Add(agent.mState.mRayCollisionHitTypes,
+							 agent.mLastTreasureDistance,
+							 FVector::Distance(agent.mTreasureLocation, agent.mLocation),
+							 agent.mLastCoinDistance,
+							 DistanceToNearestCoin(agent));
+			mDecidingAgents.push_back(i);
+		}
+	}
+
+	if (mDecidingAgents.empty())
+		return;
+
+	mRewards.resize(mDecidingAgents.size());
+	mpRewardKernel->Evaluate(mRewardBatch, mRewards.data());
+
+	for (size_t decision = 0; decision < mDecidingAgents.size(); ++decision)
+	{
+		const int32 i = mDecidingAgents[decision];
+		FHeadlessAgent& agent = mAgents[i];
+
+		agent.mLastCoinDistance = mRewardBatch.mCoinDistance[decision];
+
+		// Observe the state the next decision is made from.
+		agent.mLastTreasureDistance = mRewardBatch.mTreasureDistance[decision];
+
+		TrainingStateInfo nextState;
+		Observe(agent, nextState);
+
+		if (mAutoReset && mSettings.mMaxEpisodeTime_s > 0 && agent.mEpisodeTime_s >= mSettings.mMaxEpisodeTime_s)
+		{
+			EmitTransition(agent, mRewards[decision], ETransitionEvent::Timeout, &nextState, outTransitions);
+			ResetAgent(i);
+			continue;
+		}
+
+		EmitTransition(agent, mRewards[decision], ETransitionEvent::Decision, &nextState, outTransitions);
+
+		agent.mState = std::move(nextState);
+
+		outDecisions.push_back(i);
+	}
+}
+
+void FHeadlessDungeon::RequestDecision(int32 index)
+{
+	mAgents[index].mTime_s = mSettings.mTimeBetweenDirectionSwap_s;
+}
+
+void FHeadlessDungeon::ApplyDecision(int32 index,
+									 EMoveDirection direction,
+									 float direction_f)
+{
+	FHeadlessAgent& agent = mAgents[index];
+	agent.mLastDirection = direction;
+	agent.mLastDirection_f = direction_f;
+}
+
+void FHeadlessDungeon::GetObservation(int32 index,
+									  std::vector<float>& outState) const
+{
+	AppendStateInputs(mAgents[index].mState, outState);
+}
+
+void FHeadlessDungeon::Observe(const FHeadlessAgent& agent,
+							   TrainingStateInfo& outState) const
+{
+	outState.mTreasureDistance = FVector::Distance(agent.mTreasureLocation, agent.mLocation);
+
+	const float maxDistance = mSettings.mMaxTraceDistance_cm;
+
+	for (int32 i = 0; i < NumRayCasts; i++)
+	{
+		float AngleRad = FMath::DegreesToRadians((360.f / NumRayCasts) * i);
+		FVector Direction = FVector(FMath::Cos(AngleRad), FMath::Sin(AngleRad), 0.f);
+
+		EDungeonCell cell;
+		float distance = mpLayout->CastRay(agent.mLocation, Direction, maxDistance, cell);
+
+		float type = RayHitType::None;
+		if (cell == EDungeonCell::Wall)
+			type = RayHitType::Wall;
+		else if (cell == EDungeonCell::Hazard)
+			type = RayHitType::Hazard;
+
+		// Dynamic objects are resolved analytically, visited coins are ignored like the traced version.
+		float hitDistance = 0;
+		for (int32 coin = 0; coin < mCoinPoints.Num(); ++coin)
+		{
+			if (agent.mVisitedCoins[coin])
+				continue;
+
+			if (RayCircleIntersect(agent.mLocation, Direction, mCoinPoints[coin], mSettings.mPickupRadius_cm, hitDistance) &&
+				hitDistance < distance)
+			{
+				distance = hitDistance;
+				type = RayHitType::Coin;
+			}
+		}
+
+		if (RayCircleIntersect(agent.mLocation, Direction, agent.mTreasureLocation, mSettings.mPickupRadius_cm, hitDistance) &&
+			hitDistance < distance)
+		{
+			distance = hitDistance;
+			type = RayHitType::Treasure;
+		}
+
+		// Normalize to [0,1]
+		outState.mRayCollisionDistances[i] = distance / maxDistance;
+		outState.mRayCollisionHitTypes[i] = type;
+	}
+}
+
+void FHeadlessDungeon::Move(FHeadlessAgent& agent,
+							float deltaTime) const
+{
+	// Dungeon actors are never rotated, so forward is +X and right is +Y.
+	FVector MovementVector;
+	switch (agent.mLastDirection)
+	{
+	case EMoveDirection::Forward:
+		MovementVector = FVector::ForwardVector;
+		break;
+	case EMoveDirection::Backward:
+		MovementVector = -FVector::ForwardVector;
+		break;
+	case EMoveDirection::Left:
+		MovementVector = -FVector::RightVector;
+		break;
+	case EMoveDirection::Right:
+		MovementVector = FVector::RightVector;
+		break;
+	default:
+		return; // No movement for None
+	}
+
+	// Blocked moves stop at the wall like the swept actor movement.
+	agent.mLocation = mpLayout->Sweep(agent.mLocation,
+									  MovementVector * mSettings.mMoveSpeed * deltaTime,
+									  mSettings.mAgentRadius_cm,
+									  EDungeonCell::Wall);
+}
+
+void FHeadlessDungeon::ResolveContacts(int32 index,
+									   std::vector<TrainingInfo>& outTransitions)
+{
+	FHeadlessAgent& agent = mAgents[index];
+
+	if (mpLayout->IsTouching(agent.mLocation, mSettings.mAgentRadius_cm, EDungeonCell::Hazard))
+	{
+		EmitTransition(agent, mpRewardKernel->EvaluateEvent(ETransitionEvent::Death), ETransitionEvent::Death, nullptr, outTransitions);
+		EndEpisode(index, ETransitionEvent::Death);
+		return;
+	}
+
+	const float pickupDistanceSq = FMath::Square(mSettings.mAgentRadius_cm + mSettings.mPickupRadius_cm);
+
+	if (FVector::DistSquared2D(agent.mLocation, agent.mTreasureLocation) <= pickupDistanceSq)
+	{
+		EmitTransition(agent, mpRewardKernel->EvaluateEvent(ETransitionEvent::FoundTreasure), ETransitionEvent::FoundTreasure, nullptr, outTransitions);
+		EndEpisode(index, ETransitionEvent::FoundTreasure);
+		return;
+	}
+
+	for (int32 coin = 0; coin < mCoinPoints.Num(); ++coin)
+	{
+		if (agent.mVisitedCoins[coin])
+			continue;
+
+		if (FVector::DistSquared2D(agent.mLocation, mCoinPoints[coin]) <= pickupDistanceSq)
+		{
+			agent.mVisitedCoins[coin] = true;
+			agent.mCoinsCollected++;
+
+			TrainingStateInfo nextState;
+			Observe(agent, nextState);
+
+			EmitTransition(agent, mpRewardKernel->EvaluateEvent(ETransitionEvent::FoundCoin), ETransitionEvent::FoundCoin, &nextState, outTransitions);
+		}
+	}
+}
+
+void FHeadlessDungeon::EndEpisode(int32 index,
+								  ETransitionEvent outcome)
+{
+	if (mAutoReset)
+	{
+		ResetAgent(index);
+		return;
+	}
+
+	FHeadlessAgent& agent = mAgents[index];
+	agent.mActive = false;
+	agent.mEpisodeOutcome = outcome;
+}
+
+float FHeadlessDungeon::DistanceToNearestCoin(const FHeadlessAgent& agent) const
+{
+	float nearestDistance = TNumericLimits<float>::Max();
+	for (int32 coin = 0; coin < mCoinPoints.Num(); ++coin)
+	{
+		// Prevent counting already visited coins.
+		if (agent.mVisitedCoins[coin])
+			continue;
+
+		float dist = FVector::Distance(mCoinPoints[coin], agent.mLocation);
+		if (dist < nearestDistance)
+			nearestDistance = dist;
+	}
+	return nearestDistance;
+}
+
+void FHeadlessDungeon::EmitTransition(const FHeadlessAgent& agent,
+									  float reward,
+									  ETransitionEvent event,
+									  const TrainingStateInfo* nextState,
+									  std::vector<TrainingInfo>& outTransitions) const
+{
+	TrainingInfo& info = outTransitions.emplace_back();
+	info.mDirection = agent.mLastDirection;
+	info.mDirection_f = agent.mLastDirection_f;
+	info.mReward = reward;
+	info.mEvent = event;
+	info.mState = agent.mState;
+	info.mAgentId = agent.mId;
+
+	if (nextState)
+		info.mNextState = *nextState;
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+
+#include "NPCDefines.h"
+#include "DungeonRewards.h"
+
+#include <memory>
+#include <vector>
+
+class UWorld;
+
+
+/// <summary>
+/// Cell classification of the captured dungeon occupancy grid.
+/// </summary>
+enum class EDungeonCell : uint8
+{
+	Open,
+	Wall,
+	Hazard
+};
+
+
+/// <summary>
+/// A world-free occupancy snapshot of the dungeon, captured once
+/// from the level geometry and shared read-only between threads.
+/// </summary>
+struct FDungeonLayout
+{
+public:
+	/// <summary>
+	/// Captures the static dungeon geometry at the trace height into an occupancy grid.
+	/// </summary>
+	/// <param name="world">The world to capture from</param>
+	/// <param name="bounds">The region of the dungeon to capture</param>
+	/// <param name="cellSize_cm">The grid cell size</param>
+	/// <param name="traceHeight_cm">The height the perception rays are cast at</param>
+	/// <param name="ignoredActors">The dynamic actors excluded from the capture</param>
+	/// <returns>The captured layout, or nullptr on failure</returns>
+	static std::shared_ptr<FDungeonLayout> Capture(UWorld* world,
+												   const FBox& bounds,
+												   float cellSize_cm,
+												   float traceHeight_cm,
+												   const TArray<AActor*>& ignoredActors);
+public:
+	/// <summary>
+	/// Retrieves the classification of a grid cell, out of bounds cells are open.
+	/// </summary>
+	/// <param name="x">The cell x index</param>
+	/// <param name="y">The cell y index</param>
+	/// <returns>The cell classification</returns>
+	EDungeonCell GetCell(int32 x, int32 y) const;
+
+	/// <summary>
+	/// Checks whether every cell overlapping an area is open.
+	/// </summary>
+	/// <param name="area">The area in world space</param>
+	/// <returns>True if the area is free space</returns>
+	bool IsOpen(const FBox2D& area) const;
+
+	/// <summary>
+	/// Checks whether a circle at the location touches any cell of the specified type.
+	/// </summary>
+	/// <param name="location">The circle center</param>
+	/// <param name="radius_cm">The circle radius</param>
+	/// <param name="type">The cell type to test against</param>
+	/// <returns>True if touching</returns>
+	bool IsTouching(const FVector& location,
+					float radius_cm,
+					EDungeonCell type) const;
+
+	/// <summary>
+	/// Moves a circle by an offset, stopping where it touches a cell of the specified type.
+	/// </summary>
+	/// <param name="start">The circle center</param>
+	/// <param name="delta">The offset to move by</param>
+	/// <param name="radius_cm">The circle radius</param>
+	/// <param name="type">The cell type blocking the movement</param>
+	/// <returns>The furthest reachable circle center along the offset</returns>
+	FVector Sweep(const FVector& start,
+				  const FVector& delta,
+				  float radius_cm,
+				  EDungeonCell type) const;
+
+	/// <summary>
+	/// Marches a ray through the grid until it reaches a non-open cell.
+	/// </summary>
+	/// <param name="start">The ray origin</param>
+	/// <param name="direction">The normalized ray direction in the XY plane</param>
+	/// <param name="maxDistance_cm">The maximum ray distance</param>
+	/// <param name="outCell">The type of cell hit, Open if nothing was hit</param>
+	/// <returns>The hit distance or the maximum distance</returns>
+	float CastRay(const FVector& start,
+				  const FVector& direction,
+				  float maxDistance_cm,
+				  EDungeonCell& outCell) const;
+public:
+	FVector2D mOrigin = FVector2D::ZeroVector;
+	float mCellSize_cm = 25.0f;
+	float mTraceHeight_cm = 0.0f;
+
+	int32 mWidth = 0;
+	int32 mHeight = 0;
+
+	std::vector<EDungeonCell> mCells;
+};
+
+
+/// <summary>
+/// Agent tuning mirrored from the ALearningNPCActor template.
+/// </summary>
+struct FHeadlessDungeonSettings
+{
+	float mMoveSpeed = 1000.0f;
+	float mTimeBetweenDirectionSwap_s = 10.0f;
+	float mMaxTraceDistance_cm = 1000.0f;
+	float mAgentRadius_cm = 200.0f;
+	float mPickupRadius_cm = 50.0f;
+
+	// Auto resetting agents time out after this long, 0 for unlimited episodes.
+	float mMaxEpisodeTime_s = 0;
+
+	// The compiled reward terms, the default rewards if not set.
+	std::shared_ptr<const FRewardKernel> mpRewardKernel = nullptr;
+};
+
+
+/// <summary>
+/// The state of a single headless agent.
+/// </summary>
+struct FHeadlessAgent
+{
+	int32 mId = INDEX_NONE;
+
+	FVector mLocation = FVector::ZeroVector;
+	FVector mTreasureLocation = FVector::ZeroVector;
+
+	EMoveDirection mLastDirection = EMoveDirection::None;
+	float mLastDirection_f = 0;
+
+	float mTime_s = 0;
+	float mEpisodeTime_s = 0;
+
+	float mLastTreasureDistance = 0;
+	float mLastCoinDistance = 0;
+
+	TrainingStateInfo mState;
+
+	TBitArray<> mVisitedCoins;
+	int32 mCoinsCollected = 0;
+
+	// Cleared when the episode ends and the dungeon does not reset agents automatically.
+	bool mActive = true;
+	ETransitionEvent mEpisodeOutcome = ETransitionEvent::Decision;
+};
+
+
+/// <summary>
+/// A headless dungeon instance stepping agents with the ALearningNPCActor
+/// movement and reward rules against a captured FDungeonLayout.
+/// </summary>
+class FHeadlessDungeon
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FHeadlessDungeon instance.
+	/// </summary>
+	/// <param name="layout">The shared dungeon layout</param>
+	/// <param name="settings">The agent settings</param>
+	/// <param name="spawnPoints">The agent spawn points</param>
+	/// <param name="coinPoints">The coin locations</param>
+	/// <param name="seed">The random seed</param>
+	FHeadlessDungeon(std::shared_ptr<const FDungeonLayout> layout,
+					 const FHeadlessDungeonSettings& settings,
+					 const TArray<FVector>& spawnPoints,
+					 const TArray<FVector>& coinPoints,
+					 int32 seed);
+public:
+	/// <summary>
+	/// Adds a new agent searching for the specified treasure location.
+	/// </summary>
+	/// <param name="treasureLocation">The treasure location</param>
+	/// <returns>The agent index</returns>
+	int32 AddAgent(const FVector& treasureLocation);
+
+	/// <summary>
+	/// Retrieves the number of agents in the dungeon.
+	/// </summary>
+	/// <returns>The number of agents</returns>
+	inline int32 GetNumAgents() const { return static_cast<int32>(mAgents.size()); }
+
+	/// <summary>
+	/// Retrieves an agent's state.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	/// <returns>The agent</returns>
+	inline const FHeadlessAgent& GetAgent(int32 index) const { return mAgents[index]; }
+
+	/// <summary>
+	/// Resets an agent to a random spawn point.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	void ResetAgent(int32 index);
+
+	/// <summary>
+	/// Resets an agent to a specific location and treasure.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	/// <param name="location">The spawn location</param>
+	/// <param name="treasureLocation">The treasure location</param>
+	void ResetAgent(int32 index,
+					const FVector& location,
+					const FVector& treasureLocation);
+
+	/// <summary>
+	/// Sets whether agents are respawned when their episode ends,
+	/// otherwise they stay inactive until reset.
+	/// </summary>
+	/// <param name="autoReset">Whether to reset finished agents</param>
+	inline void SetAutoReset(bool autoReset) { mAutoReset = autoReset; }
+
+	/// <summary>
+	/// Sets the id of the first agent added to the dungeon, later agents are numbered consecutively.
+	/// </summary>
+	/// <param name="agentIdOffset">The first agent id</param>
+	inline void SetAgentIdOffset(int32 agentIdOffset) { mAgentIdOffset = agentIdOffset; }
+
+	/// <summary>
+	/// Makes an agent decide on its next step instead of waiting for the decision interval.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	void RequestDecision(int32 index);
+
+	/// <summary>
+	/// Advances every active agent by the time step, collecting the agents that require a new
+	/// direction decision and the training transitions produced during the step. The rewards
+	/// of all deciding agents are evaluated as one batch.
+	/// </summary>
+	/// <param name="deltaTime">The time step</param>
+	/// <param name="outDecisions">The indices of agents awaiting a decision</param>
+	/// <param name="outTransitions">The produced training transitions</param>
+	void Step(float deltaTime,
+			  std::vector<int32>& outDecisions,
+			  std::vector<TrainingInfo>& outTransitions);
+
+	/// <summary>
+	/// Applies a selected direction to an agent awaiting a decision.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	/// <param name="direction">The selected direction</param>
+	/// <param name="direction_f">The raw action value</param>
+	void ApplyDecision(int32 index,
+					   EMoveDirection direction,
+					   float direction_f);
+
+	/// <summary>
+	/// Writes the agent's last observation as a flat model input.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	/// <param name="outState">The output state, StateSize floats are appended</param>
+	void GetObservation(int32 index,
+						std::vector<float>& outState) const;
+private:
+	/// <summary>
+	/// Casts the perception rays from the agent's location.
+	/// </summary>
+	/// <param name="agent">The agent</param>
+	/// <param name="outState">The output observation</param>
+	void Observe(const FHeadlessAgent& agent,
+				 TrainingStateInfo& outState) const;
+
+	/// <summary>
+	/// Moves an agent, stopping it at walls.
+	/// </summary>
+	/// <param name="agent">The agent</param>
+	/// <param name="deltaTime">The time step</param>
+	void Move(FHeadlessAgent& agent,
+			  float deltaTime) const;
+
+	/// <summary>
+	/// Resolves coin, treasure and hazard contacts of an agent.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	/// <param name="outTransitions">The produced training transitions</param>
+	void ResolveContacts(int32 index,
+						 std::vector<TrainingInfo>& outTransitions);
+
+	/// <summary>
+	/// Ends an agent's episode, resetting it when auto reset is enabled.
+	/// </summary>
+	/// <param name="index">The agent index</param>
+	/// <param name="outcome">The terminal event</param>
+	void EndEpisode(int32 index,
+					ETransitionEvent outcome);
+
+	/// <summary>
+	/// Finds the closest unvisited coin distance to the agent.
+	/// </summary>
+	/// <param name="agent">The agent</param>
+	/// <returns>The distance</returns>
+	float DistanceToNearestCoin(const FHeadlessAgent& agent) const;
+
+	/// <summary>
+	/// Appends the agent's last decision state with a reward to the transitions.
+	/// </summary>
+	/// <param name="agent">The agent</param>
+	/// <param name="reward">The reward</param>
+	/// <param name="event">The event producing the transition</param>
+	/// <param name="nextState">The state following the transition, nullptr if terminal</param>
+	/// <param name="outTransitions">The produced training transitions</param>
+	void EmitTransition(const FHeadlessAgent& agent,
+						float reward,
+						ETransitionEvent event,
+						const TrainingStateInfo* nextState,
+						std::vector<TrainingInfo>& outTransitions) const;
+private:
+	std::shared_ptr<const FDungeonLayout> mpLayout;
+	FHeadlessDungeonSettings mSettings;
+
+	TArray<FVector> mSpawnPoints;
+	TArray<FVector> mCoinPoints;
+
+	std::vector<FHeadlessAgent> mAgents;
+	bool mAutoReset = true;
+	int32 mAgentIdOffset = 0;
+
+	FRandomStream mRandom;
+
+	std::shared_ptr<const FRewardKernel> mpRewardKernel;
+	FRewardBatch mRewardBatch;
+	std::vector<float> mRewards;
+	std::vector<int32> mDecidingAgents;
+};
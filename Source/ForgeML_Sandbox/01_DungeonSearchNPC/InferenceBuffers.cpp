@@ -0,0 +1,69 @@
+#include "InferenceBuffers.h"
+
+void FInferenceBufferPool::Reserve(int32 numBuffers,
+								   int32 batchSize)
+{
+	const std::scoped_lock lock(mMutex);
+
+	while (static_cast<int32>(mFree.size()) < numBuffers)
+		mFree.emplace_back(CreateBuffers());
+
+	for (const std::unique_ptr<FInferenceBuffers>& buffers : mFree)
+		Presize(*buffers, batchSize);
+}
+
+std::unique_ptr<FInferenceBuffers> FInferenceBufferPool::Acquire(int32 batchSize)
+{
+	std::unique_ptr<FInferenceBuffers> buffers;
+	{
+		const std::scoped_lock lock(mMutex);
+		if (!mFree.empty())
+		{
+			buffers = std::move(mFree.back());
+			mFree.pop_back();
+		}
+	}
+
+	if (!buffers)
+		buffers = CreateBuffers();
+
+	// A batch larger than any reserved for grows the buffer on the thread about to run the model.
+	if (buffers->mInputs.capacity() < static_cast<size_t>(batchSize) * StateSize)
+	{
+		Presize(*buffers, batchSize);
+		mNumReallocations++;
+	}
+
+	return buffers;
+}
+
+void FInferenceBufferPool::Release(std::unique_ptr<FInferenceBuffers> buffers)
+{
+	const std::scoped_lock lock(mMutex);
+	mFree.emplace_back(std::move(buffers));
+}
+
+std::unique_ptr<FInferenceBuffers> FInferenceBufferPool::CreateBuffers()
+{
+	std::unique_ptr<FInferenceBuffers> buffers = std::make_unique<FInferenceBuffers>();
+	buffers->mpBuilder = std::make_unique<TF::FlatFloatDataBuilder>(StateSize, std::vector<int64_t>{ StateSize });
+	buffers->mSample.reserve(StateSize);
+	return buffers;
+}
+
+void FInferenceBufferPool::Presize(FInferenceBuffers& buffers,
+								   int32 batchSize)
+{
+	if (buffers.mInputs.capacity() >= static_cast<size_t>(batchSize) * StateSize)
+		return;
+
+	buffers.mInputs.reserve(static_cast<size_t>(batchSize) * StateSize);
+
+	// Staging a full batch once grows the builder's storage, later batches up to this size reuse it.
+	buffers.mSample.assign(StateSize, 0.0f);
+	for (int32 i = 0; i < batchSize; ++i)
+		buffers.mpBuilder->AddInputTensor("state", buffers.mSample);
+
+	TF::LabeledTensor discarded;
+	buffers.mpBuilder->CreateTensor(discarded);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NPCDefines.h"
+
+#include "TFModelLib.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/// <summary>
+/// The staging buffers of a single batched model run.
+/// </summary>
+struct FInferenceBuffers
+{
+	std::unique_ptr<TF::FlatFloatDataBuilder> mpBuilder;
+
+	// The batch after input normalization.
+	std::vector<float> mInputs;
+
+	// A single state handed to the builder.
+	std::vector<float> mSample;
+};
+
+
+/// <summary>
+/// A pool of inference staging buffers shared by every thread running batched
+/// inference. Buffers are pre-sized for the expected batch sizes up front, so
+/// the model runs during play reuse them instead of growing fresh ones.
+/// </summary>
+class FInferenceBufferPool
+{
+public:
+	/// <summary>
+	/// Makes sure a number of buffers are pooled, each sized for a batch size.
+	/// </summary>
+	/// <param name="numBuffers">The number of buffers, one per thread running inference concurrently</param>
+	/// <param name="batchSize">The batch size</param>
+	void Reserve(int32 numBuffers,
+				 int32 batchSize);
+
+	/// <summary>
+	/// Takes a buffer from the pool, creating or growing one if none fits the batch.
+	/// </summary>
+	/// <param name="batchSize">The batch size about to be staged</param>
+	/// <returns>The buffer</returns>
+	std::unique_ptr<FInferenceBuffers> Acquire(int32 batchSize);
+
+	/// <summary>
+	/// Returns a buffer to the pool.
+	/// </summary>
+	/// <param name="buffers">The buffer</param>
+	void Release(std::unique_ptr<FInferenceBuffers> buffers);
+
+	/// <summary>
+	/// Retrieves the number of times a batch did not fit the buffer it was staged in.
+	/// </summary>
+	/// <returns>The number of buffer reallocations</returns>
+	inline int32 GetNumReallocations() const { return mNumReallocations.load(std::memory_order_relaxed); }
+private:
+	/// <summary>
+	/// Creates a buffer.
+	/// </summary>
+	/// <returns>The buffer</returns>
+	static std::unique_ptr<FInferenceBuffers> CreateBuffers();
+
+	/// <summary>
+	/// Grows a buffer's storage to a batch size.
+	/// </summary>
+	/// <param name="buffers">The buffer</param>
+	/// <param name="batchSize">The batch size</param>
+	static void Presize(FInferenceBuffers& buffers,
+						int32 batchSize);
+private:
+	std::mutex mMutex;
+	std::vector<std::unique_ptr<FInferenceBuffers>> mFree;
+	std::atomic<int32> mNumReallocations = 0;
+};
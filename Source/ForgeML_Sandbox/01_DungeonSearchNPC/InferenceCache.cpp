@@ -0,0 +1,109 @@
+#include "InferenceCache.h"
+
+#include "Hash/CityHash.h"
+
+void FInferenceCache::Configure(int32 capacity,
+								float quantization,
+								float treasureQuantization_cm)
+{
+	const std::scoped_lock lock(mMutex);
+
+	mEntries.assign(static_cast<size_t>(FMath::Max(0, capacity)), FEntry());
+	mQuantization = FMath::Max(quantization, UE_KINDA_SMALL_NUMBER);
+	mTreasureQuantization_cm = FMath::Max(treasureQuantization_cm, UE_KINDA_SMALL_NUMBER);
+
+	mNumHits = 0;
+	mNumMisses = 0;
+}
+
+bool FInferenceCache::Find(TArrayView<const float> state,
+						   uint32 generation,
+						   EMoveDirection& outDirection,
+						   float& outDirection_f)
+{
+	if (mEntries.empty())
+		return false;
+
+	FKey key;
+	const uint64 hash = MakeKey(state, key);
+
+	{
+		const std::scoped_lock lock(mMutex);
+
+		const FEntry& entry = mEntries[hash % mEntries.size()];
+		if (entry.mValid && entry.mGeneration == generation && entry.mKey == key)
+		{
+			outDirection = entry.mDirection;
+			outDirection_f = entry.mDirection_f;
+
+			mNumHits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	mNumMisses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void FInferenceCache::Add(TArrayView<const float> state,
+						  uint32 generation,
+						  EMoveDirection direction,
+						  float direction_f)
+{
+	if (mEntries.empty())
+		return;
+
+	FKey key;
+	const uint64 hash = MakeKey(state, key);
+
+	const std::scoped_lock lock(mMutex);
+
+	// Direct mapped, a colliding state replaces the previous entry.
+	FEntry& entry = mEntries[hash % mEntries.size()];
+	entry.mKey = key;
+	entry.mGeneration = generation;
+	entry.mDirection = direction;
+	entry.mDirection_f = direction_f;
+	entry.mValid = true;
+}
+
+void FInferenceCache::RecordInference(double time_s,
+									  int32 count)
+{
+	mInferenceTime_us.fetch_add(static_cast<uint64>(time_s * 1000000.0), std::memory_order_relaxed);
+	mNumInferences.fetch_add(count, std::memory_order_relaxed);
+}
+
+float FInferenceCache::GetHitRate() const
+{
+	const uint64 hits = mNumHits.load();
+	const uint64 lookups = hits + mNumMisses.load();
+	return lookups > 0 ? static_cast<float>(static_cast<double>(hits) / lookups) : 0.0f;
+}
+
+double FInferenceCache::GetTimeSaved_s() const
+{
+	const uint64 inferences = mNumInferences.load();
+	if (inferences == 0)
+		return 0;
+
+	const double averageTime_s = mInferenceTime_us.load() / 1000000.0 / inferences;
+	return averageTime_s * mNumHits.load();
+}
+
+uint64 FInferenceCache::MakeKey(TArrayView<const float> state,
+								FKey& outKey) const
+{
+	check(state.Num() >= StateSize);
+
+	for (int32 i = 0; i < StateSize; ++i)
+	{
+		// The last input is the treasure distance in centimeters, the rest are normalized ray values.
+		const float step = i == StateSize - 1 ? mTreasureQuantization_cm : mQuantization;
+		const int32 quantized = FMath::FloorToInt(state[i] / step);
+
+		outKey[i] = static_cast<int16>(FMath::Clamp(quantized, MIN_int16, MAX_int16));
+	}
+
+	return CityHash64(reinterpret_cast<const char*>(outKey.data()), sizeof(FKey));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NPCDefines.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+/// <summary>
+/// A fixed capacity cache of model decisions keyed on the quantized observation.
+/// Entries are tagged with the model generation they were produced by and
+/// stale generations are treated as misses. Safe to use from multiple threads.
+/// </summary>
+class FInferenceCache
+{
+public:
+	/// <summary>
+	/// Resizes and clears the cache.
+	/// </summary>
+	/// <param name="capacity">The number of entries</param>
+	/// <param name="quantization">The quantization step of the normalized ray inputs</param>
+	/// <param name="treasureQuantization_cm">The quantization step of the treasure distance</param>
+	void Configure(int32 capacity,
+				   float quantization,
+				   float treasureQuantization_cm);
+
+	/// <summary>
+	/// Looks up the decision cached for a state.
+	/// </summary>
+	/// <param name="state">The state input, StateSize floats</param>
+	/// <param name="generation">The current model generation</param>
+	/// <param name="outDirection">The cached direction</param>
+	/// <param name="outDirection_f">The cached raw action value</param>
+	/// <returns>True on a cache hit</returns>
+	bool Find(TArrayView<const float> state,
+			  uint32 generation,
+			  EMoveDirection& outDirection,
+			  float& outDirection_f);
+
+	/// <summary>
+	/// Caches the decision the model produced for a state.
+	/// </summary>
+	/// <param name="state">The state input, StateSize floats</param>
+	/// <param name="generation">The model generation that produced the decision</param>
+	/// <param name="direction">The direction</param>
+	/// <param name="direction_f">The raw action value</param>
+	void Add(TArrayView<const float> state,
+			 uint32 generation,
+			 EMoveDirection direction,
+			 float direction_f);
+
+	/// <summary>
+	/// Records the time spent running the model, used to estimate the time saved by hits.
+	/// </summary>
+	/// <param name="time_s">The model run time</param>
+	/// <param name="count">The number of states in the run</param>
+	void RecordInference(double time_s,
+						 int32 count);
+public:
+	/// <summary>
+	/// Checks whether the cache has been configured with a capacity.
+	/// </summary>
+	/// <returns>True if enabled</returns>
+	inline bool IsEnabled() const { return !mEntries.empty(); }
+
+	/// <summary>
+	/// Retrieves the fraction of lookups that hit.
+	/// </summary>
+	/// <returns>The hit rate in [0, 1]</returns>
+	float GetHitRate() const;
+
+	/// <summary>
+	/// Retrieves the estimated model time saved by cache hits.
+	/// </summary>
+	/// <returns>The time in seconds</returns>
+	double GetTimeSaved_s() const;
+private:
+	using FKey = std::array<int16, StateSize>;
+
+	struct FEntry
+	{
+		FKey mKey {};
+		uint32 mGeneration = 0;
+		EMoveDirection mDirection = EMoveDirection::None;
+		float mDirection_f = 0;
+		bool mValid = false;
+	};
+
+	/// <summary>
+	/// Quantizes a state into a cache key.
+	/// </summary>
+	/// <param name="state">The state input, StateSize floats</param>
+	/// <param name="outKey">The output key</param>
+	/// <returns>The key hash</returns>
+	uint64 MakeKey(TArrayView<const float> state,
+				   FKey& outKey) const;
+private:
+	std::mutex mMutex;
+	std::vector<FEntry> mEntries;
+
+	float mQuantization = 0.05f;
+	float mTreasureQuantization_cm = 100.0f;
+
+	std::atomic<uint64> mNumHits = 0;
+	std::atomic<uint64> mNumMisses = 0;
+
+	std::atomic<uint64> mInferenceTime_us = 0;
+	std::atomic<uint64> mNumInferences = 0;
+};
@@ -1,13 +1,39 @@
 #include "LearningNPCActor.h"
 
+#include "DungeonObjectChannels.h"
+#include "FrameArena.h"
+
 #include "Components/CapsuleComponent.h"
 #include "Components/StaticMeshComponent.h"
 
 #include "Engine/World.h"
-#include "Kismet/GameplayStatics.h"
 
 #include "TFModelLib.h"
 
+#include <algorithm>
+
+/// <summary>
+/// Retrieves the direction of a perception ray.
+/// </summary>
+/// <param name="ray">The ray index</param>
+/// <returns>The normalized direction in the XY plane</returns>
+static FVector GetRayDirection(int32 ray)
+{
+	const float angleRad = FMath::DegreesToRadians((360.f / NumRayCasts) * ray);
+	return FVector(FMath::Cos(angleRad), FMath::Sin(angleRad), 0.f);
+}
+
+/// <summary>
+/// Classifies what a perception ray hit.
+/// </summary>
+/// <param name="hit">The blocking hit</param>
+/// <returns>The ray hit type</returns>
+static float GetRayHitType(const FHitResult& hit)
+{
+	// Dungeon objects are assigned their own object channels when spawned.
+	return GetDungeonObjectHitType(hit.Component.Get());
+}
+
 ALearningNPCActor::ALearningNPCActor()
 {
 	PrimaryActorTick.bCanEverTick = true;
@@ -22,22 +48,19 @@ void ALearningNPCActor::BeginPlay()
 	mLastCoinDistance = DistanceToNearestCoin();
 
 	// Get Current Collision Query Distances.
-	std::vector<float> collisionDistances;
-	std::vector<float> collisionTypes;
-	CastRayTraces(&collisionDistances, &collisionTypes);
-
-	mRayCollisionDistances = collisionDistances;
-	mRayCollisionHitTypes = collisionTypes;
+	CastRayTraces(mRayCollisionDistances.data(), mRayCollisionHitTypes.data());
 }
 
 void ALearningNPCActor::TickActor(float DeltaTime, 
 								  enum ELevelTick TickType, 
 								  FActorTickFunction& ThisTickFunction)
 {
-	if (mTime_s < mTimeBetweenDirectionSwap_s)
+	// Keep moving until the decision is due and the scheduler has a slot this frame.
+	if (mTime_s < mTimeBetweenDirectionSwap_s || mDecisionPending || (mDecisionScheduler && !mDecisionScheduler(this)))
 	{
 		MoveInDirection(mLastDirection, DeltaTime);
 		mTime_s += DeltaTime;
+		mEpisodeTime_s += DeltaTime;
 
 		CastRayTraces();
 	}
@@ -45,54 +68,98 @@ void ALearningNPCActor::TickActor(float DeltaTime,
 	{
 		mTime_s = 0;
 
-		// Initial small negative reward for each action to encourage efficiency
-		float reward = -0.01f;
+		TrainingStateInfo nextState;
+		if (AddDecisionTransition(nextState))
+			PickNewDirection(nextState);
+	}
+}
+
+void ALearningNPCActor::StartDecisionLoop(FAgentScheduler& scheduler)
+{
+	// The scheduler moves the actor from now on.
+	SetActorTickEnabled(false);
+
+	scheduler.Spawn(this, RunDecisionLoop(scheduler));
+}
+
+FAgentTask ALearningNPCActor::RunDecisionLoop(FAgentScheduler& scheduler)
+{
+	for (;;)
+	{
+		const float deltaTime = co_await scheduler.NextFrame();
 
-		bool canSeeTreasure = false;
-		bool canSeeCoin = false;
-		for (float hit : mRayCollisionHitTypes)
+		// Keep moving until the decision is due and the scheduler has a slot this frame.
+		if (mTime_s < mTimeBetweenDirectionSwap_s || (mDecisionScheduler && !mDecisionScheduler(this)))
 		{
-			if (hit == 4.0f) // Assuming 4.0f is the type for Treasure
-			{
-				canSeeTreasure = true;
-				break;
-			}
+			MoveInDirection(mLastDirection, deltaTime);
+			mTime_s += deltaTime;
+			mEpisodeTime_s += deltaTime;
 
-			if (hit == 3.0f)
-			{
-				canSeeCoin = true;
-			}
+			CastRayTraces();
+			continue;
 		}
 
-		// Small positive reward for keeping treasure in view
-		if (canSeeTreasure)
-			reward += 0.2f;
+		mTime_s = 0;
+
+		TrainingStateInfo state;
+		if (!AddDecisionTransition(state))
+			continue;
+
+		// Lives in the coroutine frame, the frame arena is reset while the agent is suspended.
+		std::array<float, StateSize> stateInfo;
+		WriteStateInputs(state, MakeArrayView(stateInfo));
+
+		const uint32 episode = mEpisode;
+		const float requestTime_s = GetWorld()->GetTimeSeconds();
 
-		if (canSeeCoin)
-			reward += 0.1f;
+		const auto [dir, dir_f] = co_await scheduler.Decide(MakeArrayView(stateInfo));
 
-		float distToTreasure = FVector::Distance(mTreasureLocation, GetActorLocation());
-		float delta = mLastTreasureDistance - distToTreasure;
+		// The actor was reset while the decision was batched.
+		if (episode != mEpisode)
+			continue;
 
-		reward += delta * 0.05f;
+		mLastTreasureDistance = state.mTreasureDistance;
+		mRayCollisionDistances = state.mRayCollisionDistances;
+		mRayCollisionHitTypes = state.mRayCollisionHitTypes;
 
-		if (!canSeeTreasure && delta > 0)
-			reward -= 0.1f; // penalize blind progress
+		mLastDirection = dir;
+		mLastDirection_f = dir_f;
+		mObservationLag_s = GetWorld()->GetTimeSeconds() - requestTime_s;
+	}
+}
 
+bool ALearningNPCActor::AddDecisionTransition(TrainingStateInfo& outState)
+{
+	float distToTreasure = FVector::Distance(mTreasureLocation, GetActorLocation());
+	float distToNearestCoin = DistanceToNearestCoin();
 
-		// Distance shaping for nearest coin
-		float distToNearestCoin = DistanceToNearestCoin();
-		float coinDelta = mLastCoinDistance - distToNearestCoin;
+	mRewardBatch.Reset();
+	mRewardBatch.Add(mRayCollisionHitTypes,
+					 mLastTreasureDistance,
+					 distToTreasure,
+					 mLastCoinDistance,
+					 distToNearestCoin);
 
-		if (coinDelta > 0)
-			reward += coinDelta * 0.05f; // small shaping reward
+	float reward = 0;
+	mpRewardKernel->Evaluate(mRewardBatch, &reward);
 
-		mLastCoinDistance = distToNearestCoin;
+	mLastCoinDistance = distToNearestCoin;
 
-		AddCurrentStateToTrainingData(reward);
+	// Observe the state the next direction is picked from.
+	ObserveState(outState);
 
-		PickNewDirection();
+	if (mMaxEpisodeTime_s > 0 && mEpisodeTime_s >= mMaxEpisodeTime_s)
+	{
+		// Truncated rather than terminated, the transition still bootstraps from the observed state.
+		AddCurrentStateToTrainingData(reward, ETransitionEvent::Timeout, &outState);
+
+		if (mOnResetCallback)
+			mOnResetCallback(this);
+		return false;
 	}
+
+	AddCurrentStateToTrainingData(reward, ETransitionEvent::Decision, &outState);
+	return true;
 }
 
 void ALearningNPCActor::ResetActor(const FVector& location)
@@ -100,16 +167,27 @@ void ALearningNPCActor::ResetActor(const FVector& location)
 	ABaseDungeonActor::ResetActor(location);
 
 	mLastDirection = EMoveDirection::None;
+
+	// A decision still in flight belongs to the previous episode.
+	mDecisionPending = false;
+	mEpisode++;
+	mEpisodeTime_s = 0;
+	mTraceParamsDirty = true;
 }
 
 void ALearningNPCActor::OnFoundCoin()
 {
-	AddCurrentStateToTrainingData(2.5f);
+	mTraceParamsDirty = true;
+
+	TrainingStateInfo nextState;
+	ObserveState(nextState);
+
+	AddCurrentStateToTrainingData(mpRewardKernel->EvaluateEvent(ETransitionEvent::FoundCoin), ETransitionEvent::FoundCoin, &nextState);
 }
 
 void ALearningNPCActor::OnFoundTreasure()
 {
-	AddCurrentStateToTrainingData(100);
+	AddCurrentStateToTrainingData(mpRewardKernel->EvaluateEvent(ETransitionEvent::FoundTreasure), ETransitionEvent::FoundTreasure, nullptr);
 
 	if (mOnResetCallback)
 		mOnResetCallback(this);
@@ -117,73 +195,140 @@ void ALearningNPCActor::OnFoundTreasure()
 
 void ALearningNPCActor::OnDeath()
 {
-	AddCurrentStateToTrainingData(-100);
+	AddCurrentStateToTrainingData(mpRewardKernel->EvaluateEvent(ETransitionEvent::Death), ETransitionEvent::Death, nullptr);
 
 	if (mOnResetCallback)
 		mOnResetCallback(this);
 }
 
-void ALearningNPCActor::PickNewDirection()
+void ALearningNPCActor::PickNewDirection(const TrainingStateInfo& state)
 {
-	if (!mActionSelector)
+	if (!mActionSelector && !mDecisionRequester)
 		return;
 
-	FVector centerPosition = GetActorLocation();
-
-	// Cache Distance to Treasure.
-	mLastTreasureDistance = FVector::Distance(mTreasureLocation, centerPosition);
-
-	// Get Current Collision Query Distances.
-	std::vector<float> collisionDistances;
-	std::vector<float> collisionTypes;
-	CastRayTraces(&collisionDistances, &collisionTypes);
-
-	// Cache the distances for training.
-	mRayCollisionDistances = collisionDistances;
-	mRayCollisionHitTypes = collisionTypes;
+	// Transient model input, released when the scenario manager resets the frame arena.
+	// Without an arena the input lives on the stack, it is only read during this call.
+	std::array<float, StateSize> localStateInfo;
+	TArrayView<float> stateInfo = mpFrameArena ? mpFrameArena->AllocateArray<float>(StateSize) : MakeArrayView(localStateInfo);
+	WriteStateInputs(state, stateInfo);
 
-	// Add Ray Collision Distances
-	std::vector<float> stateInfo;
-	for (uint32_t i = 0; i < NumRayCasts; ++i)
+	if (mDecisionRequester)
 	{
-		stateInfo.emplace_back(collisionDistances[i]);
-		stateInfo.emplace_back(collisionTypes[i]);
+		// The current state and direction stay in effect until the pipelined decision is applied.
+		mPendingState = state;
+		mDecisionPending = true;
+		mDecisionRequestTime_s = GetWorld()->GetTimeSeconds();
+
+		mDecisionRequester(this, ++mDecisionRequestId, stateInfo);
+		return;
 	}
 
-	stateInfo.emplace_back(mLastTreasureDistance);
+	// Cache Distance to Treasure.
+	mLastTreasureDistance = state.mTreasureDistance;
 
-	const auto [dir, dir_f] = mActionSelector(stateInfo);
+	// Cache the distances for training.
+	mRayCollisionDistances = state.mRayCollisionDistances;
+	mRayCollisionHitTypes = state.mRayCollisionHitTypes;
+
+	const auto [dir, dir_f] = mActionSelector(mAgentId, stateInfo, mRandom);
 
 	mLastDirection = dir;
 	mLastDirection_f = dir_f;
+	mObservationLag_s = 0;
 }
 
-void ALearningNPCActor::CastRayTraces(std::vector<float>* distances, 
-									  std::vector<float>* types)
+void ALearningNPCActor::ApplyPipelinedDecision(uint32 requestId,
+											   EMoveDirection direction,
+											   float direction_f)
 {
+	if (!mDecisionPending || requestId != mDecisionRequestId)
+		return;
+
+	mDecisionPending = false;
+
+	mLastTreasureDistance = mPendingState.mTreasureDistance;
+	mRayCollisionDistances = mPendingState.mRayCollisionDistances;
+	mRayCollisionHitTypes = mPendingState.mRayCollisionHitTypes;
+
+	mLastDirection = direction;
+	mLastDirection_f = direction_f;
+	mObservationLag_s = GetWorld()->GetTimeSeconds() - mDecisionRequestTime_s;
+}
+
+void ALearningNPCActor::ObserveState(TrainingStateInfo& outState)
+{
+	outState.mTreasureDistance = FVector::Distance(mTreasureLocation, GetActorLocation());
+
+	// Get Current Collision Query Distances.
+	CastRayTraces(outState.mRayCollisionDistances.data(), outState.mRayCollisionHitTypes.data());
+}
+
+void ALearningNPCActor::CastRayTraces(float* distances, 
+									  float* types)
+{
+	const FScopedStageTimer timer(mpStageTimings, EPerformanceStage::Perception);
+
 	FVector centerPosition = GetActorLocation();
 	centerPosition.Z = mTraceHeight_cm;
 
-	for (int32 i = 0; i < NumRayCasts; i++)
+	// Debug traces draw the actual hits, so they always trace.
+	if (mpPerceptionCache && !mDebugTraces)
 	{
-		float AngleDeg = (360.f / NumRayCasts) * i;
-		float AngleRad = FMath::DegreesToRadians(AngleDeg);
+		if (!distances && !types)
+			return;
 
-		// Forward vector in XY plane
-		FVector Direction = FVector(FMath::Cos(AngleRad), FMath::Sin(AngleRad), 0.f);
+		FPerceptionRays rays;
+		if (!mpPerceptionCache->Find(centerPosition, rays))
+		{
+			// Cells touching the geometry are never cached, their center may lie inside a wall.
+			if (mpPerceptionCache->IsCacheable(centerPosition))
+			{
+				TraceStaticRays(mpPerceptionCache->GetCellCenter(centerPosition), rays);
+				mpPerceptionCache->Add(centerPosition, rays);
+			}
+			else
+			{
+				TraceStaticRays(centerPosition, rays);
+			}
+		}
 
-		FVector Start = centerPosition;
-		FVector End = Start + Direction * mMaxTraceDistance_cm;
+		ResolveDynamicRays(centerPosition, rays);
 
-		FHitResult Hit;
-		FCollisionQueryParams Params;
-		Params.AddIgnoredActor(this);  // don't hit self
+		if (distances)
+			std::copy(rays.mDistances.begin(), rays.mDistances.end(), distances);
+
+		if (types)
+			std::copy(rays.mHitTypes.begin(), rays.mHitTypes.end(), types);
+		return;
+	}
+
+	if (mTraceParamsDirty)
+	{
+		mTraceParams = FCollisionQueryParams();
+		mTraceParams.AddIgnoredActor(this);  // don't hit self
 
-		for (AActor* coin : mVisitedCoins)
+		if (mpCoinRegistry)
 		{
-			Params.AddIgnoredActor(coin);  // don't hit already collected coins
+			for (TConstSetBitIterator<> it(mVisitedCoins); it; ++it)
+			{
+				mTraceParams.AddIgnoredActor(mpCoinRegistry->mCoins[it.GetIndex()]);  // don't hit already collected coins
+			}
 		}
 
+		mTraceParamsDirty = false;
+	}
+
+	const FCollisionQueryParams& Params = mTraceParams;
+
+	for (int32 i = 0; i < NumRayCasts; i++)
+	{
+		// Forward vector in XY plane
+		FVector Direction = GetRayDirection(i);
+
+		FVector Start = centerPosition;
+		FVector End = Start + Direction * mMaxTraceDistance_cm;
+
+		FHitResult Hit;
 		bool isHit = GetWorld()->LineTraceSingleByChannel(Hit,
 														  Start,
 														  End,
@@ -195,19 +340,7 @@ void ALearningNPCActor::CastRayTraces(std::vector<float>* distances,
 		// Normalize to [0,1]
 		float normalizedDistance = distance / mMaxTraceDistance_cm;
 
-		float type = isHit ? 1.0f : 0.0f;
-
-		if (isHit && Hit.Component.IsValid())
-		{
-			if (Hit.Component->ComponentHasTag("Hazard"))
-				type = 2.0f;
-
-			if (Hit.Component->ComponentHasTag("Coin"))
-				type = 3.0f;
-
-			if (Hit.Component->ComponentHasTag("Treasure"))
-				type = 4.0f;
-		}
+		float type = isHit ? GetRayHitType(Hit) : RayHitType::None;
 
 		if (mDebugTraces)
 		{
@@ -234,14 +367,73 @@ void ALearningNPCActor::CastRayTraces(std::vector<float>* distances,
 		}
 
 		if (distances)
-			distances->emplace_back(normalizedDistance);
+			distances[i] = normalizedDistance;
 
 		if (types)
-			types->emplace_back(type);
+			types[i] = type;
+	}
+}
+
+void ALearningNPCActor::TraceStaticRays(const FVector& start,
+									   FPerceptionRays& outRays) const
+{
+	for (int32 i = 0; i < NumRayCasts; i++)
+	{
+		const FVector end = start + GetRayDirection(i) * mMaxTraceDistance_cm;
+
+		FHitResult hit;
+		const bool isHit = GetWorld()->LineTraceSingleByChannel(hit,
+																start,
+																end,
+																ECC_WorldStatic,
+																mpPerceptionCache->GetStaticTraceParams());
+
+		outRays.mDistances[i] = (isHit ? hit.Distance : mMaxTraceDistance_cm) / mMaxTraceDistance_cm;
+		outRays.mHitTypes[i] = isHit ? GetRayHitType(hit) : RayHitType::None;
 	}
 }
 
-void ALearningNPCActor::AddCurrentStateToTrainingData(float reward)
+void ALearningNPCActor::ResolveDynamicRays(const FVector& location,
+										   FPerceptionRays& rays) const
+{
+	for (int32 i = 0; i < NumRayCasts; i++)
+	{
+		const FVector direction = GetRayDirection(i);
+
+		float distance = rays.mDistances[i] * mMaxTraceDistance_cm;
+		float hitDistance = 0;
+
+		// Visited coins are ignored like the ignored actors of the traced version.
+		if (mpCoinRegistry)
+		{
+			for (int32 coin = 0; coin < mpCoinRegistry->mLocations.Num(); ++coin)
+			{
+				if (mVisitedCoins[coin])
+					continue;
+
+				if (RayCircleIntersect(location, direction, mpCoinRegistry->mLocations[coin], mpCoinRegistry->mRadii[coin], hitDistance) &&
+					hitDistance < distance)
+				{
+					distance = hitDistance;
+					rays.mHitTypes[i] = RayHitType::Coin;
+				}
+			}
+		}
+
+		if (RayCircleIntersect(location, direction, mTreasureLocation, mTreasureRadius_cm, hitDistance) &&
+			hitDistance < distance)
+		{
+			distance = hitDistance;
+			rays.mHitTypes[i] = RayHitType::Treasure;
+		}
+
+		rays.mDistances[i] = distance / mMaxTraceDistance_cm;
+	}
+}
+
+void ALearningNPCActor::AddCurrentStateToTrainingData(float reward,
+													  ETransitionEvent event,
+													  const TrainingStateInfo* nextState)
 {
 	if (mTrainingDataCallback)
 	{
@@ -249,9 +441,15 @@ void ALearningNPCActor::AddCurrentStateToTrainingData(float reward)
 		info.mDirection = mLastDirection;
 		info.mDirection_f = mLastDirection_f;
 		info.mReward = reward;
+		info.mEvent = event;
 		info.mState.mRayCollisionDistances = mRayCollisionDistances;
 		info.mState.mRayCollisionHitTypes = mRayCollisionHitTypes;
 		info.mState.mTreasureDistance = mLastTreasureDistance;
+		info.mObservationLag_s = mObservationLag_s;
+		info.mAgentId = mAgentId;
+
+		if (nextState)
+			info.mNextState = *nextState;
 
 		mTrainingDataCallback(info);
 	}
@@ -259,16 +457,18 @@ void ALearningNPCActor::AddCurrentStateToTrainingData(float reward)
 
 float ALearningNPCActor::DistanceToNearestCoin()
 {
-	TArray<AActor*> foundActors;
-	UGameplayStatics::GetAllActorsWithTag(GetWorld(), "Coin", foundActors);
 	float nearestDistance = TNumericLimits<float>::Max();
-	for (AActor* actor : foundActors)
+	if (!mpCoinRegistry)
+		return nearestDistance;
+
+	const FVector location = GetActorLocation();
+	for (int32 coin = 0; coin < mpCoinRegistry->mLocations.Num(); ++coin)
 	{
 		// Prevent counting already visited coins.
-		if (mVisitedCoins.contains(actor))
+		if (mVisitedCoins[coin])
 			continue;
 
-		float dist = FVector::Distance(actor->GetActorLocation(), GetActorLocation());
+		float dist = FVector::Distance(mpCoinRegistry->mLocations[coin], location);
 		if (dist < nearestDistance)
 			nearestDistance = dist;
 	}
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "BaseDungeonActor.h"
+#include "AgentScheduler.h"
+#include "DungeonRewards.h"
+#include "PerceptionCache.h"
+#include "CollisionQueryParams.h"
 
+#include <array>
 #include <functional>
 
 #include "LearningNPCActor.generated.h"
 
+class FFrameArena;
+
 
 /// <summary>
 /// A Learning NPC Actor that navigates a 
@@ -64,13 +71,108 @@ public:
 	}
 
 	/// <summary>
-	/// Registers a function to select the action based on the current state.
+	/// Registers a function to select the action based on the current state,
+	/// called with the agent id, the state and the actor's random stream.
 	/// </summary>
 	/// <param name="actionSelector">The action selector callback</param>
-	inline void SetActionSelector(const std::function<std::tuple<EMoveDirection, float>(const std::vector<float>&)>& actionSelector)
+	inline void SetActionSelector(const std::function<std::tuple<EMoveDirection, float>(int32, TArrayView<const float>, FRandomStream&)>& actionSelector)
 	{
 		mActionSelector = actionSelector;
 	}
+
+	/// <summary>
+	/// Registers a function queuing the decision state for pipelined inference,
+	/// the selected action is later applied through ApplyPipelinedDecision.
+	/// </summary>
+	/// <param name="requester">The decision requester callback</param>
+	inline void SetDecisionRequester(const std::function<void(ALearningNPCActor*, uint32, TArrayView<const float>)>& requester)
+	{
+		mDecisionRequester = requester;
+	}
+
+	/// <summary>
+	/// Sets the id the actor's training transitions are tagged with.
+	/// </summary>
+	/// <param name="agentId">The agent id</param>
+	inline void SetAgentId(int32 agentId)
+	{
+		mAgentId = agentId;
+	}
+
+	/// <summary>
+	/// Sets the arena the decision temporaries are allocated from.
+	/// </summary>
+	/// <param name="arena">The frame arena, reset once per frame by its owner</param>
+	inline void SetFrameArena(FFrameArena* arena)
+	{
+		mpFrameArena = arena;
+	}
+
+	/// <summary>
+	/// Sets the compiled reward terms the actor's transitions are rewarded with.
+	/// </summary>
+	/// <param name="rewardKernel">The reward kernel</param>
+	inline void SetRewardKernel(std::shared_ptr<const FRewardKernel> rewardKernel)
+	{
+		mpRewardKernel = std::move(rewardKernel);
+	}
+
+	/// <summary>
+	/// Sets the cache the static geometry rays are looked up in, null traces every ray.
+	/// </summary>
+	/// <param name="cache">The perception cache</param>
+	/// <param name="treasureRadius_cm">The radius the treasure is intersected with</param>
+	inline void SetPerceptionCache(std::shared_ptr<FPerceptionCache> cache,
+								   float treasureRadius_cm)
+	{
+		mpPerceptionCache = std::move(cache);
+		mTreasureRadius_cm = treasureRadius_cm;
+	}
+
+	/// <summary>
+	/// Applies the action selected for a pipelined decision request.
+	/// </summary>
+	/// <param name="requestId">The id the decision was requested with</param>
+	/// <param name="direction">The selected direction</param>
+	/// <param name="direction_f">The raw action value</param>
+	void ApplyPipelinedDecision(uint32 requestId,
+								EMoveDirection direction,
+								float direction_f);
+
+	/// <summary>
+	/// Registers a function granting the actor a decision slot for the current frame,
+	/// a denied decision is retried on the following frame.
+	/// </summary>
+	/// <param name="scheduler">The decision scheduler callback</param>
+	inline void SetDecisionScheduler(const std::function<bool(ALearningNPCActor*)>& scheduler)
+	{
+		mDecisionScheduler = scheduler;
+	}
+
+	/// <summary>
+	/// Hands the actor's behaviour over from its tick to a decision loop coroutine
+	/// resumed by the agent scheduler, which batches the decisions it awaits.
+	/// </summary>
+	/// <param name="scheduler">The agent scheduler</param>
+	void StartDecisionLoop(FAgentScheduler& scheduler);
+
+	/// <summary>
+	/// Sets the episode length after which the actor is reset at its next decision.
+	/// </summary>
+	/// <param name="maxEpisodeTime_s">The maximum episode length, 0 for unlimited episodes</param>
+	inline void SetMaxEpisodeTime(float maxEpisodeTime_s)
+	{
+		mMaxEpisodeTime_s = maxEpisodeTime_s;
+	}
+
+	/// <summary>
+	/// Offsets the decision timer of the actor.
+	/// </summary>
+	/// <param name="phase_s">The time already elapsed towards the next decision</param>
+	inline void SetDecisionPhase(float phase_s)
+	{
+		mTime_s = phase_s;
+	}
 private:
 	/// <summary>
 	/// Resets the actor to a specific location.
@@ -93,25 +195,68 @@ private:
 	/// </summary>
 	virtual void OnDeath() override;
 
+	/// <summary>
+	/// The agent loop: moves and senses every frame, then reports the decision
+	/// transition and awaits the next direction without blocking the game thread.
+	/// </summary>
+	/// <param name="scheduler">The agent scheduler resuming the loop</param>
+	/// <returns>The agent coroutine</returns>
+	FAgentTask RunDecisionLoop(FAgentScheduler& scheduler);
+
+	/// <summary>
+	/// Reports the transition ending at a decision point, resetting the actor
+	/// instead when the episode reached its maximum length.
+	/// </summary>
+	/// <param name="outState">The observed state the next direction is picked from</param>
+	/// <returns>True if the episode continues and a new direction is to be picked</returns>
+	bool AddDecisionTransition(TrainingStateInfo& outState);
+
 	/// <summary>
 	/// Picks a new direction for the actor to move in based on 
 	/// the current state and action selector.
 	/// </summary>
-	void PickNewDirection();
+	/// <param name="state">The observed state to decide from</param>
+	void PickNewDirection(const TrainingStateInfo& state);
+
+	/// <summary>
+	/// Observes the current state of the actor.
+	/// </summary>
+	/// <param name="outState">The output state</param>
+	void ObserveState(TrainingStateInfo& outState);
 
     /// <summary>
 	/// Casts ray traces in the current direction to detect obstacles, coins, and treasure.
     /// </summary>
-    /// <param name="distances">The output distances</param>
-    /// <param name="types">The output hit types</param>
-    void CastRayTraces(std::vector<float>* distances = nullptr, 
-					   std::vector<float>* types = nullptr);
+    /// <param name="distances">The output distances, NumRayCasts floats</param>
+    /// <param name="types">The output hit types, NumRayCasts floats</param>
+    void CastRayTraces(float* distances = nullptr, 
+					   float* types = nullptr);
+
+	/// <summary>
+	/// Traces the perception rays against the static geometry only, ignoring every dynamic actor.
+	/// </summary>
+	/// <param name="start">The ray origin</param>
+	/// <param name="outRays">The traced rays</param>
+	void TraceStaticRays(const FVector& start,
+						 FPerceptionRays& outRays) const;
+
+	/// <summary>
+	/// Intersects the perception rays with the unvisited coins and the treasure.
+	/// </summary>
+	/// <param name="location">The ray origin</param>
+	/// <param name="rays">The static rays, shortened where a dynamic object is hit first</param>
+	void ResolveDynamicRays(const FVector& location,
+							FPerceptionRays& rays) const;
 
 	/// <summary>
 	/// Adds the current state of the actor to the training data.
 	/// </summary>
 	/// <param name="reward">The reward for the current state</param>
-	void AddCurrentStateToTrainingData(float reward);
+	/// <param name="event">The event producing the transition</param>
+	/// <param name="nextState">The state following the transition, nullptr if terminal</param>
+	void AddCurrentStateToTrainingData(float reward,
+									   ETransitionEvent event,
+									   const TrainingStateInfo* nextState);
 
 	/// <summary>
 	/// Finds the closest distance coin to the actor's current location.
@@ -133,13 +278,40 @@ private:
 	EMoveDirection mLastDirection = EMoveDirection::None;
 	float mLastDirection_f = 0;
 
-	std::vector<float> mRayCollisionDistances;
-	std::vector<float> mRayCollisionHitTypes;
+	std::array<float, NumRayCasts> mRayCollisionDistances {};
+	std::array<float, NumRayCasts> mRayCollisionHitTypes {};
 
 	float mLastTreasureDistance = 0;
 	float mLastCoinDistance = 0;
 
-	std::function<std::tuple<EMoveDirection, float>(const std::vector<float>&)> mActionSelector;
+	// Actors decide on their own ticks, so each evaluates the kernel over a batch of itself.
+	std::shared_ptr<const FRewardKernel> mpRewardKernel = FRewardKernel::GetDefault();
+	FRewardBatch mRewardBatch;
+
+	std::function<std::tuple<EMoveDirection, float>(int32, TArrayView<const float>, FRandomStream&)> mActionSelector;
+	std::function<bool(ALearningNPCActor*)> mDecisionScheduler;
+	std::function<void(ALearningNPCActor*, uint32, TArrayView<const float>)> mDecisionRequester;
+
+	FFrameArena* mpFrameArena = nullptr;
+	int32 mAgentId = INDEX_NONE;
+
+	// Rebuilt only when the set of collected coins changes.
+	FCollisionQueryParams mTraceParams;
+	bool mTraceParamsDirty = true;
+
+	std::shared_ptr<FPerceptionCache> mpPerceptionCache = nullptr;
+	float mTreasureRadius_cm = 0;
+
+	TrainingStateInfo mPendingState;
+	uint32 mDecisionRequestId = 0;
+	bool mDecisionPending = false;
+	float mDecisionRequestTime_s = 0;
+	float mObservationLag_s = 0;
+
+	// Incremented on reset, decisions awaited across a reset are discarded.
+	uint32 mEpisode = 0;
+	float mEpisodeTime_s = 0;
+	float mMaxEpisodeTime_s = 0;
 
 	std::function<void(const TrainingInfo&)> mTrainingDataCallback;
 	std::function<void(ABaseDungeonActor*)> mOnResetCallback;
@@ -0,0 +1,101 @@
+#include "MinibatchAssembler.h"
+
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+
+#include <array>
+#include <numeric>
+
+FMinibatchAssembler::FMinibatchAssembler(int32 minibatchSize,
+										 int32 seed,
+										 bool shuffle)
+	: mMinibatchSize(FMath::Max(1, minibatchSize)),
+	mRandom(seed),
+	mShuffle(shuffle)
+{
+}
+
+FAssemblyStats FMinibatchAssembler::Feed(const std::vector<float>& states,
+										 const std::vector<float>& targets,
+										 const std::vector<float>& rewards,
+										 int32 numOutputs,
+										 const std::function<void(nlohmann::json&, nlohmann::json&, float)>& learner)
+{
+	FAssemblyStats stats;
+
+	const int32 count = static_cast<int32>(rewards.size());
+	if (count == 0)
+		return stats;
+
+	// Consecutive samples of one agent are correlated, so independent samples are spread across the batch.
+	mOrder.resize(count);
+	std::iota(mOrder.begin(), mOrder.end(), 0);
+	if (mShuffle)
+	{
+		for (int32 i = count - 1; i > 0; --i)
+			std::swap(mOrder[i], mOrder[mRandom.RandRange(0, i)]);
+	}
+
+	const int32 numMinibatches = FMath::DivideAndRoundUp(count, mMinibatchSize);
+
+	std::array<FPackedMinibatch, 2> minibatches;
+	auto dispatchPack = [&](int32 minibatch)
+	{
+		return FFunctionGraphTask::CreateAndDispatchWhenReady([&, minibatch]()
+		{
+			const int32 begin = minibatch * mMinibatchSize;
+			Pack(states, targets, rewards, numOutputs, begin, FMath::Min(begin + mMinibatchSize, count), minibatches[minibatch % 2]);
+
+		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+	};
+
+	FGraphEventRef packTask = dispatchPack(0);
+	for (int32 minibatch = 0; minibatch < numMinibatches; ++minibatch)
+	{
+		const double waitStart_s = FPlatformTime::Seconds();
+		packTask->Wait();
+		stats.mWaitTime_s += FPlatformTime::Seconds() - waitStart_s;
+
+		// The other buffer is free again, the next minibatch is packed into it meanwhile.
+		if (minibatch + 1 < numMinibatches)
+			packTask = dispatchPack(minibatch + 1);
+
+		const double feedStart_s = FPlatformTime::Seconds();
+		FPackedMinibatch& packed = minibatches[minibatch % 2];
+		for (size_t sample = 0; sample < packed.mRewards.size(); ++sample)
+			learner(packed.mStates[sample], packed.mTargets[sample], packed.mRewards[sample]);
+		stats.mFeedTime_s += FPlatformTime::Seconds() - feedStart_s;
+	}
+
+	stats.mNumMinibatches = numMinibatches;
+	return stats;
+}
+
+void FMinibatchAssembler::Pack(const std::vector<float>& states,
+							   const std::vector<float>& targets,
+							   const std::vector<float>& rewards,
+							   int32 numOutputs,
+							   int32 begin,
+							   int32 end,
+							   FPackedMinibatch& outMinibatch) const
+{
+	const int32 numSamples = end - begin;
+
+	outMinibatch.mStates.resize(numSamples);
+	outMinibatch.mTargets.resize(numSamples);
+	outMinibatch.mRewards.resize(numSamples);
+
+	ParallelFor(numSamples, [&](int32 i)
+	{
+		const size_t sample = static_cast<size_t>(mOrder[begin + i]);
+
+		// Built in one go from the decoded rows, sized once instead of growing per float.
+		const float* pState = states.data() + sample * StateSize;
+		outMinibatch.mStates[i] = nlohmann::json::array_t(pState, pState + StateSize);
+
+		const float* pTarget = targets.data() + sample * numOutputs;
+		outMinibatch.mTargets[i] = nlohmann::json::array_t(pTarget, pTarget + numOutputs);
+
+		outMinibatch.mRewards[i] = rewards[sample];
+	});
+}
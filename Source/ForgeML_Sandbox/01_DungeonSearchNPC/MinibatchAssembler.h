@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+
+#include "NPCDefines.h"
+
+#include "TFModelLib.h"
+
+#include <functional>
+#include <vector>
+
+
+/// <summary>
+/// How long the learner spent consuming minibatches and waiting for them to be packed.
+/// </summary>
+struct FAssemblyStats
+{
+	int32 mNumMinibatches = 0;
+	double mFeedTime_s = 0;
+	double mWaitTime_s = 0;
+};
+
+
+/// <summary>
+/// The samples of one minibatch packed into model input and target rows.
+/// </summary>
+struct FPackedMinibatch
+{
+	std::vector<nlohmann::json> mStates;
+	std::vector<nlohmann::json> mTargets;
+	std::vector<float> mRewards;
+};
+
+
+/// <summary>
+/// Packs a training batch into minibatches on worker threads, shuffled when its samples
+/// are independent. Two minibatches are kept in flight, so the next one is packed while
+/// the learner consumes the current one.
+/// </summary>
+class FMinibatchAssembler
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FMinibatchAssembler instance.
+	/// </summary>
+	/// <param name="minibatchSize">The number of samples per minibatch</param>
+	/// <param name="seed">The random seed of the shuffle</param>
+	/// <param name="shuffle">Whether to shuffle, batches whose rows depend on the following ones keep their order</param>
+	FMinibatchAssembler(int32 minibatchSize,
+						int32 seed,
+						bool shuffle);
+public:
+	/// <summary>
+	/// Hands every sample of a training batch to the learner, in shuffled order if enabled.
+	/// </summary>
+	/// <param name="states">The flattened model inputs, StateSize floats per sample</param>
+	/// <param name="targets">The flattened regression targets, numOutputs floats per sample</param>
+	/// <param name="rewards">The reward of each sample</param>
+	/// <param name="numOutputs">The number of targets per sample</param>
+	/// <param name="learner">Consumes one packed sample, called on the calling thread only</param>
+	/// <returns>The learner and packing times</returns>
+	FAssemblyStats Feed(const std::vector<float>& states,
+						const std::vector<float>& targets,
+						const std::vector<float>& rewards,
+						int32 numOutputs,
+						const std::function<void(nlohmann::json&, nlohmann::json&, float)>& learner);
+private:
+	/// <summary>
+	/// Packs a range of the ordered samples into a minibatch, in parallel across its samples.
+	/// </summary>
+	/// <param name="states">The flattened model inputs</param>
+	/// <param name="targets">The flattened regression targets</param>
+	/// <param name="rewards">The rewards</param>
+	/// <param name="numOutputs">The number of targets per sample</param>
+	/// <param name="begin">The first ordered sample</param>
+	/// <param name="end">One past the last ordered sample</param>
+	/// <param name="outMinibatch">The packed minibatch</param>
+	void Pack(const std::vector<float>& states,
+			  const std::vector<float>& targets,
+			  const std::vector<float>& rewards,
+			  int32 numOutputs,
+			  int32 begin,
+			  int32 end,
+			  FPackedMinibatch& outMinibatch) const;
+private:
+	int32 mMinibatchSize = 256;
+	FRandomStream mRandom;
+	bool mShuffle = true;
+
+	std::vector<int32> mOrder;
+};
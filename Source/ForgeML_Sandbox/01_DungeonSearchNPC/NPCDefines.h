@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 
+#include <array>
 #include <vector>
 
 UENUM(BlueprintType)
@@ -16,10 +17,27 @@ enum class EMoveDirection : uint8
 	COUNT
 };
 
+enum class ETransitionEvent : uint8
+{
+	Decision,
+	FoundCoin,
+	FoundTreasure,
+	Death,
+
+	// The episode reached its maximum length, not terminal so the transition still bootstraps.
+	Timeout
+};
+
+const int32_t NumRayCasts = 16;
+
+// Ray distance + hit type per ray followed by the treasure distance.
+const int32_t StateSize = (NumRayCasts * 2) + 1;
+
+// Fixed size so states are copied into the training data without heap allocations.
 struct TrainingStateInfo
 {
-	std::vector<float> mRayCollisionDistances;
-	std::vector<float> mRayCollisionHitTypes;
+	std::array<float, NumRayCasts> mRayCollisionDistances {};
+	std::array<float, NumRayCasts> mRayCollisionHitTypes {};
 	float mTreasureDistance = 0;
 };
 
@@ -31,6 +49,139 @@ struct TrainingInfo
 	TrainingStateInfo mState;
 
 	float mReward = 0;
+
+	ETransitionEvent mEvent = ETransitionEvent::Decision;
+
+	// The state observed after the transition, empty for terminal transitions.
+	TrainingStateInfo mNextState;
+
+	// Time between observing mState and applying mDirection, non-zero when inference is pipelined.
+	float mObservationLag_s = 0;
+
+	// The producing agent, unique across the actors, instanced agents and rollout workers of a scenario.
+	int32 mAgentId = INDEX_NONE;
+
+	// The number of rewards discounted into mReward, mNextState is the state after the last of them.
+	// Zero when the return already reaches the end of the episode and must not be bootstrapped.
+	uint8 mReturnSteps = 1;
+
+	inline bool IsTerminal() const
+	{
+		return mEvent == ETransitionEvent::FoundTreasure || mEvent == ETransitionEvent::Death;
+	}
 };
 
-const int32_t NumRayCasts = 16;
+// Uniform scale applied to every spawned dungeon actor.
+const float DungeonActorScale = 10.0f;
+
+/// <summary>
+/// Appends the flattened model input of a state.
+/// </summary>
+/// <param name="state">The state</param>
+/// <param name="outInputs">The output inputs, StateSize floats are appended</param>
+inline void AppendStateInputs(const TrainingStateInfo& state,
+							  std::vector<float>& outInputs)
+{
+	for (uint32_t i = 0; i < NumRayCasts; ++i)
+	{
+		outInputs.emplace_back(state.mRayCollisionDistances[i]);
+		outInputs.emplace_back(state.mRayCollisionHitTypes[i]);
+	}
+
+	outInputs.emplace_back(state.mTreasureDistance);
+}
+
+/// <summary>
+/// Writes the flattened model input of a state.
+/// </summary>
+/// <param name="state">The state</param>
+/// <param name="outInputs">The output inputs, at least StateSize floats</param>
+inline void WriteStateInputs(const TrainingStateInfo& state,
+							 TArrayView<float> outInputs)
+{
+	check(outInputs.Num() >= StateSize);
+
+	for (int32 i = 0; i < NumRayCasts; ++i)
+	{
+		outInputs[i * 2] = state.mRayCollisionDistances[i];
+		outInputs[i * 2 + 1] = state.mRayCollisionHitTypes[i];
+	}
+
+	outInputs[NumRayCasts * 2] = state.mTreasureDistance;
+}
+
+/// <summary>
+/// Converts the regressed action value into a move direction.
+/// </summary>
+/// <param name="action_f">The action value</param>
+/// <returns>The move direction</returns>
+inline EMoveDirection ActionFromValue(float action_f)
+{
+	int actionIndex = static_cast<int>(FMath::RoundToInt(action_f));
+	actionIndex = FMath::Clamp(actionIndex, (int)EMoveDirection::None, static_cast<int>(EMoveDirection::COUNT) - 1);
+
+	return static_cast<EMoveDirection>(actionIndex);
+}
+
+/// <summary>
+/// Selects the move direction with the highest action value.
+/// </summary>
+/// <param name="actionValues">The per-direction action values</param>
+/// <returns>The move direction</returns>
+inline EMoveDirection ActionFromValues(const float* actionValues)
+{
+	int32 bestIndex = 0;
+	for (int32 i = 1; i < static_cast<int32>(EMoveDirection::COUNT); ++i)
+	{
+		if (actionValues[i] > actionValues[bestIndex])
+			bestIndex = i;
+	}
+
+	return static_cast<EMoveDirection>(bestIndex);
+}
+
+/// <summary>
+/// Intersects a ray with a circle in the XY plane.
+/// </summary>
+/// <param name="start">The ray origin</param>
+/// <param name="direction">The normalized ray direction</param>
+/// <param name="center">The circle center</param>
+/// <param name="radius">The circle radius</param>
+/// <param name="outDistance">The distance along the ray to the circle</param>
+/// <returns>True if the ray intersects the circle</returns>
+inline bool RayCircleIntersect(const FVector& start,
+							   const FVector& direction,
+							   const FVector& center,
+							   float radius,
+							   float& outDistance)
+{
+	const float mX = start.X - center.X;
+	const float mY = start.Y - center.Y;
+
+	const float b = mX * direction.X + mY * direction.Y;
+	const float c = mX * mX + mY * mY - radius * radius;
+
+	if (c > 0 && b > 0)
+		return false;
+
+	const float discriminant = b * b - c;
+	if (discriminant < 0)
+		return false;
+
+	outDistance = FMath::Max(0.0f, -b - FMath::Sqrt(discriminant));
+	return true;
+}
+
+// Project collision object channels, see [/Script/Engine.CollisionProfile] in DefaultEngine.ini.
+#define ECC_DungeonHazard ECC_GameTraceChannel1
+#define ECC_DungeonCoin ECC_GameTraceChannel2
+#define ECC_DungeonTreasure ECC_GameTraceChannel3
+
+namespace RayHitType
+{
+	const float None = 0.0f;
+	const float Wall = 1.0f;
+	const float Hazard = 2.0f;
+	const float Coin = 3.0f;
+	const float Treasure = 4.0f;
+}
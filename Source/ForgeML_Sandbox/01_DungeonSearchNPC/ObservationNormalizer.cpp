@@ -0,0 +1,207 @@
+#include "ObservationNormalizer.h"
+
+#include "Math/VectorRegister.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+static const uint32 ObservationStatsMagic = 0x4F42534E;
+static const uint32 ObservationStatsVersion = 1;
+
+// Inputs that never vary, like hit types of rays that always miss, are not scaled up past this.
+static const double MinVariance = 1e-6;
+
+// The inputs covered by whole vector registers, the remaining at most three are handled per input.
+static constexpr int32 NumVectors = StateSize / 4;
+static constexpr int32 NumVectorInputs = NumVectors * 4;
+static constexpr int32 MaxTailInputs = 4;
+
+FObservationNormalizer::FObservationNormalizer(float clip)
+	: mClip(clip)
+{
+	mScale.fill(1.0f);
+}
+
+void FObservationNormalizer::Update(const float* states,
+									int32 count)
+{
+	if (count <= 0)
+		return;
+
+	// The batch is reduced on its own first, so every state costs a few vector adds.
+	VectorRegister4Float sums[NumVectors];
+	for (VectorRegister4Float& sum : sums)
+		sum = VectorZeroFloat();
+
+	std::array<double, MaxTailInputs> tailSums {};
+
+	for (int32 s = 0; s < count; ++s)
+	{
+		const float* state = states + static_cast<size_t>(s) * StateSize;
+		for (int32 v = 0; v < NumVectors; ++v)
+			sums[v] = VectorAdd(sums[v], VectorLoad(state + v * 4));
+
+		for (int32 i = NumVectorInputs; i < StateSize; ++i)
+			tailSums[i - NumVectorInputs] += state[i];
+	}
+
+	alignas(16) std::array<float, PaddedStateSize> batchMean {};
+	const VectorRegister4Float invCount = VectorSetFloat1(1.0f / count);
+	for (int32 v = 0; v < NumVectors; ++v)
+		VectorStoreAligned(VectorMultiply(sums[v], invCount), &batchMean[v * 4]);
+
+	for (int32 i = NumVectorInputs; i < StateSize; ++i)
+		batchMean[i] = static_cast<float>(tailSums[i - NumVectorInputs] / count);
+
+	// Squared deviations from the batch mean, not from zero, so the large treasure distances keep their precision.
+	VectorRegister4Float squares[NumVectors];
+	for (VectorRegister4Float& square : squares)
+		square = VectorZeroFloat();
+
+	std::array<double, MaxTailInputs> tailSquares {};
+
+	for (int32 s = 0; s < count; ++s)
+	{
+		const float* state = states + static_cast<size_t>(s) * StateSize;
+		for (int32 v = 0; v < NumVectors; ++v)
+		{
+			const VectorRegister4Float deviation = VectorSubtract(VectorLoad(state + v * 4), VectorLoadAligned(&batchMean[v * 4]));
+			squares[v] = VectorMultiplyAdd(deviation, deviation, squares[v]);
+		}
+
+		for (int32 i = NumVectorInputs; i < StateSize; ++i)
+		{
+			const double deviation = state[i] - batchMean[i];
+			tailSquares[i - NumVectorInputs] += deviation * deviation;
+		}
+	}
+
+	alignas(16) std::array<float, PaddedStateSize> batchM2 {};
+	for (int32 v = 0; v < NumVectors; ++v)
+		VectorStoreAligned(squares[v], &batchM2[v * 4]);
+
+	for (int32 i = NumVectorInputs; i < StateSize; ++i)
+		batchM2[i] = static_cast<float>(tailSquares[i - NumVectorInputs]);
+
+	// Merges the batch into the running statistics.
+	const double runningCount = static_cast<double>(mCount);
+	const double totalCount = runningCount + count;
+	for (int32 i = 0; i < StateSize; ++i)
+	{
+		const double delta = batchMean[i] - mMean[i];
+		mMean[i] += delta * count / totalCount;
+		mM2[i] += batchM2[i] + delta * delta * runningCount * count / totalCount;
+	}
+
+	mCount += count;
+
+	UpdateTransform();
+}
+
+void FObservationNormalizer::Normalize(float* states,
+									   int32 count) const
+{
+	if (mCount == 0)
+		return;
+
+	const VectorRegister4Float lower = VectorSetFloat1(-mClip);
+	const VectorRegister4Float upper = VectorSetFloat1(mClip);
+
+	for (int32 s = 0; s < count; ++s)
+	{
+		float* state = states + static_cast<size_t>(s) * StateSize;
+		for (int32 v = 0; v < NumVectors; ++v)
+		{
+			VectorRegister4Float input = VectorLoad(state + v * 4);
+			input = VectorMultiply(VectorSubtract(input, VectorLoadAligned(&mOffset[v * 4])), VectorLoadAligned(&mScale[v * 4]));
+			VectorStore(VectorMin(VectorMax(input, lower), upper), state + v * 4);
+		}
+
+		for (int32 i = NumVectorInputs; i < StateSize; ++i)
+			state[i] = FMath::Clamp((state[i] - mOffset[i]) * mScale[i], -mClip, mClip);
+	}
+}
+
+bool FObservationNormalizer::Save(const FString& path) const
+{
+	FBufferArchive writer;
+
+	uint32 magic = ObservationStatsMagic;
+	uint32 version = ObservationStatsVersion;
+	int32 stateSize = StateSize;
+	uint64 count = mCount;
+	writer << magic << version << stateSize << count;
+
+	for (int32 i = 0; i < StateSize; ++i)
+	{
+		double mean = mMean[i];
+		double m2 = mM2[i];
+		writer << mean << m2;
+	}
+
+	if (!FFileHelper::SaveArrayToFile(writer, *path))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Write Observation Statistics %s!"), *path);
+		return false;
+	}
+	return true;
+}
+
+bool FObservationNormalizer::Load(const FString& path)
+{
+	TArray<uint8> data;
+	if (!FFileHelper::LoadFileToArray(data, *path, FILEREAD_Silent))
+		return false;
+
+	FMemoryReader reader(data);
+
+	uint32 magic = 0;
+	uint32 version = 0;
+	int32 stateSize = 0;
+	uint64 count = 0;
+	reader << magic << version << stateSize << count;
+
+	if (magic != ObservationStatsMagic || version != ObservationStatsVersion || stateSize != StateSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid Observation Statistics %s!"), *path);
+		return false;
+	}
+
+	std::array<double, StateSize> mean {};
+	std::array<double, StateSize> m2 {};
+	for (int32 i = 0; i < StateSize; ++i)
+		reader << mean[i] << m2[i];
+
+	if (reader.IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Truncated Observation Statistics %s!"), *path);
+		return false;
+	}
+
+	mCount = count;
+	mMean = mean;
+	mM2 = m2;
+
+	UpdateTransform();
+	return true;
+}
+
+FString FObservationNormalizer::GetCheckpointPath(const std::string& modelName,
+												  int32 version)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(),
+						   TEXT("ObservationStats"),
+						   FString::Printf(TEXT("%s_%d.stats"), UTF8_TO_TCHAR(modelName.c_str()), version));
+}
+
+void FObservationNormalizer::UpdateTransform()
+{
+	for (int32 i = 0; i < StateSize; ++i)
+	{
+		const double variance = mCount > 0 ? mM2[i] / mCount : 1.0;
+
+		mOffset[i] = static_cast<float>(mMean[i]);
+		mScale[i] = static_cast<float>(1.0 / FMath::Sqrt(FMath::Max(variance, MinVariance)));
+	}
+}
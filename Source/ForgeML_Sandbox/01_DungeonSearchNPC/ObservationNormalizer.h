@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NPCDefines.h"
+
+#include <array>
+#include <string>
+
+
+/// <summary>
+/// Running mean and variance of every model input, merged batch by batch with
+/// the parallel form of Welford's algorithm. Normalizes states into zero mean,
+/// unit variance inputs clipped to a fixed range, so the ray distances, hit
+/// types and the treasure distance in centimetres reach the model on one scale.
+/// The statistics are saved per model version, a model is always run with the
+/// statistics it was trained with.
+/// </summary>
+class FObservationNormalizer
+{
+public:
+	/// <summary>
+	/// Constructor initializing empty statistics, states pass through unchanged until the first update.
+	/// </summary>
+	/// <param name="clip">The range normalized inputs are clipped to</param>
+	FObservationNormalizer(float clip = 5.0f);
+
+	/// <summary>
+	/// Merges a batch of states into the running statistics.
+	/// </summary>
+	/// <param name="states">The states, StateSize floats each</param>
+	/// <param name="count">The number of states</param>
+	void Update(const float* states,
+				int32 count);
+
+	/// <summary>
+	/// Normalizes a batch of states in place.
+	/// </summary>
+	/// <param name="states">The states, StateSize floats each</param>
+	/// <param name="count">The number of states</param>
+	void Normalize(float* states,
+				   int32 count) const;
+
+	/// <summary>
+	/// Retrieves the number of states the statistics were gathered from.
+	/// </summary>
+	/// <returns>The number of states</returns>
+	inline uint64 GetCount() const { return mCount; }
+public:
+	/// <summary>
+	/// Writes the statistics.
+	/// </summary>
+	/// <param name="path">The statistics file</param>
+	/// <returns>True if written</returns>
+	bool Save(const FString& path) const;
+
+	/// <summary>
+	/// Replaces the statistics with saved ones.
+	/// </summary>
+	/// <param name="path">The statistics file</param>
+	/// <returns>False if the file is missing or of a different state layout</returns>
+	bool Load(const FString& path);
+
+	/// <summary>
+	/// Retrieves the statistics file saved alongside a model version.
+	/// </summary>
+	/// <param name="modelName">The model name</param>
+	/// <param name="version">The model version</param>
+	/// <returns>The statistics file</returns>
+	static FString GetCheckpointPath(const std::string& modelName,
+									 int32 version);
+private:
+	/// <summary>
+	/// Recomputes the per input offset and scale from the running statistics.
+	/// </summary>
+	void UpdateTransform();
+private:
+	// Padded to whole vector registers, the inputs past StateSize are never read.
+	static constexpr int32 PaddedStateSize = (StateSize + 3) / 4 * 4;
+
+	float mClip;
+
+	uint64 mCount = 0;
+	std::array<double, StateSize> mMean {};
+	std::array<double, StateSize> mM2 {};
+
+	alignas(16) std::array<float, PaddedStateSize> mOffset {};
+	alignas(16) std::array<float, PaddedStateSize> mScale {};
+};
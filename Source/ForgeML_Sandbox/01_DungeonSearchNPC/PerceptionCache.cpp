@@ -0,0 +1,113 @@
+#include "PerceptionCache.h"
+#include "HeadlessDungeon.h"
+
+void FPerceptionCache::Configure(int32 capacity,
+								 float cellSize_cm,
+								 const TArray<AActor*>& dynamicActors,
+								 std::shared_ptr<const FDungeonLayout> layout)
+{
+	const std::scoped_lock lock(mMutex);
+
+	mEntries.assign(static_cast<size_t>(FMath::Max(0, capacity)), FEntry());
+	mCellSize_cm = FMath::Max(cellSize_cm, UE_KINDA_SMALL_NUMBER);
+
+	// Shared by every agent, so the traces ignore all agents, coins and the treasure, not just the tracing agent.
+	mStaticTraceParams = FCollisionQueryParams();
+	mStaticTraceParams.AddIgnoredActors(dynamicActors);
+
+	mpLayout = std::move(layout);
+
+	mNumCells = 0;
+	mNumHits = 0;
+	mNumMisses = 0;
+}
+
+bool FPerceptionCache::Find(const FVector& location,
+							FPerceptionRays& outRays)
+{
+	if (mEntries.empty())
+		return false;
+
+	const FIntPoint cell = GetCell(location);
+
+	{
+		const std::scoped_lock lock(mMutex);
+
+		const FEntry& entry = mEntries[GetTypeHash(cell) % mEntries.size()];
+		if (entry.mValid && entry.mVersion == mVersion && entry.mCell == cell)
+		{
+			outRays = entry.mRays;
+
+			mNumHits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	mNumMisses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void FPerceptionCache::Add(const FVector& location,
+						   const FPerceptionRays& rays)
+{
+	if (mEntries.empty())
+		return;
+
+	const FIntPoint cell = GetCell(location);
+
+	const std::scoped_lock lock(mMutex);
+
+	// Direct mapped, a colliding cell replaces the previous entry.
+	FEntry& entry = mEntries[GetTypeHash(cell) % mEntries.size()];
+	if (!entry.mValid || entry.mVersion != mVersion)
+		mNumCells.fetch_add(1, std::memory_order_relaxed);
+
+	entry.mCell = cell;
+	entry.mVersion = mVersion;
+	entry.mRays = rays;
+	entry.mValid = true;
+}
+
+void FPerceptionCache::Invalidate(std::shared_ptr<const FDungeonLayout> layout)
+{
+	const std::scoped_lock lock(mMutex);
+
+	mpLayout = std::move(layout);
+
+	mVersion++;
+	mNumCells = 0;
+}
+
+bool FPerceptionCache::IsCacheable(const FVector& location) const
+{
+	std::shared_ptr<const FDungeonLayout> layout;
+	{
+		const std::scoped_lock lock(mMutex);
+		layout = mpLayout;
+	}
+
+	if (!layout)
+		return false;
+
+	const FIntPoint cell = GetCell(location);
+	const FVector2D min(cell.X * mCellSize_cm, cell.Y * mCellSize_cm);
+	return layout->IsOpen(FBox2D(min, min + FVector2D(mCellSize_cm)));
+}
+
+FVector FPerceptionCache::GetCellCenter(const FVector& location) const
+{
+	const FIntPoint cell = GetCell(location);
+	return FVector((cell.X + 0.5f) * mCellSize_cm, (cell.Y + 0.5f) * mCellSize_cm, location.Z);
+}
+
+float FPerceptionCache::GetHitRate() const
+{
+	const uint64 hits = mNumHits.load();
+	const uint64 lookups = hits + mNumMisses.load();
+	return lookups > 0 ? static_cast<float>(static_cast<double>(hits) / lookups) : 0.0f;
+}
+
+FIntPoint FPerceptionCache::GetCell(const FVector& location) const
+{
+	return FIntPoint(FMath::FloorToInt(location.X / mCellSize_cm), FMath::FloorToInt(location.Y / mCellSize_cm));
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+
+#include "NPCDefines.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct FDungeonLayout;
+
+/// <summary>
+/// The perception rays of a single location.
+/// </summary>
+struct FPerceptionRays
+{
+	// Normalized to [0,1] by the maximum trace distance.
+	std::array<float, NumRayCasts> mDistances {};
+	std::array<float, NumRayCasts> mHitTypes {};
+};
+
+
+/// <summary>
+/// A fixed capacity cache of the static geometry perception keyed on the grid cell
+/// of the agent's location. Entries hold the rays traced from the cell center with
+/// every dynamic actor ignored, agents resolve coins and the treasure on top of them.
+/// Only cells entirely open in the dungeon layout are cached, since the center of a
+/// cell straddling a wall may lie inside it, agents in those cells trace from their
+/// own location instead. Entries are tagged with the geometry version they were traced against and stale
+/// versions are treated as misses. Safe to use from multiple threads.
+/// </summary>
+class FPerceptionCache
+{
+public:
+	/// <summary>
+	/// Resizes and clears the cache.
+	/// </summary>
+	/// <param name="capacity">The number of entries</param>
+	/// <param name="cellSize_cm">The grid cell size locations are quantized to</param>
+	/// <param name="dynamicActors">The actors the static traces ignore</param>
+	/// <param name="layout">The occupancy grid deciding which cells are cached, null caches none</param>
+	void Configure(int32 capacity,
+				   float cellSize_cm,
+				   const TArray<AActor*>& dynamicActors,
+				   std::shared_ptr<const FDungeonLayout> layout);
+
+	/// <summary>
+	/// Looks up the static rays cached for the cell of a location.
+	/// </summary>
+	/// <param name="location">The agent location</param>
+	/// <param name="outRays">The cached rays</param>
+	/// <returns>True on a cache hit</returns>
+	bool Find(const FVector& location,
+			  FPerceptionRays& outRays);
+
+	/// <summary>
+	/// Caches the static rays traced from the center of a location's cell.
+	/// </summary>
+	/// <param name="location">The agent location</param>
+	/// <param name="rays">The rays</param>
+	void Add(const FVector& location,
+			 const FPerceptionRays& rays);
+
+	/// <summary>
+	/// Drops every cached cell, called when the level geometry changed.
+	/// </summary>
+	/// <param name="layout">The occupancy grid of the changed geometry</param>
+	void Invalidate(std::shared_ptr<const FDungeonLayout> layout);
+
+	/// <summary>
+	/// Checks whether the rays of a location's cell can be traced from its center and shared,
+	/// which requires the whole cell to be free space.
+	/// </summary>
+	/// <param name="location">The agent location</param>
+	/// <returns>True if the cell is cached</returns>
+	bool IsCacheable(const FVector& location) const;
+public:
+	/// <summary>
+	/// Checks whether the cache has been configured with a capacity.
+	/// </summary>
+	/// <returns>True if enabled</returns>
+	inline bool IsEnabled() const { return !mEntries.empty(); }
+
+	/// <summary>
+	/// Retrieves the center of the cell a location falls into, at the location's height.
+	/// </summary>
+	/// <param name="location">The location</param>
+	/// <returns>The cell center</returns>
+	FVector GetCellCenter(const FVector& location) const;
+
+	/// <summary>
+	/// Retrieves the query parameters of the static traces, ignoring every dynamic actor.
+	/// </summary>
+	/// <returns>The query parameters</returns>
+	inline const FCollisionQueryParams& GetStaticTraceParams() const { return mStaticTraceParams; }
+
+	/// <summary>
+	/// Retrieves the fraction of lookups that hit.
+	/// </summary>
+	/// <returns>The hit rate in [0, 1]</returns>
+	float GetHitRate() const;
+
+	/// <summary>
+	/// Retrieves the number of cells cached for the current geometry.
+	/// </summary>
+	/// <returns>The number of cells</returns>
+	inline int32 GetNumCells() const { return mNumCells.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Retrieves the memory held by the cache entries.
+	/// </summary>
+	/// <returns>The size in bytes</returns>
+	inline uint64 GetAllocatedBytes() const { return static_cast<uint64>(mEntries.capacity()) * sizeof(FEntry); }
+private:
+	struct FEntry
+	{
+		FIntPoint mCell = FIntPoint::ZeroValue;
+		uint32 mVersion = 0;
+		FPerceptionRays mRays;
+		bool mValid = false;
+	};
+
+	/// <summary>
+	/// Quantizes a location into its grid cell.
+	/// </summary>
+	/// <param name="location">The location</param>
+	/// <returns>The cell</returns>
+	FIntPoint GetCell(const FVector& location) const;
+private:
+	mutable std::mutex mMutex;
+	std::vector<FEntry> mEntries;
+	std::shared_ptr<const FDungeonLayout> mpLayout = nullptr;
+
+	float mCellSize_cm = 25.0f;
+	FCollisionQueryParams mStaticTraceParams;
+
+	uint32 mVersion = 0;
+	std::atomic<int32> mNumCells = 0;
+
+	std::atomic<uint64> mNumHits = 0;
+	std::atomic<uint64> mNumMisses = 0;
+};
@@ -0,0 +1,141 @@
+#include "PolicyEvaluator.h"
+
+#include "Async/ParallelFor.h"
+
+void FPolicyEvaluationResult::Merge(const FPolicyEvaluationResult& other)
+{
+	mNumEpisodes += other.mNumEpisodes;
+	mNumSuccesses += other.mNumSuccesses;
+	mNumDeaths += other.mNumDeaths;
+	mNumTimeouts += other.mNumTimeouts;
+
+	mTotalTimeToTreasure_s += other.mTotalTimeToTreasure_s;
+	mNumCoinsCollected += other.mNumCoinsCollected;
+}
+
+FPolicyEvaluator::FPolicyEvaluator(std::shared_ptr<const FDungeonLayout> layout,
+								   const FHeadlessDungeonSettings& dungeonSettings,
+								   const TArray<FVector>& spawnPoints,
+								   const TArray<FVector>& coinPoints,
+								   const TArray<FVector>& treasurePoints,
+								   const FPolicyEvaluationSettings& settings)
+	: mpLayout(std::move(layout)),
+	mDungeonSettings(dungeonSettings),
+	mSettings(settings),
+	mSpawnPoints(spawnPoints),
+	mCoinPoints(coinPoints),
+	mTreasurePoints(treasurePoints)
+{
+}
+
+FPolicyEvaluationResult FPolicyEvaluator::Evaluate(const FBatchActionSelector& actionSelector) const
+{
+	FPolicyEvaluationResult result;
+	if (!mpLayout || mSpawnPoints.IsEmpty() || mTreasurePoints.IsEmpty())
+		return result;
+
+	const double start_s = FPlatformTime::Seconds();
+
+	const int32 numSeeds = FMath::Max(1, mSettings.mNumSeeds);
+	const int32 numTasks = numSeeds * mTreasurePoints.Num();
+
+	std::vector<FPolicyEvaluationResult> taskResults(numTasks);
+	ParallelFor(numTasks, [&](int32 task)
+	{
+		taskResults[task] = EvaluateEpisodes(task / mTreasurePoints.Num(),
+											 mTreasurePoints[task % mTreasurePoints.Num()],
+											 actionSelector);
+	});
+
+	for (const FPolicyEvaluationResult& taskResult : taskResults)
+		result.Merge(taskResult);
+
+	result.mWallTime_s = FPlatformTime::Seconds() - start_s;
+	return result;
+}
+
+FPolicyEvaluationResult FPolicyEvaluator::EvaluateEpisodes(int32 seed,
+														   const FVector& treasureLocation,
+														   const FBatchActionSelector& actionSelector) const
+{
+	FHeadlessDungeon dungeon(mpLayout, mDungeonSettings, mSpawnPoints, mCoinPoints, seed);
+	dungeon.SetAutoReset(false);
+
+	FRandomStream random(seed);
+
+	for (const FVector& spawnPoint : mSpawnPoints)
+	{
+		FVector location = spawnPoint;
+		if (seed > 0)
+		{
+			const float angle = random.FRandRange(0.0f, UE_TWO_PI);
+			const FVector offset = FVector(FMath::Cos(angle), FMath::Sin(angle), 0.0f) * random.FRandRange(0.0f, mSettings.mSpawnJitter_cm);
+
+			// Jittered starts inside a wall keep the original spawn point.
+			if (!mpLayout->IsTouching(spawnPoint + offset, mDungeonSettings.mAgentRadius_cm, EDungeonCell::Wall))
+				location += offset;
+		}
+
+		const int32 index = dungeon.AddAgent(treasureLocation);
+		dungeon.ResetAgent(index, location, treasureLocation);
+		dungeon.RequestDecision(index);
+	}
+
+	std::vector<int32> decisions;
+	std::vector<float> states;
+	std::vector<std::tuple<EMoveDirection, float>> actions;
+	std::vector<TrainingInfo> transitions;
+
+	// Every agent starts together, so the elapsed time is each active agent's episode time.
+	bool anyActive = true;
+	for (float time_s = 0; anyActive && time_s < mSettings.mMaxEpisodeTime_s; time_s += mSettings.mStepTime_s)
+	{
+		decisions.clear();
+		transitions.clear();
+		dungeon.Step(mSettings.mStepTime_s, decisions, transitions);
+
+		if (!decisions.empty())
+		{
+			states.clear();
+			for (int32 index : decisions)
+				dungeon.GetObservation(index, states);
+
+			actions.clear();
+			actionSelector(states, static_cast<int32>(decisions.size()), random, actions);
+
+			for (size_t i = 0; i < decisions.size() && i < actions.size(); ++i)
+			{
+				const auto [dir, dir_f] = actions[i];
+				dungeon.ApplyDecision(decisions[i], dir, dir_f);
+			}
+		}
+
+		anyActive = false;
+		for (int32 i = 0; i < dungeon.GetNumAgents(); ++i)
+			anyActive |= dungeon.GetAgent(i).mActive;
+	}
+
+	FPolicyEvaluationResult result;
+	for (int32 i = 0; i < dungeon.GetNumAgents(); ++i)
+	{
+		const FHeadlessAgent& agent = dungeon.GetAgent(i);
+
+		result.mNumEpisodes++;
+		result.mNumCoinsCollected += agent.mCoinsCollected;
+
+		if (agent.mActive)
+		{
+			result.mNumTimeouts++;
+		}
+		else if (agent.mEpisodeOutcome == ETransitionEvent::FoundTreasure)
+		{
+			result.mNumSuccesses++;
+			result.mTotalTimeToTreasure_s += agent.mEpisodeTime_s;
+		}
+		else if (agent.mEpisodeOutcome == ETransitionEvent::Death)
+		{
+			result.mNumDeaths++;
+		}
+	}
+	return result;
+}
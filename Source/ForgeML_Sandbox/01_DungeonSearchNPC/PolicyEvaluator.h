@@ -0,0 +1,115 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "HeadlessDungeon.h"
+#include "RolloutWorker.h"
+
+#include <memory>
+
+
+/// <summary>
+/// Settings of a policy evaluation run.
+/// </summary>
+struct FPolicyEvaluationSettings
+{
+	int32 mNumSeeds = 4;
+	float mStepTime_s = 1.0f / 30.0f;
+	float mMaxEpisodeTime_s = 120.0f;
+
+	// Seeds other than the first start the agents at a random offset around the spawn point.
+	float mSpawnJitter_cm = 50.0f;
+};
+
+
+/// <summary>
+/// Aggregated episode outcomes of a policy evaluation run.
+/// </summary>
+struct FPolicyEvaluationResult
+{
+	int32 mNumEpisodes = 0;
+	int32 mNumSuccesses = 0;
+	int32 mNumDeaths = 0;
+	int32 mNumTimeouts = 0;
+
+	double mTotalTimeToTreasure_s = 0;
+	int64 mNumCoinsCollected = 0;
+
+	double mWallTime_s = 0;
+
+	/// <summary>
+	/// Retrieves the fraction of episodes that found the treasure.
+	/// </summary>
+	/// <returns>The success rate in [0, 1]</returns>
+	inline float GetSuccessRate() const
+	{
+		return mNumEpisodes > 0 ? static_cast<float>(mNumSuccesses) / mNumEpisodes : 0.0f;
+	}
+
+	/// <summary>
+	/// Retrieves the mean time to the treasure of the successful episodes.
+	/// </summary>
+	/// <returns>The time in seconds</returns>
+	inline double GetMeanTimeToTreasure_s() const
+	{
+		return mNumSuccesses > 0 ? mTotalTimeToTreasure_s / mNumSuccesses : 0.0;
+	}
+
+	/// <summary>
+	/// Accumulates the outcomes of another evaluation.
+	/// </summary>
+	/// <param name="other">The other result</param>
+	void Merge(const FPolicyEvaluationResult& other);
+};
+
+
+/// <summary>
+/// Evaluates a policy greedily on headless dungeons, running every spawn point against
+/// every treasure point for each seed. The seed and treasure combinations are simulated
+/// in parallel, each stepping all of its spawn points as one batch.
+/// </summary>
+class FPolicyEvaluator
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FPolicyEvaluator instance.
+	/// </summary>
+	/// <param name="layout">The shared dungeon layout</param>
+	/// <param name="dungeonSettings">The agent settings</param>
+	/// <param name="spawnPoints">The agent spawn points</param>
+	/// <param name="coinPoints">The coin locations</param>
+	/// <param name="treasurePoints">The treasure locations</param>
+	/// <param name="settings">The evaluation settings</param>
+	FPolicyEvaluator(std::shared_ptr<const FDungeonLayout> layout,
+					 const FHeadlessDungeonSettings& dungeonSettings,
+					 const TArray<FVector>& spawnPoints,
+					 const TArray<FVector>& coinPoints,
+					 const TArray<FVector>& treasurePoints,
+					 const FPolicyEvaluationSettings& settings);
+public:
+	/// <summary>
+	/// Runs the evaluation, blocking until every episode has finished.
+	/// </summary>
+	/// <param name="actionSelector">The greedy batch action selector, called concurrently</param>
+	/// <returns>The aggregated result</returns>
+	FPolicyEvaluationResult Evaluate(const FBatchActionSelector& actionSelector) const;
+private:
+	/// <summary>
+	/// Runs the episodes of every spawn point for a single seed and treasure point.
+	/// </summary>
+	/// <param name="seed">The seed</param>
+	/// <param name="treasureLocation">The treasure location</param>
+	/// <param name="actionSelector">The greedy batch action selector</param>
+	/// <returns>The result of the episodes</returns>
+	FPolicyEvaluationResult EvaluateEpisodes(int32 seed,
+											 const FVector& treasureLocation,
+											 const FBatchActionSelector& actionSelector) const;
+private:
+	std::shared_ptr<const FDungeonLayout> mpLayout;
+	FHeadlessDungeonSettings mDungeonSettings;
+	FPolicyEvaluationSettings mSettings;
+
+	TArray<FVector> mSpawnPoints;
+	TArray<FVector> mCoinPoints;
+	TArray<FVector> mTreasurePoints;
+};
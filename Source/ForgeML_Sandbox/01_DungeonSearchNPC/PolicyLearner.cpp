@@ -0,0 +1,544 @@
+#include "PolicyLearner.h"
+
+#include "Async/ParallelFor.h"
+
+#include "ExperienceChannel.h"
+#include "MinibatchAssembler.h"
+
+#include <utility>
+
+// Transitions decoded per worker task, large enough to amortize the task overhead.
+static const int32 DecodeBlockSize = 1024;
+
+FPolicyLearner::FPolicyLearner(const FPolicyLearnerSettings& settings,
+							   FStageTimings* pStageTimings,
+							   const FModelRunner& modelRunner,
+							   const FModelWarmUp& modelWarmUp,
+							   const FTrainingRoundReporter& roundReporter,
+							   const FGenerationSink& generationSink)
+	: mSettings(settings),
+	mpStageTimings(pStageTimings),
+	mModelRunner(modelRunner),
+	mModelWarmUp(modelWarmUp),
+	mRoundReporter(roundReporter),
+	mGenerationSink(generationSink),
+	mObservationStats(settings.mNormalizationClip)
+{
+}
+
+FPolicyLearner::~FPolicyLearner()
+{
+	// The queued rounds train and publish through the learner.
+	WaitForTraining();
+}
+
+bool FPolicyLearner::LoadModel()
+{
+	mpModel = CreateModel(mSettings.mModelName);
+	if (!mpModel)
+		return false;
+
+	// Training continues from the statistics the loaded model was trained with.
+	if (mSettings.mNormalizeObservations && LoadInputNormalizer(mpModel->GetModelVersion(), mObservationStats))
+		UE_LOG(LogTemp, Display, TEXT("Loaded Observation Statistics Of %llu States For Model Version %d."), mObservationStats.GetCount(), mpModel->GetModelVersion());
+
+	// Decisions run a copy of the model, so the learner trains mpModel without stopping them.
+	std::shared_ptr<FPolicySnapshot> pPolicy = std::make_shared<FPolicySnapshot>();
+	pPolicy->mpModel = CreateModel(mSettings.mModelName);
+	pPolicy->mNormalizer = mObservationStats;
+	if (pPolicy->mpModel)
+		mpPolicy = std::move(pPolicy);
+
+	// The loaded generation bootstraps the action values until the first target refresh.
+	if (mSettings.mUseActionValueHead)
+		mpTargetPolicy = mpPolicy;
+
+	return true;
+}
+
+std::unique_ptr<TF::MLModel> FPolicyLearner::CreateModel(const std::string& modelName) const
+{
+	std::unique_ptr<TF::MLModel> model = std::make_unique<TF::MLModel>(modelName);
+
+	if (model->DoesModelExists())
+	{
+		if (!model->LoadIfExists())
+			model = nullptr;
+	}
+	else
+	{
+		model->AddInput("state",
+						TF::DataType::Float32,
+						{ -1, StateSize });
+
+		model->AddOutput("action");
+
+		model->AddLayer(TF::LayerType::Flatten,
+		{
+			{ "input_name", "state" },
+			{ "output_name", "flat_input" }
+		});
+
+		model->AddLayer(TF::LayerType::Dense,
+		{
+			{ "input_name", "flat_input" },
+			{ "units", 64 },
+			{ "output_name", "dense_1" },
+			{ "activation", "relu" },
+		});
+
+		model->AddLayer(TF::LayerType::Dense,
+		{
+			{ "input_name", "dense_1" },
+			{ "units", 256 },
+			{ "output_name", "dense_2" },
+			{ "activation", "relu" },
+		});
+
+		model->AddLayer(TF::LayerType::Dense,
+		{
+			{ "input_name", "dense_2" },
+			{ "units", 128 },
+			{ "output_name", "dense_3" },
+			{ "activation", "relu" },
+		});
+
+		model->AddLayer(TF::LayerType::Dense,
+		{
+			{ "input_name", "dense_3" },
+			{ "units", GetNumActionOutputs() },
+			{ "activation", "linear" },
+			{ "output_name", "action" },
+		});
+
+		if (!model->CreateModel())
+		{
+			UE_LOG(LogTemp, Display, TEXT("Failed To Create Model!"));
+			model = nullptr;
+		}
+	}
+
+
+	return model;
+}
+
+void FPolicyLearner::DispatchTraining(std::vector<FCompactTransition>&& trainingData)
+{
+	mNumSamplesTrained += trainingData.size();
+
+	QueueBehindTraining([trainingData = std::move(trainingData), this]()
+	{
+		TrainRound(trainingData);
+	});
+}
+
+void FPolicyLearner::QueueBehindTraining(TUniqueFunction<void()> task)
+{
+	const std::scoped_lock lock(mTaskMutex);
+
+	FGraphEventArray prerequisites;
+	if (mTrainingTask && !mTrainingTask->IsComplete())
+		prerequisites.Add(mTrainingTask);
+
+	mNumPendingTrainingRounds++;
+	mTrainingTask = FFunctionGraphTask::CreateAndDispatchWhenReady([task = MoveTemp(task), this]()
+	{
+		task();
+
+		mNumPendingTrainingRounds--;
+
+	}, TStatId(), &prerequisites, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void FPolicyLearner::WaitForTraining() const
+{
+	// Each task waits on the one queued before it, so the last one finishes after all of them.
+	FGraphEventRef task;
+	{
+		const std::scoped_lock lock(mTaskMutex);
+		task = mTrainingTask;
+	}
+
+	if (task)
+		task->Wait();
+}
+
+bool FPolicyLearner::IsTraining() const
+{
+	const std::scoped_lock lock(mTaskMutex);
+	return mTrainingTask && !mTrainingTask->IsComplete();
+}
+
+void FPolicyLearner::TrainRound(const std::vector<FCompactTransition>& trainingData)
+{
+	UE_LOG(LogTemp, Display, TEXT("NPC Starting Training..."));
+
+	if (mRoundReporter)
+		mRoundReporter(trainingData);
+
+	// Producers discard a checkpoint they loaded while training rewrote it.
+	FExperienceChannel* pChannel = mpExperienceChannel.load();
+	if (pChannel)
+		pChannel->BeginModelSave();
+
+	std::unique_lock checkpointLock(mCheckpointMutex);
+
+	double decodeTime_s = 0;
+	bool trained = false;
+	{
+		const FScopedStageTimer timer(mpStageTimings, EPerformanceStage::Training, static_cast<uint32>(trainingData.size()));
+		trained = TrainOnTransitions(*mpModel, mpTargetPolicy.get(), mSettings.mHyperparameters, trainingData, mSettings.mIndependentRows, decodeTime_s);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Replay Storage: %d Transitions At %d Bytes Each (%d Bytes Unencoded), Decoded At %.1fM States/s."),
+		   static_cast<int32>(trainingData.size()),
+		   static_cast<int32>(sizeof(FCompactTransition)),
+		   static_cast<int32>(sizeof(TrainingInfo)),
+		   decodeTime_s > 0 ? trainingData.size() / decodeTime_s / 1000000.0 : 0.0);
+
+	uint32 trainingRounds = 0;
+	if (!trained)
+	{
+		checkpointLock.unlock();
+
+		if (pChannel)
+			pChannel->EndModelSave();
+
+		UE_LOG(LogTemp, Warning, TEXT("NPC Training Failed!"));
+	}
+	else
+	{
+		trainingRounds = ++mTrainingRounds;
+
+		SaveInputNormalizer();
+		checkpointLock.unlock();
+
+		if (pChannel)
+			pChannel->EndModelSave();
+
+		// Decisions move on to a copy of the checkpoint training just saved, with the statistics it trained on.
+		std::shared_ptr<const FPolicySnapshot> pPolicy = PublishPolicy(CreateModel(mSettings.mModelName), mObservationStats, trainingRounds, TEXT("Trained Model"));
+
+		// The target network is that same read-only copy, it is never reloaded while a save is in progress.
+		if (pPolicy && mSettings.mUseActionValueHead && trainingRounds % FMath::Max(1, mSettings.mTargetUpdateInterval) == 0)
+			mpTargetPolicy = std::move(pPolicy);
+
+		// Training saved the model, the producers reload it by name.
+		if (pChannel)
+			pChannel->PublishModel(trainingRounds);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("NPC Finished Training..."));
+
+	if (trained && mGenerationSink)
+		mGenerationSink(trainingRounds);
+}
+
+bool FPolicyLearner::TrainOnTransitions(TF::MLModel& model,
+										const FPolicySnapshot* pTargetPolicy,
+										const FTrainingHyperparameters& hyperparameters,
+										const std::vector<FCompactTransition>& trainingData,
+										bool independentRows,
+										double& outDecodeTime_s)
+{
+	const int32 count = static_cast<int32>(trainingData.size());
+
+	// Decoded straight into the model input layout, in blocks across the worker threads.
+	const double decodeStart_s = FPlatformTime::Seconds();
+	std::vector<float> states(trainingData.size() * StateSize);
+	ParallelFor(FMath::DivideAndRoundUp(count, DecodeBlockSize), [&](int32 block)
+	{
+		const int32 end = FMath::Min((block + 1) * DecodeBlockSize, count);
+		for (int32 sample = block * DecodeBlockSize; sample < end; ++sample)
+			DecodeStateInputs(trainingData[sample].mState, states.data() + static_cast<size_t>(sample) * StateSize);
+	});
+	outDecodeTime_s += FPlatformTime::Seconds() - decodeStart_s;
+
+	// The value targets are estimated from the decoded states before they are normalized in place.
+	std::vector<float> actionTargets;
+	if (mSettings.mUseActionValueHead)
+		ComputeActionValueTargets(model, pTargetPolicy, hyperparameters.mLearningGamma, trainingData, states, actionTargets);
+
+	// The statistics move with every batch the model trains on.
+	if (const FObservationNormalizer* pNormalizer = GetInputNormalizer(model))
+	{
+		UpdateInputNormalizer(states, count);
+
+		const FScopedStageTimer timer(mpStageTimings, EPerformanceStage::Normalization, static_cast<uint32>(count));
+		pNormalizer->Normalize(states.data(), count);
+	}
+
+	// The value head regresses the per-action targets, the policy head the taken action.
+	if (!mSettings.mUseActionValueHead)
+	{
+		actionTargets.resize(trainingData.size());
+		for (size_t sample = 0; sample < trainingData.size(); ++sample)
+			actionTargets[sample] = trainingData[sample].mDirection_f;
+	}
+
+	// ForgeML weights each sample by its reward. The value targets already contain the reward,
+	// they are regressed with unit weights so negative or zero rewards do not flip or erase them.
+	std::vector<float> rewards(trainingData.size(), 1.0f);
+	if (!mSettings.mUseActionValueHead)
+	{
+		for (size_t sample = 0; sample < trainingData.size(); ++sample)
+			rewards[sample] = trainingData[sample].mReward;
+	}
+
+	return FeedAndTrain(model, states, actionTargets, rewards, GetNumActionOutputs(), hyperparameters, independentRows);
+}
+
+bool FPolicyLearner::TrainOnTargets(TF::MLModel& model,
+									const std::vector<float>& states,
+									const std::vector<float>& targets,
+									int32 count,
+									const FTrainingHyperparameters& hyperparameters)
+{
+	const size_t numOutputs = static_cast<size_t>(GetNumActionOutputs());
+	if (count <= 0 || targets.size() < static_cast<size_t>(count) * numOutputs)
+		return false;
+
+	const FObservationNormalizer* pNormalizer = GetInputNormalizer(model);
+
+	std::vector<float> normalizedStates;
+	if (pNormalizer)
+	{
+		UpdateInputNormalizer(states, count);
+
+		const FScopedStageTimer timer(mpStageTimings, EPerformanceStage::Normalization, static_cast<uint32>(count));
+		normalizedStates.assign(states.begin(), states.begin() + static_cast<size_t>(count) * StateSize);
+		pNormalizer->Normalize(normalizedStates.data(), count);
+	}
+
+	const std::vector<float>& inputs = pNormalizer ? normalizedStates : states;
+
+	// The target outputs are regressed directly, every sample is weighted alike.
+	const std::vector<float> rewards(static_cast<size_t>(count), 1.0f);
+
+	// Every row is a regression target of its own.
+	return FeedAndTrain(model, inputs, targets, rewards, static_cast<int32>(numOutputs), hyperparameters, true);
+}
+
+bool FPolicyLearner::DistillModel(TF::MLModel& teacher,
+								  TF::MLModel& student,
+								  const FTrainingHyperparameters& hyperparameters,
+								  const std::vector<FCompactTransition>& trainingData)
+{
+	const int32 count = static_cast<int32>(trainingData.size());
+
+	std::vector<float> states;
+	states.reserve(trainingData.size() * StateSize);
+	for (const FCompactTransition& info : trainingData)
+		AppendStateInputs(info.mState, states);
+
+	std::vector<float> teacherOutputs;
+	if (count == 0 || !mModelRunner(teacher, GetInputNormalizer(teacher), states, count, teacherOutputs))
+		return false;
+
+	return TrainOnTargets(student, states, teacherOutputs, count, hyperparameters);
+}
+
+void FPolicyLearner::ExportEvolvedPolicy(const std::vector<float>& states,
+										 const std::vector<float>& outputs,
+										 int32 count,
+										 int32 generation)
+{
+	// The model weights are not accessible, so the evolved policy is distilled into the model instead. Only
+	// this thread trains the model in evolution mode, decisions keep running the snapshot until the swap below.
+	// Producers discard a checkpoint they loaded while the distillation rewrote it.
+	FExperienceChannel* pChannel = mpExperienceChannel.load();
+	if (pChannel)
+		pChannel->BeginModelSave();
+
+	// Off the training chain, so evaluations are kept from copying the checkpoint while it is rewritten.
+	std::unique_lock checkpointLock(mCheckpointMutex);
+
+	if (!TrainOnTargets(*mpModel, states, outputs, count, mSettings.mHyperparameters))
+	{
+		checkpointLock.unlock();
+
+		if (pChannel)
+			pChannel->EndModelSave();
+
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Export Evolution Generation %d!"), generation);
+		return;
+	}
+
+	mNumSamplesTrained += count;
+
+	SaveInputNormalizer();
+	checkpointLock.unlock();
+
+	if (pChannel)
+		pChannel->EndModelSave();
+
+	// The distilled generation is saved, decisions and producers move on to it from the checkpoint.
+	const uint32 trainingRounds = ++mTrainingRounds;
+	PublishPolicy(CreateModel(mSettings.mModelName), mObservationStats, trainingRounds, TEXT("Evolved Model"));
+
+	if (pChannel)
+		pChannel->PublishModel(trainingRounds);
+
+	UE_LOG(LogTemp, Display, TEXT("Exported Evolution Generation %d As Model Generation %u On %d States."), generation, trainingRounds, count);
+
+	if (mGenerationSink)
+		mGenerationSink(trainingRounds);
+}
+
+std::shared_ptr<const FPolicySnapshot> FPolicyLearner::LoadCheckpoint()
+{
+	// Nothing else runs this copy, it is loaded and its statistics copied while no save is in progress.
+	std::shared_ptr<FPolicySnapshot> pPolicy = std::make_shared<FPolicySnapshot>();
+	{
+		const std::scoped_lock checkpointLock(mCheckpointMutex);
+		pPolicy->mpModel = CreateModel(mSettings.mModelName);
+		pPolicy->mGeneration = mTrainingRounds;
+		pPolicy->mNormalizer = mObservationStats;
+	}
+
+	if (!pPolicy->mpModel)
+		return nullptr;
+
+	return pPolicy;
+}
+
+std::shared_ptr<const FPolicySnapshot> FPolicyLearner::GetPolicy() const
+{
+	const std::shared_lock lock(mPolicyMutex);
+	return mpPolicy;
+}
+
+std::shared_ptr<const FPolicySnapshot> FPolicyLearner::PublishPolicy(std::unique_ptr<TF::MLModel> pModel,
+																	 const FObservationNormalizer& normalizer,
+																	 uint32 generation,
+																	 const TCHAR* reason)
+{
+	if (!pModel)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Load %s Snapshot!"), reason);
+		return nullptr;
+	}
+
+	// Warmed up before the swap, so no decision ever runs the cold model.
+	if (mModelWarmUp)
+		mModelWarmUp(*pModel, reason);
+
+	std::shared_ptr<FPolicySnapshot> pPolicy = std::make_shared<FPolicySnapshot>();
+	pPolicy->mpModel = std::move(pModel);
+	pPolicy->mGeneration = generation;
+	pPolicy->mNormalizer = normalizer;
+
+	// The previous snapshot is released outside the lock, or by the last thread still running it.
+	std::shared_ptr<const FPolicySnapshot> pPrevious;
+	{
+		const std::unique_lock lock(mPolicyMutex);
+		pPrevious = std::exchange(mpPolicy, pPolicy);
+	}
+
+	return pPolicy;
+}
+
+bool FPolicyLearner::LoadInputNormalizer(int32 version,
+										 FObservationNormalizer& outNormalizer) const
+{
+	return outNormalizer.Load(FObservationNormalizer::GetCheckpointPath(mSettings.mModelName, version));
+}
+
+bool FPolicyLearner::FeedAndTrain(TF::MLModel& model,
+								  const std::vector<float>& states,
+								  const std::vector<float>& targets,
+								  const std::vector<float>& rewards,
+								  int32 numOutputs,
+								  const FTrainingHyperparameters& hyperparameters,
+								  bool independentRows)
+{
+	if (targets.size() < rewards.size() * static_cast<size_t>(numOutputs))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Missing Training Targets!"));
+		return false;
+	}
+
+	// Rows with single step rewards are discounted by ForgeML in the order they are added, they stay in order.
+	FMinibatchAssembler assembler(mSettings.mAssemblyMinibatchSize, mSettings.mSeed + mNumAssembledBatches++, independentRows);
+
+	const FAssemblyStats stats = assembler.Feed(states, targets, rewards, numOutputs, [&model](nlohmann::json& state, nlohmann::json& target, float reward)
+	{
+		model.AddRewardData(state, target, reward);
+	});
+
+	const double trainStart_s = FPlatformTime::Seconds();
+	// Complete targets already contain their discounting, ForgeML must not discount them again.
+	const bool trained = model.TrainModel(hyperparameters.mTrainingEpochs,
+										  mSettings.mTrainingBatches,
+										  hyperparameters.mLearningRate,
+										  independentRows ? 0.0f : hyperparameters.mLearningGamma);
+	const double busyTime_s = stats.mFeedTime_s + FPlatformTime::Seconds() - trainStart_s;
+
+	UE_LOG(LogTemp, Display, TEXT("Learner Utilization: %.1f%%, %.2fms Waiting On %d Minibatches Of %d Samples."),
+		   busyTime_s > 0 ? busyTime_s * 100.0 / (busyTime_s + stats.mWaitTime_s) : 0.0,
+		   stats.mWaitTime_s * 1000.0,
+		   stats.mNumMinibatches,
+		   FMath::Max(1, mSettings.mAssemblyMinibatchSize));
+
+	return trained;
+}
+
+void FPolicyLearner::ComputeActionValueTargets(TF::MLModel& model,
+											   const FPolicySnapshot* pTargetPolicy,
+											   float gamma,
+											   const std::vector<FCompactTransition>& trainingData,
+											   const std::vector<float>& states,
+											   std::vector<float>& outTargets)
+{
+	const size_t numActions = static_cast<size_t>(EMoveDirection::COUNT);
+
+	std::vector<float> nextStates;
+	std::vector<size_t> bootstrapIndices;
+	for (size_t i = 0; i < trainingData.size(); ++i)
+	{
+		if (trainingData[i].BootstrapsFromNextState())
+		{
+			AppendStateInputs(trainingData[i].mNextState, nextStates);
+			bootstrapIndices.push_back(i);
+		}
+	}
+
+	// Untouched actions keep their current estimate so only the taken action is regressed.
+	if (!mModelRunner(model, GetInputNormalizer(model), states, static_cast<int32>(trainingData.size()), outTargets))
+		outTargets.assign(trainingData.size() * numActions, 0.0f);
+
+	// The target snapshot runs with the statistics its generation was trained with.
+	TF::MLModel& targetModel = pTargetPolicy ? *pTargetPolicy->mpModel : model;
+	const FObservationNormalizer* pTargetNormalizer = pTargetPolicy ? GetPolicyNormalizer(*pTargetPolicy) : GetInputNormalizer(model);
+
+	std::vector<float> nextValues;
+	if (!bootstrapIndices.empty() &&
+		!mModelRunner(targetModel, pTargetNormalizer, nextStates, static_cast<int32>(bootstrapIndices.size()), nextValues))
+	{
+		nextValues.assign(bootstrapIndices.size() * numActions, 0.0f);
+	}
+
+	WriteActionValueTargets(trainingData, bootstrapIndices, nextValues, gamma, outTargets);
+}
+
+const FObservationNormalizer* FPolicyLearner::GetInputNormalizer(const TF::MLModel& model) const
+{
+	// Population members keep raw observations, only the learner's model is normalized.
+	if (!mSettings.mNormalizeObservations || &model != mpModel.get())
+		return nullptr;
+
+	return &mObservationStats;
+}
+
+void FPolicyLearner::UpdateInputNormalizer(const std::vector<float>& states,
+										   int32 count)
+{
+	const FScopedStageTimer timer(mpStageTimings, EPerformanceStage::Normalization, static_cast<uint32>(count));
+	mObservationStats.Update(states.data(), count);
+}
+
+void FPolicyLearner::SaveInputNormalizer()
+{
+	if (mSettings.mNormalizeObservations && mpModel)
+		mObservationStats.Save(FObservationNormalizer::GetCheckpointPath(mSettings.mModelName, mpModel->GetModelVersion()));
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Templates/Function.h"
+
+#include "NPCDefines.h"
+#include "CompactTransition.h"
+#include "ObservationNormalizer.h"
+#include "StageTimings.h"
+
+#include "TFModelLib.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+class FExperienceChannel;
+
+// One training round running and one queued behind it, bounding the batches held by a learner.
+const int32 MaxPendingTrainingRounds = 2;
+
+
+/// <summary>
+/// The hyperparameters of a training round.
+/// </summary>
+struct FTrainingHyperparameters
+{
+	float mLearningRate = 0.001f;
+	float mLearningGamma = 0.95f;
+	int32 mTrainingEpochs = 32;
+};
+
+
+/// <summary>
+/// A read-only copy of a saved model generation that decisions are run with,
+/// so inference never runs the model the learner is training.
+/// </summary>
+struct FPolicySnapshot
+{
+	std::unique_ptr<TF::MLModel> mpModel = nullptr;
+	uint32 mGeneration = 0;
+
+	// The statistics the generation was trained with, published together with it.
+	FObservationNormalizer mNormalizer;
+};
+
+
+/// <summary>
+/// Settings of the policy learner.
+/// </summary>
+struct FPolicyLearnerSettings
+{
+	std::string mModelName;
+
+	// The value head regresses an estimate per move direction instead of the taken direction.
+	bool mUseActionValueHead = false;
+
+	// Whether every training row carries its complete regression target, the value head's bootstrapped
+	// action values or the trajectory returns, so no row depends on the next one.
+	bool mIndependentRows = false;
+
+	bool mNormalizeObservations = false;
+	float mNormalizationClip = 5.0f;
+
+	FTrainingHyperparameters mHyperparameters;
+	int32 mTrainingBatches = 4;
+	int32 mAssemblyMinibatchSize = 256;
+
+	// Training rounds between refreshes of the value head's target network.
+	int32 mTargetUpdateInterval = 4;
+
+	// Every assembled training batch is shuffled with its own seed derived from this one.
+	int32 mSeed = 0;
+};
+
+
+/// <summary>
+/// Runs a model over a batch of flattened states, normalizing them with the statistics unless null.
+/// </summary>
+using FModelRunner = std::function<bool(TF::MLModel& model,
+										const FObservationNormalizer* pNormalizer,
+										const std::vector<float>& states,
+										int32 count,
+										std::vector<float>& outOutputs)>;
+
+/// <summary>
+/// Warms a model up before decisions move on to it.
+/// </summary>
+using FModelWarmUp = std::function<void(TF::MLModel& model,
+										const TCHAR* reason)>;
+
+/// <summary>
+/// Reports on a training batch, called on the training task before the round trains on it.
+/// </summary>
+using FTrainingRoundReporter = std::function<void(const std::vector<FCompactTransition>& trainingData)>;
+
+/// <summary>
+/// Receives each generation the learner saved and published, called on the thread that trained it.
+/// </summary>
+using FGenerationSink = std::function<void(uint32 generation)>;
+
+
+/// <summary>
+/// The central learner. Trains the model on batches queued behind each other on background tasks,
+/// saves every round as a checkpoint together with the observation statistics it was trained with,
+/// and publishes a read-only copy of the checkpoint as the policy snapshot decisions are run with.
+/// </summary>
+class FPolicyLearner
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FPolicyLearner instance.
+	/// </summary>
+	/// <param name="settings">The learner settings</param>
+	/// <param name="pStageTimings">The stage timings training and normalization are recorded in, may be null</param>
+	/// <param name="modelRunner">The batched model run callback, used to estimate and distill targets</param>
+	/// <param name="modelWarmUp">The warm-up callback run on every published model, may be empty</param>
+	/// <param name="roundReporter">The training round report callback, may be empty</param>
+	/// <param name="generationSink">The published generation callback, may be empty</param>
+	FPolicyLearner(const FPolicyLearnerSettings& settings,
+				   FStageTimings* pStageTimings,
+				   const FModelRunner& modelRunner,
+				   const FModelWarmUp& modelWarmUp,
+				   const FTrainingRoundReporter& roundReporter,
+				   const FGenerationSink& generationSink);
+
+	/// <summary>
+	/// Destructor waiting for the queued training rounds.
+	/// </summary>
+	~FPolicyLearner();
+public:
+	/// <summary>
+	/// Loads or creates the model and the statistics it was trained with,
+	/// and publishes a copy of it as the first policy snapshot.
+	/// </summary>
+	/// <returns>False if the model could neither be loaded nor created</returns>
+	bool LoadModel();
+
+	/// <summary>
+	/// Creates a model with the learner's output head, loading it if it was saved before.
+	/// </summary>
+	/// <param name="modelName">The model name</param>
+	/// <returns>The model, null if it could neither be loaded nor created</returns>
+	std::unique_ptr<TF::MLModel> CreateModel(const std::string& modelName) const;
+
+	/// <summary>
+	/// Queues a training round over a batch behind the running round instead of waiting on it.
+	/// </summary>
+	/// <param name="trainingData">The training batch, moved from</param>
+	void DispatchTraining(std::vector<FCompactTransition>&& trainingData);
+
+	/// <summary>
+	/// Queues a task behind the training rounds, counted like a round so the rounds queued behind it
+	/// respect the same back-pressure.
+	/// </summary>
+	/// <param name="task">The task, run on a background thread</param>
+	void QueueBehindTraining(TUniqueFunction<void()> task);
+
+	/// <summary>
+	/// Waits for the queued training rounds and tasks.
+	/// </summary>
+	void WaitForTraining() const;
+
+	/// <summary>
+	/// Retrieves whether a training round or a task queued behind one is running.
+	/// </summary>
+	/// <returns>True if the learner is busy</returns>
+	bool IsTraining() const;
+
+	/// <summary>
+	/// Adds a batch of transitions to a model and trains it.
+	/// </summary>
+	/// <param name="model">The model to train</param>
+	/// <param name="pTargetPolicy">The snapshot bootstrapping the action values, the trained model if null</param>
+	/// <param name="hyperparameters">The training hyperparameters</param>
+	/// <param name="trainingData">The training batch</param>
+	/// <param name="independentRows">Whether every transition carries its complete target</param>
+	/// <param name="outDecodeTime_s">The time spent decoding the replay states</param>
+	/// <returns>True if the model trained successfully</returns>
+	bool TrainOnTransitions(TF::MLModel& model,
+							const FPolicySnapshot* pTargetPolicy,
+							const FTrainingHyperparameters& hyperparameters,
+							const std::vector<FCompactTransition>& trainingData,
+							bool independentRows,
+							double& outDecodeTime_s);
+
+	/// <summary>
+	/// Trains a model to reproduce target outputs over a batch of states.
+	/// </summary>
+	/// <param name="model">The model to train</param>
+	/// <param name="states">The flattened states</param>
+	/// <param name="targets">The target outputs, GetNumActionOutputs() per state</param>
+	/// <param name="count">The number of states</param>
+	/// <param name="hyperparameters">The training hyperparameters</param>
+	/// <returns>True if the model trained successfully</returns>
+	bool TrainOnTargets(TF::MLModel& model,
+						const std::vector<float>& states,
+						const std::vector<float>& targets,
+						int32 count,
+						const FTrainingHyperparameters& hyperparameters);
+
+	/// <summary>
+	/// Trains a student model on a teacher model's outputs over a batch of states.
+	/// </summary>
+	/// <param name="teacher">The teacher model</param>
+	/// <param name="student">The student model</param>
+	/// <param name="hyperparameters">The student training hyperparameters</param>
+	/// <param name="trainingData">The states to distill on</param>
+	/// <returns>True if the student trained successfully</returns>
+	bool DistillModel(TF::MLModel& teacher,
+					  TF::MLModel& student,
+					  const FTrainingHyperparameters& hyperparameters,
+					  const std::vector<FCompactTransition>& trainingData);
+
+	/// <summary>
+	/// Exports an evolved policy into the model by distilling its outputs, saves and publishes the
+	/// distilled generation. Called on the evolution trainer thread, off the training task chain.
+	/// </summary>
+	/// <param name="states">The states visited by the evolved policy</param>
+	/// <param name="outputs">The evolved policy's outputs on the states</param>
+	/// <param name="count">The number of states</param>
+	/// <param name="generation">The evolution generation</param>
+	void ExportEvolvedPolicy(const std::vector<float>& states,
+							 const std::vector<float>& outputs,
+							 int32 count,
+							 int32 generation);
+
+	/// <summary>
+	/// Loads a private copy of the latest checkpoint and the statistics saved with it, taken while
+	/// no checkpoint is being saved.
+	/// </summary>
+	/// <returns>The copy, null if the model failed to load</returns>
+	std::shared_ptr<const FPolicySnapshot> LoadCheckpoint();
+
+	/// <summary>
+	/// Retrieves the policy snapshot decisions are run with, held by the caller for the length of its run.
+	/// </summary>
+	/// <returns>The snapshot, null if no copy of the model could be loaded</returns>
+	std::shared_ptr<const FPolicySnapshot> GetPolicy() const;
+
+	/// <summary>
+	/// Warms a model up and swaps it in as the policy snapshot decisions are run with.
+	/// </summary>
+	/// <param name="pModel">The model, loaded from the latest checkpoint</param>
+	/// <param name="normalizer">The statistics the model was trained with</param>
+	/// <param name="generation">The training round that saved the checkpoint</param>
+	/// <param name="reason">What the model is published for, for the log</param>
+	/// <returns>The published snapshot, null if the model failed to load</returns>
+	std::shared_ptr<const FPolicySnapshot> PublishPolicy(std::unique_ptr<TF::MLModel> pModel,
+														 const FObservationNormalizer& normalizer,
+														 uint32 generation,
+														 const TCHAR* reason);
+
+	/// <summary>
+	/// Retrieves the input normalizer a policy snapshot runs with.
+	/// </summary>
+	/// <param name="policy">The policy snapshot</param>
+	/// <returns>The normalizer, null if the policy takes raw observations</returns>
+	inline const FObservationNormalizer* GetPolicyNormalizer(const FPolicySnapshot& policy) const { return mSettings.mNormalizeObservations ? &policy.mNormalizer : nullptr; }
+
+	/// <summary>
+	/// Loads the observation statistics saved alongside a model version.
+	/// </summary>
+	/// <param name="version">The model version</param>
+	/// <param name="outNormalizer">The loaded statistics</param>
+	/// <returns>False if none were saved for the version</returns>
+	bool LoadInputNormalizer(int32 version,
+							 FObservationNormalizer& outNormalizer) const;
+
+	/// <summary>
+	/// Sets the experience channel the saved generations are published to the producers through.
+	/// </summary>
+	/// <param name="pChannel">The channel, null to stop publishing</param>
+	inline void SetExperienceChannel(FExperienceChannel* pChannel) { mpExperienceChannel = pChannel; }
+public:
+	/// <summary>
+	/// Retrieves the name the model is saved under.
+	/// </summary>
+	/// <returns>The model name</returns>
+	inline const std::string& GetModelName() const { return mSettings.mModelName; }
+
+	/// <summary>
+	/// Retrieves the number of model outputs per state.
+	/// </summary>
+	/// <returns>The number of outputs</returns>
+	inline int32 GetNumActionOutputs() const { return mSettings.mUseActionValueHead ? static_cast<int32>(EMoveDirection::COUNT) : 1; }
+
+	/// <summary>
+	/// Retrieves the number of queued training rounds and tasks, including the running one.
+	/// </summary>
+	/// <returns>The number of pending rounds</returns>
+	inline int32 GetNumPendingTrainingRounds() const { return mNumPendingTrainingRounds.load(); }
+
+	/// <summary>
+	/// Retrieves the number of saved generations.
+	/// </summary>
+	/// <returns>The number of training rounds</returns>
+	inline uint32 GetNumTrainingRounds() const { return mTrainingRounds.load(); }
+
+	/// <summary>
+	/// Adopts the training rounds of the learner process a producer follows.
+	/// </summary>
+	/// <param name="trainingRounds">The number of training rounds</param>
+	inline void SetNumTrainingRounds(uint32 trainingRounds) { mTrainingRounds = trainingRounds; }
+
+	/// <summary>
+	/// Retrieves the number of samples dispatched to training rounds or distilled.
+	/// </summary>
+	/// <returns>The number of samples</returns>
+	inline uint64 GetNumSamplesTrained() const { return mNumSamplesTrained.load(); }
+private:
+	/// <summary>
+	/// Trains the model on a batch, saves and publishes the generation, run on the training task.
+	/// </summary>
+	/// <param name="trainingData">The training batch</param>
+	void TrainRound(const std::vector<FCompactTransition>& trainingData);
+
+	/// <summary>
+	/// Feeds a training batch to a model in minibatches packed on worker threads, then trains
+	/// the model on it and logs how much of the time the learner was busy.
+	/// </summary>
+	/// <param name="model">The model to train</param>
+	/// <param name="states">The flattened model inputs</param>
+	/// <param name="targets">The flattened regression targets, numOutputs per state</param>
+	/// <param name="rewards">The reward of each state</param>
+	/// <param name="numOutputs">The number of targets per state</param>
+	/// <param name="hyperparameters">The training hyperparameters</param>
+	/// <param name="independentRows">Whether every row carries its complete target, such rows are shuffled and not discounted again</param>
+	/// <returns>True if the model trained successfully</returns>
+	bool FeedAndTrain(TF::MLModel& model,
+					  const std::vector<float>& states,
+					  const std::vector<float>& targets,
+					  const std::vector<float>& rewards,
+					  int32 numOutputs,
+					  const FTrainingHyperparameters& hyperparameters,
+					  bool independentRows);
+
+	/// <summary>
+	/// Computes the per-action value regression targets of a training batch
+	/// using the target network to bootstrap non-terminal transitions.
+	/// </summary>
+	/// <param name="model">The trained model</param>
+	/// <param name="pTargetPolicy">The snapshot bootstrapping the next state values, the trained model if null</param>
+	/// <param name="gamma">The discount factor</param>
+	/// <param name="trainingData">The training batch</param>
+	/// <param name="states">The decoded, not yet normalized states of the training batch</param>
+	/// <param name="outTargets">The flattened per-action targets</param>
+	void ComputeActionValueTargets(TF::MLModel& model,
+								   const FPolicySnapshot* pTargetPolicy,
+								   float gamma,
+								   const std::vector<FCompactTransition>& trainingData,
+								   const std::vector<float>& states,
+								   std::vector<float>& outTargets);
+
+	/// <summary>
+	/// Retrieves the input normalizer a model trains with.
+	/// </summary>
+	/// <param name="model">The model</param>
+	/// <returns>The normalizer, null if the model takes raw observations</returns>
+	const FObservationNormalizer* GetInputNormalizer(const TF::MLModel& model) const;
+
+	/// <summary>
+	/// Merges a training batch into the observation statistics the model trains with, called on
+	/// the training task before the model trains on the batch. Inference only picks the statistics
+	/// up with the generation trained on them.
+	/// </summary>
+	/// <param name="states">The flattened raw states</param>
+	/// <param name="count">The number of states</param>
+	void UpdateInputNormalizer(const std::vector<float>& states,
+							   int32 count);
+
+	/// <summary>
+	/// Saves the observation statistics alongside the current model version.
+	/// </summary>
+	void SaveInputNormalizer();
+private:
+	FPolicyLearnerSettings mSettings;
+	FStageTimings* mpStageTimings = nullptr;
+
+	FModelRunner mModelRunner;
+	FModelWarmUp mModelWarmUp;
+	FTrainingRoundReporter mRoundReporter;
+	FGenerationSink mGenerationSink;
+
+	std::unique_ptr<TF::MLModel> mpModel = nullptr;
+
+	// Running statistics owned by the training task, published with each policy snapshot.
+	FObservationNormalizer mObservationStats;
+
+	// A published generation kept as the target network, only used by the training task.
+	std::shared_ptr<const FPolicySnapshot> mpTargetPolicy = nullptr;
+
+	// The learner trains mpModel, decisions run the snapshot swapped in after each round, guarded by the policy mutex.
+	std::shared_ptr<const FPolicySnapshot> mpPolicy = nullptr;
+	mutable std::shared_mutex mPolicyMutex;
+
+	// Held while mpModel trains and saves its checkpoint and statistics, and while evaluations copy them.
+	std::mutex mCheckpointMutex;
+
+	// Producers discard a checkpoint they loaded while it was rewritten.
+	std::atomic<FExperienceChannel*> mpExperienceChannel = nullptr;
+
+	// Guards the task chain, rounds and evaluations are queued from several threads.
+	mutable std::mutex mTaskMutex;
+	FGraphEventRef mTrainingTask;
+	std::atomic<int32> mNumPendingTrainingRounds = 0;
+
+	std::atomic<uint32> mTrainingRounds = 0;
+	std::atomic<uint64> mNumSamplesTrained = 0;
+	std::atomic<int32> mNumAssembledBatches = 0;
+};
@@ -0,0 +1,106 @@
+#include "PolicyNetwork.h"
+
+FPolicyNetwork::FPolicyNetwork(std::vector<int32> layerSizes)
+	: mLayerSizes(std::move(layerSizes))
+{
+	check(mLayerSizes.size() >= 2);
+
+	for (size_t layer = 1; layer < mLayerSizes.size(); ++layer)
+		mNumParameters += (mLayerSizes[layer - 1] + 1) * mLayerSizes[layer];
+}
+
+void FPolicyNetwork::InitializeParameters(FRandomStream& random,
+										  std::vector<float>& outParameters) const
+{
+	outParameters.assign(mNumParameters, 0.0f);
+
+	float* layerParameters = outParameters.data();
+	for (size_t layer = 1; layer < mLayerSizes.size(); ++layer)
+	{
+		const int32 numInputs = mLayerSizes[layer - 1];
+		const int32 numOutputs = mLayerSizes[layer];
+
+		// Uniform with the variance of a He normal initialization.
+		const float limit = FMath::Sqrt(6.0f / numInputs);
+		for (int32 i = 0; i < numInputs * numOutputs; ++i)
+			layerParameters[i] = random.FRandRange(-limit, limit);
+
+		layerParameters += (numInputs + 1) * numOutputs;
+	}
+}
+
+void FPolicyNetwork::Forward(const float* parameters,
+							 const float* inputs,
+							 int32 count,
+							 std::vector<float>& outOutputs) const
+{
+	std::vector<float> layerInputs(inputs, inputs + static_cast<size_t>(count) * GetNumInputs());
+
+	const float* layerParameters = parameters;
+	for (size_t layer = 1; layer < mLayerSizes.size(); ++layer)
+	{
+		const int32 numInputs = mLayerSizes[layer - 1];
+		const int32 numOutputs = mLayerSizes[layer];
+		const bool hidden = layer + 1 < mLayerSizes.size();
+
+		// Weights are stored input major followed by the biases, so the inner loop runs over contiguous outputs.
+		const float* weights = layerParameters;
+		const float* biases = layerParameters + static_cast<size_t>(numInputs) * numOutputs;
+
+		outOutputs.resize(static_cast<size_t>(count) * numOutputs);
+		for (int32 sample = 0; sample < count; ++sample)
+		{
+			const float* sampleInputs = layerInputs.data() + static_cast<size_t>(sample) * numInputs;
+			float* sampleOutputs = outOutputs.data() + static_cast<size_t>(sample) * numOutputs;
+
+			std::copy(biases, biases + numOutputs, sampleOutputs);
+			for (int32 i = 0; i < numInputs; ++i)
+			{
+				// Inputs zeroed by the previous relu contribute nothing.
+				const float input = sampleInputs[i];
+				if (input == 0.0f)
+					continue;
+
+				const float* row = weights + static_cast<size_t>(i) * numOutputs;
+				for (int32 o = 0; o < numOutputs; ++o)
+					sampleOutputs[o] += input * row[o];
+			}
+
+			if (hidden)
+			{
+				for (int32 o = 0; o < numOutputs; ++o)
+					sampleOutputs[o] = FMath::Max(sampleOutputs[o], 0.0f);
+			}
+		}
+
+		layerParameters += (numInputs + 1) * numOutputs;
+
+		if (hidden)
+			layerInputs.swap(outOutputs);
+	}
+}
+
+void FPolicyNetwork::SelectActions(const float* parameters,
+								   const std::vector<float>& states,
+								   int32 count,
+								   std::vector<std::tuple<EMoveDirection, float>>& outActions) const
+{
+	std::vector<float> outputs;
+	Forward(parameters, states.data(), count, outputs);
+
+	const int32 numOutputs = GetNumOutputs();
+
+	outActions.resize(count);
+	for (size_t i = 0; i < static_cast<size_t>(count); ++i)
+	{
+		if (numOutputs == static_cast<int32>(EMoveDirection::COUNT))
+		{
+			const EMoveDirection action = ActionFromValues(outputs.data() + i * numOutputs);
+			outActions[i] = { action, static_cast<float>(action) };
+		}
+		else
+		{
+			outActions[i] = { ActionFromValue(outputs[i * numOutputs]), outputs[i * numOutputs] };
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+
+#include "NPCDefines.h"
+
+#include <tuple>
+#include <vector>
+
+
+/// <summary>
+/// A native fully connected network mirroring the Dense layers of the navigator model,
+/// relu on the hidden layers and linear outputs. The network only describes the layer
+/// shapes, its parameters are passed in as a flat vector so many perturbed copies can
+/// be evaluated concurrently.
+/// </summary>
+class FPolicyNetwork
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FPolicyNetwork instance.
+	/// </summary>
+	/// <param name="layerSizes">The number of units per layer, starting with the inputs</param>
+	explicit FPolicyNetwork(std::vector<int32> layerSizes);
+public:
+	/// <summary>
+	/// Draws initial parameters, He scaled weights and zero biases.
+	/// </summary>
+	/// <param name="random">The random stream</param>
+	/// <param name="outParameters">The output parameters</param>
+	void InitializeParameters(FRandomStream& random,
+							  std::vector<float>& outParameters) const;
+
+	/// <summary>
+	/// Runs a batch of inputs through the network.
+	/// </summary>
+	/// <param name="parameters">The flat parameters</param>
+	/// <param name="inputs">The inputs, count times the number of inputs</param>
+	/// <param name="count">The batch size</param>
+	/// <param name="outOutputs">The outputs, count times the number of outputs</param>
+	void Forward(const float* parameters,
+				 const float* inputs,
+				 int32 count,
+				 std::vector<float>& outOutputs) const;
+
+	/// <summary>
+	/// Runs a batch of states through the network and decodes the actions like the model outputs.
+	/// </summary>
+	/// <param name="parameters">The flat parameters</param>
+	/// <param name="states">The flattened states</param>
+	/// <param name="count">The batch size</param>
+	/// <param name="outActions">The selected actions</param>
+	void SelectActions(const float* parameters,
+					   const std::vector<float>& states,
+					   int32 count,
+					   std::vector<std::tuple<EMoveDirection, float>>& outActions) const;
+public:
+	/// <summary>
+	/// Retrieves the number of parameters.
+	/// </summary>
+	/// <returns>The number of weights and biases</returns>
+	inline int32 GetNumParameters() const { return mNumParameters; }
+
+	/// <summary>
+	/// Retrieves the number of inputs.
+	/// </summary>
+	/// <returns>The input size</returns>
+	inline int32 GetNumInputs() const { return mLayerSizes.front(); }
+
+	/// <summary>
+	/// Retrieves the number of outputs.
+	/// </summary>
+	/// <returns>The output size</returns>
+	inline int32 GetNumOutputs() const { return mLayerSizes.back(); }
+private:
+	std::vector<int32> mLayerSizes;
+	int32 mNumParameters = 0;
+};
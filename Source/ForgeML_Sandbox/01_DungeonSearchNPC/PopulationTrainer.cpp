@@ -0,0 +1,255 @@
+#include "PopulationTrainer.h"
+
+#include <algorithm>
+#include <utility>
+
+FPopulationTrainer::FPopulationTrainer(const FPopulationSettings& settings,
+									   FPolicyLearner& learner)
+	: mSettings(settings),
+	mLearner(learner),
+	mRandom(static_cast<int32>(settings.mSeed))
+{
+}
+
+FPopulationTrainer::~FPopulationTrainer()
+{
+	Stop();
+}
+
+bool FPopulationTrainer::Start()
+{
+	for (int32 i = 0; i < mSettings.mPopulationSize; ++i)
+	{
+		std::unique_ptr<FPopulationMember> member = std::make_unique<FPopulationMember>();
+		member->mIndex = i;
+		member->mModelName = mLearner.GetModelName() + "_Member" + std::to_string(i);
+		member->mpModel = mLearner.CreateModel(member->mModelName);
+
+		std::shared_ptr<FPolicySnapshot> pPolicy = std::make_shared<FPolicySnapshot>();
+		pPolicy->mpModel = mLearner.CreateModel(member->mModelName);
+		member->mpPolicy = std::move(pPolicy);
+
+		if (!member->mpModel || !member->mpPolicy->mpModel)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed To Create Population Member %d!"), i);
+			mPopulation.clear();
+			return false;
+		}
+
+		// The first member keeps the configured settings as the baseline.
+		member->mHyperparameters = mSettings.mHyperparameters;
+		if (i > 0)
+			PerturbHyperparameters(member->mHyperparameters);
+
+		member->mTrainingData.reserve(mSettings.mMaxTrainingBatches);
+		mPopulation.emplace_back(std::move(member));
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Started Population Of %d Members."), mSettings.mPopulationSize);
+	return true;
+}
+
+void FPopulationTrainer::Stop()
+{
+	// Rollout workers are stopped first, so no new training task is dispatched.
+	for (const std::unique_ptr<FPopulationMember>& member : mPopulation)
+	{
+		if (member->mTrainingTask)
+			member->mTrainingTask->Wait();
+	}
+
+	for (const std::unique_ptr<FPopulationMember>& member : mPopulation)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Population Member %d: %.1f%% Find Rate, %u Rounds, %d Exploits, Learning Rate %f, Gamma %f, %d Epochs."),
+			   member->mIndex,
+			   member->mFitness.load() * 100.0f,
+			   member->mTrainingRounds.load(),
+			   member->mNumExploits,
+			   member->mHyperparameters.mLearningRate,
+			   member->mHyperparameters.mLearningGamma,
+			   member->mHyperparameters.mTrainingEpochs);
+	}
+
+	mPopulation.clear();
+}
+
+void FPopulationTrainer::OnReceiveRolloutData(int32 memberIndex,
+											   std::vector<TrainingInfo>& transitions)
+{
+	FPopulationMember& member = *mPopulation[memberIndex];
+	const std::scoped_lock lock(member.mMutex);
+
+	for (const TrainingInfo& info : transitions)
+	{
+		if (info.IsTerminal())
+		{
+			const bool foundTreasure = info.mEvent == ETransitionEvent::FoundTreasure;
+
+			member.mRecentEpisodeOutcomes.push_back(foundTreasure);
+			member.mRecentTreasureFinds += foundTreasure ? 1 : 0;
+
+			if (static_cast<int32>(member.mRecentEpisodeOutcomes.size()) > mSettings.mFindRateWindow)
+			{
+				member.mRecentTreasureFinds -= member.mRecentEpisodeOutcomes.front() ? 1 : 0;
+				member.mRecentEpisodeOutcomes.pop_front();
+			}
+
+			member.mFitness = static_cast<float>(member.mRecentTreasureFinds) / member.mRecentEpisodeOutcomes.size();
+		}
+
+		member.mTrainingData.emplace_back(EncodeTransition(info));
+	}
+
+	mNumSamplesReceived += transitions.size();
+
+	if (member.mTrainingData.size() >= static_cast<size_t>(mSettings.mMaxTrainingBatches) && member.mNumPendingTrainingRounds.load() < MaxPendingTrainingRounds)
+		DispatchTraining(member);
+}
+
+void FPopulationTrainer::DispatchTraining(FPopulationMember& member)
+{
+	std::vector<FCompactTransition> localTrainingData = std::move(member.mTrainingData);
+
+	member.mTrainingData = std::vector<FCompactTransition>();
+	member.mTrainingData.reserve(mSettings.mMaxTrainingBatches);
+
+	// Queued behind the member's running round, the member's rollout workers push under its mutex.
+	FGraphEventArray prerequisites;
+	if (member.mTrainingTask && !member.mTrainingTask->IsComplete())
+		prerequisites.Add(member.mTrainingTask);
+
+	// Each member learns on its own task, so the population trains across the background threads.
+	member.mNumPendingTrainingRounds++;
+	member.mTrainingTask = FFunctionGraphTask::CreateAndDispatchWhenReady([localTrainingData = std::move(localTrainingData), &member, this]()
+	{
+		FTrainingHyperparameters hyperparameters;
+		{
+			const std::scoped_lock lock(mPopulationMutex);
+			hyperparameters = member.mHyperparameters;
+		}
+
+		// Member rollouts bypass the trajectory buffer, their one-step rewards are discounted by ForgeML in order.
+		double decodeTime_s = 0;
+		if (mLearner.TrainOnTransitions(*member.mpModel, nullptr, hyperparameters, localTrainingData, mSettings.mIndependentRows, decodeTime_s))
+		{
+			mNumTrainingRounds++;
+
+			if (++member.mTrainingRounds % FMath::Max(1, mSettings.mExploitInterval) == 0)
+				Exploit(member, localTrainingData);
+
+			PublishMemberPolicy(member);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Population Member %d Training Failed!"), member.mIndex);
+		}
+
+		member.mNumPendingTrainingRounds--;
+
+	}, TStatId(), &prerequisites, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void FPopulationTrainer::PublishMemberPolicy(FPopulationMember& member)
+{
+	std::shared_ptr<FPolicySnapshot> pPolicy = std::make_shared<FPolicySnapshot>();
+	pPolicy->mpModel = mLearner.CreateModel(member.mModelName);
+	pPolicy->mGeneration = member.mTrainingRounds.load();
+	if (!pPolicy->mpModel)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Load Population Member %d Snapshot!"), member.mIndex);
+		return;
+	}
+
+	std::shared_ptr<const FPolicySnapshot> pPrevious;
+	{
+		const std::unique_lock lock(mPolicyMutex);
+		pPrevious = std::exchange(member.mpPolicy, std::move(pPolicy));
+	}
+}
+
+std::shared_ptr<const FPolicySnapshot> FPopulationTrainer::GetMemberPolicy(int32 memberIndex) const
+{
+	const std::shared_lock lock(mPolicyMutex);
+	return mPopulation[memberIndex]->mpPolicy;
+}
+
+void FPopulationTrainer::Exploit(FPopulationMember& member,
+								 const std::vector<FCompactTransition>& trainingData)
+{
+	const FPopulationMember* pSource = nullptr;
+	FTrainingHyperparameters hyperparameters;
+	{
+		const std::scoped_lock lock(mPopulationMutex);
+
+		std::vector<const FPopulationMember*> ranking;
+		for (const std::unique_ptr<FPopulationMember>& other : mPopulation)
+			ranking.push_back(other.get());
+
+		std::stable_sort(ranking.begin(), ranking.end(), [](const FPopulationMember* a, const FPopulationMember* b)
+		{
+			return a->mFitness.load() > b->mFitness.load();
+		});
+
+		// The bottom members are replaced by the top members, the rest keep training undisturbed.
+		const int32 numRanked = static_cast<int32>(ranking.size());
+		const int32 numReplaced = FMath::Clamp(FMath::FloorToInt(numRanked * mSettings.mExploitFraction), 1, numRanked / 2);
+
+		const int32 rank = static_cast<int32>(std::find(ranking.begin(), ranking.end(), &member) - ranking.begin());
+		if (rank < numRanked - numReplaced)
+			return;
+
+		pSource = ranking[mRandom.RandRange(0, numReplaced - 1)];
+		if (pSource->mFitness.load() <= member.mFitness.load())
+			return;
+
+		hyperparameters = pSource->mHyperparameters;
+		PerturbHyperparameters(hyperparameters);
+	}
+
+	// The source keeps training on its own task, so the snapshot its workers act with is distilled instead.
+	std::shared_ptr<const FPolicySnapshot> pSourcePolicy;
+	{
+		const std::shared_lock lock(mPolicyMutex);
+		pSourcePolicy = pSource->mpPolicy;
+	}
+
+	// ForgeML exposes no weights to copy, so rather than PBT's weight copy the member is only
+	// pulled towards the source policy by regressing its outputs on this round's states.
+	if (!mLearner.DistillModel(*pSourcePolicy->mpModel, *member.mpModel, hyperparameters, trainingData))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Population Member %d Failed To Exploit Member %d!"), member.mIndex, pSource->mIndex);
+		return;
+	}
+
+	{
+		const std::scoped_lock lock(mPopulationMutex);
+		member.mHyperparameters = hyperparameters;
+	}
+	member.mNumExploits++;
+
+	UE_LOG(LogTemp, Display, TEXT("Population Member %d (%.1f%%) Distilled Member %d (%.1f%%): Learning Rate %f, Gamma %f, %d Epochs."),
+		   member.mIndex,
+		   member.mFitness.load() * 100.0f,
+		   pSource->mIndex,
+		   pSource->mFitness.load() * 100.0f,
+		   hyperparameters.mLearningRate,
+		   hyperparameters.mLearningGamma,
+		   hyperparameters.mTrainingEpochs);
+}
+
+void FPopulationTrainer::PerturbHyperparameters(FTrainingHyperparameters& hyperparameters)
+{
+	const float scale = 1.0f + FMath::Max(0.0f, mSettings.mPerturbation);
+	auto perturb = [this, scale](float value)
+	{
+		return mRandom.FRand() < 0.5f ? value / scale : value * scale;
+	};
+
+	hyperparameters.mLearningRate = FMath::Clamp(perturb(hyperparameters.mLearningRate), 1e-6f, 0.1f);
+
+	// Gamma is perturbed through its horizon 1 / (1 - gamma) so it never reaches 1.
+	const float horizon = perturb(1.0f / (1.0f - FMath::Min(hyperparameters.mLearningGamma, 0.999f)));
+	hyperparameters.mLearningGamma = FMath::Clamp(1.0f - 1.0f / horizon, 0.5f, 0.999f);
+
+	hyperparameters.mTrainingEpochs = FMath::Clamp(FMath::RoundToInt(perturb(static_cast<float>(hyperparameters.mTrainingEpochs))), 1, 256);
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Math/RandomStream.h"
+
+#include "NPCDefines.h"
+#include "CompactTransition.h"
+#include "PolicyLearner.h"
+
+#include "TFModelLib.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+
+/// <summary>
+/// A population based training member with its own model, hyperparameters,
+/// share of the rollout workers and learner task.
+/// </summary>
+struct FPopulationMember
+{
+	int32 mIndex = 0;
+	std::string mModelName;
+	std::unique_ptr<TF::MLModel> mpModel = nullptr;
+
+	// The copy the member's rollout workers act with and other members distill, guarded by the trainer's policy mutex.
+	std::shared_ptr<const FPolicySnapshot> mpPolicy = nullptr;
+
+	// Guarded by the trainer's population mutex.
+	FTrainingHyperparameters mHyperparameters;
+
+	// Guards the training data and the episode outcomes.
+	std::mutex mMutex;
+	std::vector<FCompactTransition> mTrainingData;
+	std::deque<bool> mRecentEpisodeOutcomes;
+	int32 mRecentTreasureFinds = 0;
+
+	// The recent treasure find rate members are ranked by.
+	std::atomic<float> mFitness = 0;
+
+	FGraphEventRef mTrainingTask;
+	std::atomic<int32> mNumPendingTrainingRounds = 0;
+	std::atomic<uint32> mTrainingRounds = 0;
+	int32 mNumExploits = 0;
+};
+
+
+/// <summary>
+/// Settings of the population based trainer.
+/// </summary>
+struct FPopulationSettings
+{
+	int32 mPopulationSize = 2;
+
+	// Member training rounds between the member's exploit steps.
+	int32 mExploitInterval = 4;
+
+	// The share of the ranked members replaced by the top members at their exploit step.
+	float mExploitFraction = 0.25f;
+
+	// Each perturbed hyperparameter is scaled up or down by 1 + mPerturbation.
+	float mPerturbation = 0.2f;
+
+	// The hyperparameters the first member keeps and the others are perturbed from.
+	FTrainingHyperparameters mHyperparameters;
+
+	int32 mMaxTrainingBatches = 100;
+
+	// The episodes a member's treasure find rate is measured over.
+	int32 mFindRateWindow = 100;
+
+	// Whether every training row carries its complete regression target.
+	bool mIndependentRows = false;
+
+	// Seeds the perturbations and the exploit source draws.
+	uint32 mSeed = 0;
+};
+
+
+/// <summary>
+/// Population based training. Each member trains its own model on its share of the rollout workers,
+/// on its own task, and periodically pulls the bottom members towards the top members and perturbs
+/// their hyperparameters. The models are created and trained through the central learner.
+/// </summary>
+class FPopulationTrainer
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FPopulationTrainer instance.
+	/// </summary>
+	/// <param name="settings">The population settings</param>
+	/// <param name="learner">The learner creating and training the member models, outlives the trainer</param>
+	FPopulationTrainer(const FPopulationSettings& settings,
+					   FPolicyLearner& learner);
+
+	/// <summary>
+	/// Destructor waiting for the member training tasks.
+	/// </summary>
+	~FPopulationTrainer();
+public:
+	/// <summary>
+	/// Creates the population members, each with its own model and perturbed hyperparameters.
+	/// </summary>
+	/// <returns>False if a member model could not be created</returns>
+	bool Start();
+
+	/// <summary>
+	/// Waits for the member training tasks, logs the final ranking and releases the members.
+	/// </summary>
+	void Stop();
+
+	/// <summary>
+	/// On ReceiveRolloutData callback of the rollout workers owned by a population member.
+	/// </summary>
+	/// <param name="memberIndex">The population member</param>
+	/// <param name="transitions">The transitions</param>
+	void OnReceiveRolloutData(int32 memberIndex,
+							  std::vector<TrainingInfo>& transitions);
+
+	/// <summary>
+	/// Retrieves the policy snapshot a member's rollout workers act with.
+	/// </summary>
+	/// <param name="memberIndex">The population member</param>
+	/// <returns>The snapshot</returns>
+	std::shared_ptr<const FPolicySnapshot> GetMemberPolicy(int32 memberIndex) const;
+
+	/// <summary>
+	/// Retrieves the number of population members.
+	/// </summary>
+	/// <returns>The number of members</returns>
+	inline int32 GetNumMembers() const { return static_cast<int32>(mPopulation.size()); }
+
+	/// <summary>
+	/// Retrieves the number of training rounds across all members.
+	/// </summary>
+	/// <returns>The number of training rounds</returns>
+	inline uint32 GetNumTrainingRounds() const { return mNumTrainingRounds.load(); }
+
+	/// <summary>
+	/// Retrieves the number of transitions received from the members' rollout workers.
+	/// </summary>
+	/// <returns>The number of transitions</returns>
+	inline uint64 GetNumSamplesReceived() const { return mNumSamplesReceived.load(); }
+private:
+	/// <summary>
+	/// Dispatches a member's training task over its accumulated training data,
+	/// queued behind the member's running round.
+	/// Expects the member mutex to be held.
+	/// </summary>
+	/// <param name="member">The population member</param>
+	void DispatchTraining(FPopulationMember& member);
+
+	/// <summary>
+	/// Swaps in a copy of a member's latest checkpoint as the policy its rollout workers act with.
+	/// </summary>
+	/// <param name="member">The population member</param>
+	void PublishMemberPolicy(FPopulationMember& member);
+
+	/// <summary>
+	/// Pulls a bottom ranked member towards a top ranked member by distilling the top member's
+	/// policy snapshot, and moves on to a perturbation of its hyperparameters.
+	/// </summary>
+	/// <param name="member">The population member that finished a training round</param>
+	/// <param name="trainingData">The member's last training batch, used as distillation states</param>
+	void Exploit(FPopulationMember& member,
+				 const std::vector<FCompactTransition>& trainingData);
+
+	/// <summary>
+	/// Scales each hyperparameter up or down by the population perturbation.
+	/// Expects the population mutex to be held.
+	/// </summary>
+	/// <param name="hyperparameters">The hyperparameters to perturb</param>
+	void PerturbHyperparameters(FTrainingHyperparameters& hyperparameters);
+private:
+	FPopulationSettings mSettings;
+	FPolicyLearner& mLearner;
+
+	// Guards the member hyperparameters and the random stream.
+	std::mutex mPopulationMutex;
+	std::vector<std::unique_ptr<FPopulationMember>> mPopulation;
+	FRandomStream mRandom;
+
+	// Guards the members' policy snapshots.
+	mutable std::shared_mutex mPolicyMutex;
+
+	std::atomic<uint32> mNumTrainingRounds = 0;
+	std::atomic<uint64> mNumSamplesReceived = 0;
+};
@@ -23,7 +23,7 @@ void ARandomNPCActor::TickActor(float DeltaTime,
 	}
 	else
 	{
-		mCurrentDirection = static_cast<EMoveDirection>(FMath::RandRange((int)EMoveDirection::None, (int)EMoveDirection::COUNT));
+		mCurrentDirection = static_cast<EMoveDirection>(mRandom.RandRange((int)EMoveDirection::None, (int)EMoveDirection::COUNT));
 		mTime_s = 0;
 	}
 }
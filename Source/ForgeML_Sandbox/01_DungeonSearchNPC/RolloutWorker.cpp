@@ -0,0 +1,90 @@
+#include "RolloutWorker.h"
+
+#include "HAL/RunnableThread.h"
+
+// Transitions are handed to the learner in chunks to keep lock contention low.
+static const size_t TransitionFlushSize = 256;
+
+FRolloutWorker::FRolloutWorker(int32 workerIndex,
+							   std::unique_ptr<FHeadlessDungeon> pDungeon,
+							   float stepTime_s,
+							   const FBatchActionSelector& actionSelector,
+							   const FTransitionSink& transitionSink)
+	: mWorkerIndex(workerIndex),
+	mStepTime_s(stepTime_s),
+	mpDungeon(std::move(pDungeon)),
+	mActionSelector(actionSelector),
+	mTransitionSink(transitionSink),
+	mRandom(workerIndex)
+{
+}
+
+FRolloutWorker::~FRolloutWorker()
+{
+	if (mpThread)
+	{
+		mpThread->Kill(true);
+		delete mpThread;
+		mpThread = nullptr;
+	}
+}
+
+void FRolloutWorker::Start()
+{
+	if (mpThread)
+		return;
+
+	mpThread = FRunnableThread::Create(this, *FString::Printf(TEXT("RolloutWorker_%d"), mWorkerIndex));
+}
+
+uint32 FRolloutWorker::Run()
+{
+	std::vector<int32> decisions;
+	std::vector<float> states;
+	std::vector<std::tuple<EMoveDirection, float>> actions;
+	std::vector<TrainingInfo> transitions;
+
+	while (!mStopRequested.load(std::memory_order_relaxed))
+	{
+		decisions.clear();
+		mpDungeon->Step(mStepTime_s, decisions, transitions);
+
+		if (!decisions.empty())
+		{
+			// Batch every decision of this step into a single policy call.
+			states.clear();
+			for (int32 index : decisions)
+				mpDungeon->GetObservation(index, states);
+
+			actions.clear();
+			mActionSelector(states, static_cast<int32>(decisions.size()), mRandom, actions);
+
+			for (size_t i = 0; i < decisions.size() && i < actions.size(); ++i)
+			{
+				const auto [dir, dir_f] = actions[i];
+				mpDungeon->ApplyDecision(decisions[i], dir, dir_f);
+			}
+		}
+
+		if (transitions.size() >= TransitionFlushSize)
+		{
+			mNumTransitions.fetch_add(transitions.size(), std::memory_order_relaxed);
+			mTransitionSink(transitions);
+			transitions.clear();
+		}
+	}
+
+	// The transitions of the last partial chunk are still handed over when stopping.
+	if (!transitions.empty())
+	{
+		mNumTransitions.fetch_add(transitions.size(), std::memory_order_relaxed);
+		mTransitionSink(transitions);
+	}
+
+	return 0;
+}
+
+void FRolloutWorker::Stop()
+{
+	mStopRequested = true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+#include "HeadlessDungeon.h"
+
+#include <atomic>
+#include <functional>
+#include <tuple>
+
+class FRunnableThread;
+
+
+/// <summary>
+/// Selects actions for a batch of flattened states.
+/// </summary>
+using FBatchActionSelector = std::function<void(const std::vector<float>& states,
+												int32 count,
+												FRandomStream& random,
+												std::vector<std::tuple<EMoveDirection, float>>& outActions)>;
+
+/// <summary>
+/// Receives a batch of training transitions produced by a rollout worker.
+/// </summary>
+using FTransitionSink = std::function<void(std::vector<TrainingInfo>& transitions)>;
+
+
+/// <summary>
+/// A rollout worker thread stepping its own headless dungeon instance
+/// and streaming the resulting transitions to the central learner.
+/// </summary>
+class FRolloutWorker : public FRunnable
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FRolloutWorker instance.
+	/// </summary>
+	/// <param name="workerIndex">The worker index, used for naming and seeding</param>
+	/// <param name="pDungeon">The headless dungeon the worker owns</param>
+	/// <param name="stepTime_s">The fixed simulation time step</param>
+	/// <param name="actionSelector">The batched policy callback</param>
+	/// <param name="transitionSink">The learner transition callback</param>
+	FRolloutWorker(int32 workerIndex,
+				   std::unique_ptr<FHeadlessDungeon> pDungeon,
+				   float stepTime_s,
+				   const FBatchActionSelector& actionSelector,
+				   const FTransitionSink& transitionSink);
+
+	/// <summary>
+	/// Destructor stopping and joining the worker thread.
+	/// </summary>
+	virtual ~FRolloutWorker();
+public:
+	/// <summary>
+	/// Starts the worker thread.
+	/// </summary>
+	void Start();
+
+	/// <summary>
+	/// Runs the rollout loop until stopped.
+	/// </summary>
+	/// <returns>The exit code</returns>
+	virtual uint32 Run() override;
+
+	/// <summary>
+	/// Requests the rollout loop to stop.
+	/// </summary>
+	virtual void Stop() override;
+
+	/// <summary>
+	/// Retrieves the number of transitions produced so far.
+	/// </summary>
+	/// <returns>The number of transitions</returns>
+	inline uint64 GetNumTransitions() const { return mNumTransitions.load(std::memory_order_relaxed); }
+private:
+	int32 mWorkerIndex = 0;
+	float mStepTime_s = 0;
+
+	std::unique_ptr<FHeadlessDungeon> mpDungeon;
+
+	FBatchActionSelector mActionSelector;
+	FTransitionSink mTransitionSink;
+
+	FRandomStream mRandom;
+
+	std::atomic<bool> mStopRequested = false;
+	std::atomic<uint64> mNumTransitions = 0;
+
+	FRunnableThread* mpThread = nullptr;
+};
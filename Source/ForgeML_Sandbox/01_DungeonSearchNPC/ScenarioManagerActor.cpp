@@ -1,104 +1,589 @@
 #include "ScenarioManagerActor.h"
 
 #include "Engine/World.h"
-
+#include "Engine/StaticMesh.h"
+#include "EngineUtils.h"
+#include "Misc/App.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Misc/FileHelper.h"
+
+#include "DungeonObjectChannels.h"
 #include "RandomNPCActor.h"
 #include "LearningNPCActor.h"
 
+#include <algorithm>
+#include <utility>
+
+// The fraction of decisions taking a random action while learning.
+static const float ExplorationRate = 0.3f;
+
+// Contact flags of the batched contact detection, set while an agent touches a hazard or the treasure.
+static const uint8 HazardContact = 1 << 0;
+static const uint8 TreasureContact = 1 << 1;
+
+// The most producer transitions the learner takes from the experience channel per tick.
+static const int32 MaxChannelTransitionsPerTick = 4096;
+
+// The movement modes of the benchmark passes, 0 swept and 1 kinematic. An untimed pass of each warms
+// the caches, the timed passes then run swept, kinematic, kinematic, swept so neither mode always runs second.
+static const int32 MovementBenchmarkPasses[] = { 0, 1, 0, 1, 1, 0 };
+static const int32 NumMovementWarmUpPasses = 2;
+static const int32 NumTimedPassesPerMode = 2;
+
+/// <summary>
+/// Draws a uniformly random action.
+/// </summary>
+/// <param name="random">The random stream</param>
+/// <returns>The action and its regressed value</returns>
+static std::tuple<EMoveDirection, float> DrawRandomAction(FRandomStream& random)
+{
+	const EMoveDirection action = static_cast<EMoveDirection>(random.RandRange((int)EMoveDirection::None, (int)EMoveDirection::COUNT - 1));
+	return { action, static_cast<float>(action) };
+}
+
+/// <summary>
+/// Gathers the states of a subset of a batch into a contiguous batch.
+/// </summary>
+/// <param name="states">The flattened states of the batch</param>
+/// <param name="indices">The samples to gather</param>
+/// <param name="outStates">The gathered flattened states</param>
+static void GatherStates(const std::vector<float>& states,
+						 const std::vector<int32>& indices,
+						 std::vector<float>& outStates)
+{
+	outStates.clear();
+	outStates.reserve(indices.size() * StateSize);
+	for (int32 index : indices)
+	{
+		const auto begin = states.begin() + static_cast<size_t>(index) * StateSize;
+		outStates.insert(outStates.end(), begin, begin + StateSize);
+	}
+}
+
+/// <summary>
+/// Moves the tagged dungeon object components of an actor onto their object channels.
+/// </summary>
+/// <param name="actor">The actor</param>
+static void AssignDungeonObjectChannels(AActor* actor)
+{
+	TInlineComponentArray<UPrimitiveComponent*> components(actor);
+	for (UPrimitiveComponent* component : components)
+		AssignDungeonObjectChannel(component);
+}
+
 AScenarioManagerActor::AScenarioManagerActor()
 {
-	PrimaryActorTick.bCanEverTick = false;
+	// Ticking is only enabled by the modes the manager drives itself.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	// Runs after the agents have moved for the frame.
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
 }
 
 void AScenarioManagerActor::BeginPlay()
 {
 	Super::BeginPlay();
 
-	mpDataBuilder = std::make_unique<TF::FlatFloatDataBuilder>((NumRayCasts * 2) + 1,
-															   std::vector<int64_t>{ (NumRayCasts * 2) + 1 });
+	const float fixedStep_s = FApp::UseFixedTimeStep() ? static_cast<float>(FApp::GetFixedDeltaTime()) : 0.0f;
+
+	if (!mReplayDecisionsPath.IsEmpty())
+	{
+		mpReplay = FDecisionRecording::Load(mReplayDecisionsPath);
+		if (mpReplay)
+		{
+			mRandomSeed = mpReplay->GetSeed();
+
+			// Frame rate dependent movement only reproduces with the recorded time step.
+			if (!FMath::IsNearlyEqual(fixedStep_s, mpReplay->GetFixedStep_s()))
+				UE_LOG(LogTemp, Warning, TEXT("Replaying A Recording Made With A %.4fs Fixed Step At %.4fs, The Agents Will Diverge!"), mpReplay->GetFixedStep_s(), fixedStep_s);
+		}
+	}
+
+	mScenarioSeed = mRandomSeed != 0 ? mRandomSeed : FMath::Rand();
+	mScenarioRandom.Initialize(mScenarioSeed);
+
+	UE_LOG(LogTemp, Display, TEXT("Scenario Seed %d."), mScenarioSeed);
+
+	if (!mRecordDecisionsPath.IsEmpty())
+		mpRecording = std::make_unique<FDecisionRecording>(mScenarioSeed, fixedStep_s);
+
+	if (mRecordStageTimings || mpReplay)
+		mpStageTimings = std::make_unique<FStageTimings>();
+
+	// Shared by the actors and every headless dungeon, so the term statistics cover all agents.
+	mpRewardKernel = std::make_shared<FRewardKernel>(mRewardTerms);
+
+	mpDataBuilder = std::make_unique<TF::FlatFloatDataBuilder>(StateSize,
+															   std::vector<int64_t>{ StateSize });
+	mSelectionInputs.reserve(StateSize);
+
+	if (mUseTrajectoryReturns)
+		mpTrajectories = std::make_unique<FTrajectoryBuffer>(mLearningGamma, mReturnSteps, mMaxTrajectoryLength);
+
+	if (mUseInferenceCache)
+		mInferenceCache.Configure(mInferenceCacheCapacity, mInferenceCacheQuantization, mInferenceCacheTreasureQuantization_cm);
+	mTrainingData.reserve(mMaxTrainingBatches);
 
-	mpModel = std::make_unique<TF::MLModel>("01_DungeonNavigator");
+	StartLearner();
 
-	mGeneration = mpModel->GetModelVersion();
+	if (GetPolicy() && mWarmUpInference)
+		StartModelWarmUp();
 
-	if (mpModel->DoesModelExists())
+	mStartTime_s = FPlatformTime::Seconds();
+
+	// The scheduler batches run on worker tasks, like every batched decision they only run the policy snapshot.
+	if (mCoroutineAgents)
+		mpAgentScheduler = std::make_unique<FAgentScheduler>(std::bind(&AScenarioManagerActor::SelectMotionBatch, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, true),
+															 static_cast<int32>(mScenarioRandom.GetUnsignedInt()));
+
+	SpawnNPCs();
+
+	if (mpRecording)
+		mpRecording->SetTreasureLocation(mTreasureLocation);
+
+	if (mpReplay && (mReplayScenarioMismatch || !mpReplay->GetTreasureLocation().Equals(mTreasureLocation)))
+		UE_LOG(LogTemp, Warning, TEXT("Replayed Scenario Differs From The Recording, The Level Or Spawn Settings Changed!"));
+
+	// Captured once the NPCs exist, so they are excluded from the occupancy grid.
+	if (mKinematicMovement && !mpNPCs.IsEmpty() && CaptureDungeonLayout())
 	{
-		if (!mpModel->LoadIfExists())
-			mpModel = nullptr;
+		for (ABaseDungeonActor* npc : mpNPCs)
+			npc->SetKinematicLayout(mpDungeonLayout);
 	}
-	else
+
+	// Created once the NPCs exist, so the static traces ignore all of them.
+	if (mUsePerceptionCache && !mpNPCs.IsEmpty())
+		StartPerceptionCache();
+
+	if (mLiveLearning && mCurrentScenario == EScenarioType::Learning && mEvolutionStrategies && mpLearner)
+		StartEvolutionStrategies();
+
+	if (mLiveLearning && mCurrentScenario == EScenarioType::Learning && mNumRolloutWorkers > 0)
 	{
-		mpModel->AddInput("state",
-						  TF::DataType::Float32, 
-						  { -1, (NumRayCasts * 2) + 1 });
+		if (mpLearner && mPopulationSize > 1)
+			StartPopulation();
 
-		mpModel->AddOutput("action");
+		StartRolloutWorkers();
+	}
 
-		mpModel->AddLayer(TF::LayerType::Flatten,
-		{
-			{ "input_name", "state" },
-			{ "output_name", "flat_input" }
-		});
+	if (mExperienceRole != EExperienceRole::None && mCurrentScenario == EScenarioType::Learning)
+	{
+		// Producers retry from Tick until the learner has created the channel.
+		if (!OpenExperienceChannel() && mExperienceRole == EExperienceRole::Learner)
+			UE_LOG(LogTemp, Warning, TEXT("Failed To Create Experience Channel %s!"), *mExperienceChannelName);
+	}
 
-		mpModel->AddLayer(TF::LayerType::Dense,
-		{
-			{ "input_name", "flat_input" },
-			{ "units", 64 },
-			{ "output_name", "dense_1" },
-			{ "activation", "relu" },
-		});
+	// Captured up front, the evaluation runs on a background task.
+	if (mEvaluateAfterTraining)
+		CaptureDungeonLayout();
 
-		mpModel->AddLayer(TF::LayerType::Dense,
-		{
-			{ "input_name", "dense_1" },
-			{ "units", 256 },
-			{ "output_name", "dense_2" },
-			{ "activation", "relu" },
-		});
+	mLearningCurveStart_s = FPlatformTime::Seconds();
+	if (mEvaluateAfterTraining && !mLearningCurvePath.IsEmpty() &&
+		!FFileHelper::SaveStringToFile(TEXT("WallTime_s,Generation,SuccessRate,MeanTimeToTreasure_s,CoinsPerEpisode\n"), *mLearningCurvePath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Write Learning Curve %s!"), *mLearningCurvePath);
+	}
 
-		mpModel->AddLayer(TF::LayerType::Dense,
-		{
-			{ "input_name", "dense_2" },
-			{ "units", 128 },
-			{ "output_name", "dense_3" },
-			{ "activation", "relu" },
-		});
+	// Learning NPCs allocate their decision temporaries from the frame arena reset in Tick.
+	if (mReportFrameTimes || mPipelinedInference || !mpNPCs.IsEmpty() || mExperienceRole != EExperienceRole::None || mpStageTimings)
+		SetActorTickEnabled(true);
+}
 
-		mpModel->AddLayer(TF::LayerType::Dense,
-		{
-			{ "input_name", "dense_3" },
-			{ "units", 1 },
-			{ "activation", "linear" },
-			{ "output_name", "action" },
-		});
+void AScenarioManagerActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Everything running on other threads calls back into the manager, so it is stopped while the manager is intact.
+	StopRolloutWorkers();
 
-		if (!mpModel->CreateModel())
-		{
-			UE_LOG(LogTemp, Display, TEXT("Failed To Create Model!"));
-			mpModel = nullptr;
-		}
+	// Waits for the member training tasks, the rollout workers no longer dispatch them.
+	mpPopulation = nullptr;
+
+	FlushInferencePipeline();
+
+	// Destroying the trainer joins its thread after the current generation.
+	mpEvolutionTrainer = nullptr;
+
+	// Waits for the in-flight decision batch before the agent coroutines are destroyed.
+	mpAgentScheduler = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+
+	if (mpRecording && mpRecording->Save(mRecordDecisionsPath))
+	{
+		UE_LOG(LogTemp, Display, TEXT("Recorded %lld Decisions Of Seed %d To %s."), mpRecording->GetNumDecisions(), mScenarioSeed, *mRecordDecisionsPath);
 	}
 
-	SpawnNPCs();
+	if (mpRewardKernel)
+		mpRewardKernel->LogContributions();
+
+	if (mpPerceptionCache)
+	{
+		FWorldDelegates::LevelAddedToWorld.Remove(mLevelAddedHandle);
+		FWorldDelegates::LevelRemovedFromWorld.Remove(mLevelRemovedHandle);
+
+		LogPerceptionCache();
+	}
+
+	if (mpReplay)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Replayed %llu Decisions, %llu Decisions Past The End Of The Recording."), mNumReplayedDecisions, mNumReplayMisses);
+	}
 }
 
 void AScenarioManagerActor::BeginDestroy()
 {
+	// The training rounds queued by the transitions flushed in EndPlay finish first.
+	if (mpLearner)
+		mpLearner->WaitForTraining();
+
+	if (mModelReloadTask)
+		mModelReloadTask->Wait();
+
+	if (mModelWarmUpTask)
+		mModelWarmUpTask->Wait();
+
+	// Started by the last training round at the latest.
+	{
+		const std::scoped_lock lock(mEvaluationMutex);
+		if (mEvaluationTask)
+			mEvaluationTask->Wait();
+	}
+
+	// The learner is kept for the evaluations of late callbacks, it stops publishing to the channel.
+	if (mpLearner)
+		mpLearner->SetExperienceChannel(nullptr);
+
+	mpExperienceChannel = nullptr;
+
 	Super::BeginDestroy();
+}
+
+void AScenarioManagerActor::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (mReportFrameTimes)
+		RecordFrameTime();
+
+	if (mpStageTimings)
+	{
+		const uint64 tickCycles = FPlatformTime::Cycles64();
+		if (mLastTickCycles > 0)
+			mpStageTimings->Add(EPerformanceStage::Frame, tickCycles - mLastTickCycles);
+
+		mLastTickCycles = tickCycles;
+	}
+
+	if (mPipelinedInference)
+		AdvanceInferencePipeline();
+
+	if (mExperienceRole != EExperienceRole::None)
+		TickExperienceChannel();
 
-	if (mTrainingTask)
-		mTrainingTask->Wait();
+	if (mpInstancedDungeon)
+		TickInstancedAgents(DeltaSeconds);
+
+	if (mpAgentScheduler)
+		mpAgentScheduler->Tick(DeltaSeconds);
+
+	if (mBatchedContactDetection && !mpNPCs.IsEmpty())
+		DetectContacts();
+
+	mFrameArena.Reset();
 }
 
 int32 AScenarioManagerActor::GetModelVersion() const
 {
-	if (!mpModel)
+	const std::shared_ptr<const FPolicySnapshot> pPolicy = GetPolicy();
+	if (!pPolicy)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Model is not initialized!"));
 		return 0;
 	}
 
-	return mpModel->GetModelVersion();
+	return pPolicy->mpModel->GetModelVersion();
+}
+
+void AScenarioManagerActor::StartLearner()
+{
+	FPolicyLearnerSettings settings;
+
+	// The value head has a different output shape, so it is kept as a separate model.
+	settings.mModelName = mUseActionValueHead ? "01_DungeonNavigator_Q" : "01_DungeonNavigator";
+	settings.mUseActionValueHead = mUseActionValueHead;
+
+	// The value head's bootstrapped action values and the trajectory returns are complete targets, so no row depends on the next one.
+	settings.mIndependentRows = mUseActionValueHead || mUseTrajectoryReturns;
+
+	settings.mNormalizeObservations = mNormalizeObservations;
+	settings.mNormalizationClip = mNormalizationClip;
+	settings.mHyperparameters = { mLearningRate, mLearningGamma, mTrainingEpochs };
+	settings.mTrainingBatches = mTrainingBatches;
+	settings.mAssemblyMinibatchSize = mAssemblyMinibatchSize;
+	settings.mTargetUpdateInterval = mTargetUpdateInterval;
+	settings.mSeed = mScenarioSeed;
+
+	FModelWarmUp modelWarmUp;
+	if (mWarmUpInference)
+		modelWarmUp = std::bind(&AScenarioManagerActor::WarmUpModel, this, std::placeholders::_1, std::placeholders::_2);
+
+	// Started on the thread that saved the generation, while the checkpoint is still the one just saved.
+	FGenerationSink generationSink;
+	if (mEvaluateAfterTraining)
+		generationSink = [this](uint32) { StartPolicyEvaluation(); };
+
+	mpLearner = std::make_unique<FPolicyLearner>(settings,
+												 mpStageTimings.get(),
+												 std::bind(&AScenarioManagerActor::RunModelBatch, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5),
+												 modelWarmUp,
+												 std::bind(&AScenarioManagerActor::ReportTrainingRound, this, std::placeholders::_1),
+												 generationSink);
+	if (!mpLearner->LoadModel())
+		mpLearner = nullptr;
+}
+
+void AScenarioManagerActor::ReportTrainingRound(const std::vector<FCompactTransition>& trainingData)
+{
+	if (mInferenceCache.IsEnabled())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Inference Cache: %.1f%% hit rate, %.1fms of model time saved."),
+			   mInferenceCache.GetHitRate() * 100.0f,
+			   mInferenceCache.GetTimeSaved_s() * 1000.0);
+	}
+
+	mpRewardKernel->LogContributions();
+
+	if (mpPerceptionCache)
+		LogPerceptionCache();
+
+	if (mPipelinedInference && !trainingData.empty())
+	{
+		double totalLag_s = 0;
+		for (const FCompactTransition& info : trainingData)
+			totalLag_s += info.mObservationLag_s.GetFloat();
+
+		UE_LOG(LogTemp, Display, TEXT("Mean Observation Lag: %.1fms."), totalLag_s * 1000.0 / trainingData.size());
+	}
+}
+
+bool AScenarioManagerActor::EvaluatePolicy()
+{
+	if (!mpLearner || (!mpDungeonLayout && !CaptureDungeonLayout()))
+		return false;
+
+	// Queued behind the training rounds, the evolution trainer saves off this chain and is kept out by the checkpoint mutex.
+	mpLearner->QueueBehindTraining([this]()
+	{
+		StartPolicyEvaluation();
+	});
+	return true;
+}
+
+float AScenarioManagerActor::BenchmarkMovement(int32 numSteps)
+{
+	if (mpNPCs.IsEmpty() || numSteps <= 0 || !CaptureDungeonLayout())
+		return 0;
+
+	const float stepTime_s = 1.0f / 60.0f;
+	const int32 stepsPerDirection = 30;
+	const int32 numAgents = mpNPCs.Num();
+
+	// Both modes replay the same axis-aligned directions from the same locations.
+	FRandomStream random(numSteps);
+	std::vector<EMoveDirection> directions(static_cast<size_t>((numSteps / stepsPerDirection + 1) * numAgents));
+	for (EMoveDirection& direction : directions)
+		direction = static_cast<EMoveDirection>(random.RandRange(static_cast<int32>(EMoveDirection::Forward), static_cast<int32>(EMoveDirection::Right)));
+
+	TArray<FVector> startLocations;
+	for (ABaseDungeonActor* npc : mpNPCs)
+	{
+		startLocations.Add(npc->GetActorLocation());
+
+		// Contacts found mid benchmark would reset the agents.
+		npc->SetOverlapDetectionEnabled(false);
+	}
+
+	TArray<FVector> endLocations[2];
+	double moveTime_s[2] = { 0, 0 };
+
+	for (int32 pass = 0; pass < static_cast<int32>(UE_ARRAY_COUNT(MovementBenchmarkPasses)); ++pass)
+	{
+		const int32 mode = MovementBenchmarkPasses[pass];
+		for (int32 i = 0; i < numAgents; ++i)
+		{
+			mpNPCs[i]->SetKinematicLayout(mode == 1 ? mpDungeonLayout : nullptr);
+			mpNPCs[i]->SetActorLocation(startLocations[i]);
+		}
+
+		const double start_s = FPlatformTime::Seconds();
+		for (int32 step = 0; step < numSteps; ++step)
+		{
+			const size_t offset = static_cast<size_t>(step / stepsPerDirection) * numAgents;
+			for (int32 i = 0; i < numAgents; ++i)
+				mpNPCs[i]->MoveInDirection(directions[offset + i], stepTime_s);
+		}
+
+		if (pass < NumMovementWarmUpPasses)
+			continue;
+
+		moveTime_s[mode] += FPlatformTime::Seconds() - start_s;
+
+		// Every pass of a mode replays the same steps, the last one is compared.
+		endLocations[mode].Reset();
+		for (ABaseDungeonActor* npc : mpNPCs)
+			endLocations[mode].Add(npc->GetActorLocation());
+	}
+
+	double totalDeviation_cm = 0;
+	double maxDeviation_cm = 0;
+	for (int32 i = 0; i < numAgents; ++i)
+	{
+		const double deviation_cm = FVector::Dist2D(endLocations[0][i], endLocations[1][i]);
+		totalDeviation_cm += deviation_cm;
+		maxDeviation_cm = FMath::Max(maxDeviation_cm, deviation_cm);
+	}
+
+	for (int32 i = 0; i < numAgents; ++i)
+	{
+		mpNPCs[i]->SetActorLocation(startLocations[i]);
+		mpNPCs[i]->SetKinematicLayout(mKinematicMovement ? mpDungeonLayout : nullptr);
+		mpNPCs[i]->SetOverlapDetectionEnabled(!mBatchedContactDetection);
+	}
+
+	const double numAgentSteps = static_cast<double>(NumTimedPassesPerMode) * numAgents * numSteps;
+	const double sweptCost_us = moveTime_s[0] * 1000000.0 / numAgentSteps;
+	const double kinematicCost_us = moveTime_s[1] * 1000000.0 / numAgentSteps;
+	const float speedup = kinematicCost_us > 0 ? static_cast<float>(sweptCost_us / kinematicCost_us) : 0.0f;
+
+	UE_LOG(LogTemp, Display, TEXT("Movement Benchmark: %d Agents x %d Steps, Swept %.3fus, Kinematic %.3fus Per Agent Step (%.1fx), Final Location Deviation %.1fcm Mean, %.1fcm Max."),
+		   numAgents,
+		   numSteps,
+		   sweptCost_us,
+		   kinematicCost_us,
+		   speedup,
+		   totalDeviation_cm / numAgents,
+		   maxDeviation_cm);
+
+	return speedup;
+}
+
+void AScenarioManagerActor::StartPolicyEvaluation()
+{
+	if (!mpDungeonLayout)
+		return;
+
+	{
+		const std::scoped_lock lock(mEvaluationMutex);
+		if (mEvaluationTask && !mEvaluationTask->IsComplete())
+		{
+			UE_LOG(LogTemp, Display, TEXT("Policy Evaluation Still Running, Skipping Generation %u."), mpLearner->GetNumTrainingRounds());
+			return;
+		}
+	}
+
+	// Nothing else runs this copy.
+	std::shared_ptr<const FPolicySnapshot> pPolicy = mpLearner->LoadCheckpoint();
+	if (!pPolicy)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Load Model For Policy Evaluation!"));
+		return;
+	}
+
+	// Plotted at the time it was saved, not when its episodes finished.
+	const double checkpointTime_s = FPlatformTime::Seconds() - mLearningCurveStart_s;
+
+	// Off the training chain, the next round does not wait for the episodes.
+	const std::scoped_lock lock(mEvaluationMutex);
+	mEvaluationTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, pPolicy = std::move(pPolicy), checkpointTime_s]()
+	{
+		const FPolicyEvaluationResult result = RunPolicyEvaluation(*pPolicy);
+		mEvaluationSuccessRate = result.GetSuccessRate();
+
+		AppendLearningCurve(checkpointTime_s, pPolicy->mGeneration, result);
+
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+FPolicyEvaluationResult AScenarioManagerActor::RunPolicyEvaluation(const FPolicySnapshot& policy)
+{
+	if (!mpDungeonLayout)
+		return FPolicyEvaluationResult();
+
+	FPolicyEvaluationSettings settings;
+	settings.mNumSeeds = mEvaluationSeeds;
+	settings.mStepTime_s = mRolloutStepTime_s;
+	settings.mMaxEpisodeTime_s = mEvaluationEpisodeTime_s;
+
+	TArray<FVector> treasurePoints = mTreasurePoints;
+	if (treasurePoints.IsEmpty())
+		treasurePoints.Add(mTreasureLocation);
+
+	const FPolicyEvaluator evaluator(mpDungeonLayout,
+									 mHeadlessSettings,
+									 mSpawnPoints,
+									 mCoinPoints,
+									 treasurePoints,
+									 settings);
+
+	// The episodes are simulated in parallel, their greedy model runs take turns on the private copy.
+	const FObservationNormalizer* pNormalizer = mpLearner->GetPolicyNormalizer(policy);
+	std::mutex runMutex;
+
+	const FPolicyEvaluationResult result = evaluator.Evaluate([&](const std::vector<float>& states,
+																  int32 count,
+																  FRandomStream& random,
+																  std::vector<std::tuple<EMoveDirection, float>>& outActions)
+	{
+		const std::scoped_lock lock(runMutex);
+		if (!RunPolicyBatch(*policy.mpModel, pNormalizer, states, count, outActions))
+			outActions.assign(count, { EMoveDirection::None, 0.0f });
+	});
+
+	UE_LOG(LogTemp, Display, TEXT("Policy Evaluation (Generation %u): %d Episodes In %.2fs, %.1f%% Success, %.1fs Mean Time To Treasure, %.2f Coins/Episode, %d Deaths, %d Timeouts."),
+		   policy.mGeneration,
+		   result.mNumEpisodes,
+		   result.mWallTime_s,
+		   result.GetSuccessRate() * 100.0f,
+		   result.GetMeanTimeToTreasure_s(),
+		   result.mNumEpisodes > 0 ? static_cast<double>(result.mNumCoinsCollected) / result.mNumEpisodes : 0.0,
+		   result.mNumDeaths,
+		   result.mNumTimeouts);
+
+	return result;
+}
+
+void AScenarioManagerActor::AppendLearningCurve(double checkpointTime_s,
+											   uint32 generation,
+											   const FPolicyEvaluationResult& result) const
+{
+	if (mLearningCurvePath.IsEmpty())
+		return;
+
+	// Evaluations run one at a time, so the rows are appended in order.
+	const FString row = FString::Printf(TEXT("%.2f,%u,%f,%f,%f\n"),
+										checkpointTime_s,
+										generation,
+										result.GetSuccessRate(),
+										result.GetMeanTimeToTreasure_s(),
+										result.mNumEpisodes > 0 ? static_cast<double>(result.mNumCoinsCollected) / result.mNumEpisodes : 0.0);
+
+	if (!FFileHelper::SaveStringToFile(row, *mLearningCurvePath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append))
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Append To Learning Curve %s!"), *mLearningCurvePath);
+}
+
+float AScenarioManagerActor::GetFrameTimePercentile(float percentile) const
+{
+	const size_t numFrames = FMath::Min(mNextFrameTime, mFrameTimes_ms.size());
+	if (numFrames == 0)
+		return 0;
+
+	std::vector<float> frameTimes_ms(mFrameTimes_ms.begin(), mFrameTimes_ms.begin() + numFrames);
+
+	const size_t rank = FMath::Min(static_cast<size_t>(FMath::Clamp(percentile, 0.0f, 100.0f) / 100.0f * numFrames), numFrames - 1);
+	std::nth_element(frameTimes_ms.begin(), frameTimes_ms.begin() + rank, frameTimes_ms.end());
+	return frameTimes_ms[rank];
 }
 
 void AScenarioManagerActor::SpawnNPCs()
@@ -106,21 +591,38 @@ void AScenarioManagerActor::SpawnNPCs()
 	if (mTreasurePoints.IsEmpty())
 		return;
 
+	// Level hazards classify perception rays through their object channel.
+	for (TActorIterator<AActor> it(GetWorld()); it; ++it)
+		AssignDungeonObjectChannels(*it);
+
 	// Spawn the Treasure Point
-	mTreasureLocation = mTreasurePoints[FMath::RandRange(0, mTreasurePoints.Num() - 1)];
+	mTreasureLocation = mTreasurePoints[mScenarioRandom.RandRange(0, mTreasurePoints.Num() - 1)];
 
 	mpTreasure = GetWorld()->SpawnActor<AActor>(mpTreasureTemplate, mTreasureLocation, FRotator::ZeroRotator);
-	mpTreasure->SetActorScale3D(FVector(10));
+	mpTreasure->SetActorScale3D(FVector(DungeonActorScale));
+	AssignDungeonObjectChannels(mpTreasure);
+
+	if (mUseInstancedAgents && mLiveLearning && mCurrentScenario == EScenarioType::Learning)
+	{
+		SpawnInstancedAgents();
+		return;
+	}
 
 	// Spawn Coins
 	for (const FVector& point : mCoinPoints)
 	{
 		AActor* coin = GetWorld()->SpawnActor<AActor>(mpCoinTemplate, point, FRotator::ZeroRotator);
-		coin->SetActorScale3D(FVector(10));
+		coin->SetActorScale3D(FVector(DungeonActorScale));
+		AssignDungeonObjectChannels(coin);
 
 		mCoins.Add(coin);
 	}
 
+	BuildContactTargets();
+
+	if (mBatchedContactDetection)
+		SetActorTickEnabled(true);
+
 	if (mLiveLearning)
 		SpawnTrainingNPCs();
 	else
@@ -136,14 +638,20 @@ void AScenarioManagerActor::SpawnActiveNPC()
 
 		if (mSpawnPoints.Num() > 0)
 		{
-			int32 SpawnIndex = FMath::RandRange(0, mSpawnPoints.Num() - 1);
+			int32 SpawnIndex = mScenarioRandom.RandRange(0, mSpawnPoints.Num() - 1);
 			FVector SpawnLocation = mSpawnPoints[SpawnIndex];
 
 			// Assuming you have a class for the NPC actor
-			ARandomNPCActor* actor = GetWorld()->SpawnActor<ARandomNPCActor>(mpRandomActorTemplate, SpawnLocation, FRotator::ZeroRotator);
-			actor->SetActorScale3D(FVector(10));
+			const FTransform SpawnTransform(FRotator::ZeroRotator, SpawnLocation, FVector(DungeonActorScale));
+			ARandomNPCActor* actor = GetWorld()->SpawnActorDeferred<ARandomNPCActor>(mpRandomActorTemplate, SpawnTransform);
 
 			actor->RegisterOnResetCallback(std::bind(&AScenarioManagerActor::OnResetNPC, this, std::placeholders::_1));
+			actor->SetRandomSeed(static_cast<int32>(mScenarioRandom.GetUnsignedInt()));
+			actor->SetStageTimings(mpStageTimings.get());
+			actor->SetCoinRegistry(mpCoinRegistry);
+			actor->SetOverlapDetectionEnabled(!mBatchedContactDetection);
+
+			actor->FinishSpawning(SpawnTransform);
 
 			mpNPCs.Add(actor);
 		}
@@ -155,19 +663,11 @@ void AScenarioManagerActor::SpawnActiveNPC()
 
 		if (mSpawnPoints.Num() > 0)
 		{
-			int32 SpawnIndex = FMath::RandRange(0, mSpawnPoints.Num() - 1);
+			int32 SpawnIndex = mScenarioRandom.RandRange(0, mSpawnPoints.Num() - 1);
 			FVector SpawnLocation = mSpawnPoints[SpawnIndex];
 
 			// Assuming you have a class for the NPC actor
-			ALearningNPCActor* actor = GetWorld()->SpawnActor<ALearningNPCActor>(mpLearningActorTemplate, SpawnLocation, FRotator::ZeroRotator);
-			actor->SetActorScale3D(FVector(10));
-			actor->SetTreasureLocation(mpTreasure->GetActorLocation());
-
-			actor->RegisterOnResetCallback(std::bind(&AScenarioManagerActor::OnResetNPC, this, std::placeholders::_1));
-			actor->RegisterReceiveTrainingDataCallback(std::bind(&AScenarioManagerActor::OnReceiveTrainingData, this, std::placeholders::_1));
-			actor->SetActionSelector(std::bind(&AScenarioManagerActor::SelectMotion, this, std::placeholders::_1));
-
-			mpNPCs.Add(actor);
+			SpawnLearningNPC(SpawnLocation);
 		}
 	}
 }
@@ -179,137 +679,1026 @@ void AScenarioManagerActor::SpawnTrainingNPCs()
 
 	for (int32_t i = 0; i < mNumberOfAgents; ++i)
 	{
-		FVector SpawnLocation = mSpawnPoints[FMath::RandRange(0, mSpawnPoints.Num() - 1)];
-		ALearningNPCActor* npc = GetWorld()->SpawnActor<ALearningNPCActor>(mpLearningActorTemplate, SpawnLocation, FRotator::ZeroRotator);
-		npc->SetActorScale3D(FVector(10));
-		npc->SetTreasureLocation(mpTreasure->GetActorLocation());
-
-		npc->RegisterOnResetCallback(std::bind(&AScenarioManagerActor::OnResetNPC, this, std::placeholders::_1));
-		npc->RegisterReceiveTrainingDataCallback(std::bind(&AScenarioManagerActor::OnReceiveTrainingData, this, std::placeholders::_1));
-		npc->SetActionSelector(std::bind(&AScenarioManagerActor::SelectMotion, this, std::placeholders::_1));
-
-		mpNPCs.Add(npc);
+		FVector SpawnLocation = mSpawnPoints[mScenarioRandom.RandRange(0, mSpawnPoints.Num() - 1)];
+		SpawnLearningNPC(SpawnLocation);
 	}
 }
 
-void AScenarioManagerActor::OnReceiveTrainingData(const TrainingInfo& newInfo)
+ALearningNPCActor* AScenarioManagerActor::SpawnLearningNPC(const FVector& location)
 {
-	const std::scoped_lock lock(mTrainingMutex);
+	// Deferred so the treasure and coins are known when the actor begins play.
+	const FTransform SpawnTransform(FRotator::ZeroRotator, location, FVector(DungeonActorScale));
+	ALearningNPCActor* npc = GetWorld()->SpawnActorDeferred<ALearningNPCActor>(mpLearningActorTemplate, SpawnTransform);
+	npc->SetTreasureLocation(mpTreasure->GetActorLocation());
+	npc->SetCoinRegistry(mpCoinRegistry);
+	npc->SetOverlapDetectionEnabled(!mBatchedContactDetection);
 
-	if (mCurrentScenario != EScenarioType::Learning)
-		return;
+	npc->RegisterOnResetCallback(std::bind(&AScenarioManagerActor::OnResetNPC, this, std::placeholders::_1));
+	npc->RegisterReceiveTrainingDataCallback(std::bind(&AScenarioManagerActor::OnReceiveTrainingData, this, std::placeholders::_1));
+	npc->SetActionSelector(std::bind(&AScenarioManagerActor::SelectMotion, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+	if (mPipelinedInference && !mpAgentScheduler)
+		npc->SetDecisionRequester(std::bind(&AScenarioManagerActor::OnDecisionRequested, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 
-	mTrainingData.emplace_back(newInfo);
+	npc->SetFrameArena(&mFrameArena);
+	npc->SetRewardKernel(mpRewardKernel);
+	npc->SetRandomSeed(static_cast<int32>(mScenarioRandom.GetUnsignedInt()));
+	npc->SetStageTimings(mpStageTimings.get());
 
-	if (!mpModel)
-	{
-		UE_LOG(LogTemp, Warning, TEXT("Model is not initialized!"));
-		return;
-	}
+	// Actors take the first agent ids, so the id is also the spawn order.
+	const int32 agentId = mNextAgentId++;
+	npc->SetAgentId(agentId);
 
-	if (mTrainingData.size() >= mMaxTrainingBatches)
-	{
-		std::vector<TrainingInfo> localTrainingData = std::move(mTrainingData);
+	if (mpRecording)
+		mpRecording->AddSpawn(location);
 
-		if (mTrainingTask)
-			mTrainingTask->Wait();
+	if (mpReplay && (!mpReplay->GetSpawnLocations().IsValidIndex(agentId) || !mpReplay->GetSpawnLocations()[agentId].Equals(location)))
+		mReplayScenarioMismatch = true;
 
-		mTrainingTask = FFunctionGraphTask::CreateAndDispatchWhenReady([localTrainingData, this]()
-		{
-			UE_LOG(LogTemp, Display, TEXT("NPC Starting Training..."));
+	npc->SetMaxEpisodeTime(mMaxEpisodeTime_s);
+	npc->SetDecisionScheduler(std::bind(&AScenarioManagerActor::TryScheduleDecision, this, std::placeholders::_1));
+	AssignDecisionPhase(npc, mpNPCs.Num());
 
-			for (const TrainingInfo& info : localTrainingData)
-			{
-				nlohmann::json stateInfo;
-				for (uint32_t i = 0; i < NumRayCasts; ++i)
-				{
-					stateInfo.emplace_back(info.mState.mRayCollisionDistances[i]);
-					stateInfo.emplace_back(info.mState.mRayCollisionHitTypes[i]);
-				}
+	npc->FinishSpawning(SpawnTransform);
 
-				stateInfo.push_back(info.mState.mTreasureDistance);
+	if (mpAgentScheduler)
+		npc->StartDecisionLoop(*mpAgentScheduler);
 
-				nlohmann::json actionValue;
-				actionValue.push_back(info.mDirection_f);
+	mpNPCs.Add(npc);
+	return npc;
+}
 
-				mpModel->AddRewardData(stateInfo, actionValue, info.mReward);
-			}
+void AScenarioManagerActor::AssignDecisionPhase(ALearningNPCActor* npc,
+											   int32 index) const
+{
+	// Agents in the same bucket decide on the same frame, the buckets are spread across the decision interval.
+	const int32 numBuckets = FMath::Max(1, mNumDecisionBuckets);
+	npc->SetDecisionPhase(npc->mTimeBetweenDirectionSwap_s * (index % numBuckets) / numBuckets);
+}
 
-			if (!mpModel->TrainModel(mTrainingEpochs,
-									 mTrainingBatches, 
-									 mLearningRate,
-									 mLearningGamma))
-			{
-				UE_LOG(LogTemp, Warning, TEXT("NPC Training Failed!"));
-			}
+bool AScenarioManagerActor::TryScheduleDecision(ALearningNPCActor* npc)
+{
+	if (mDecisionFrame != GFrameCounter)
+		BeginDecisionFrame();
 
-			UE_LOG(LogTemp, Display, TEXT("NPC Finished Training..."));
+	if (mMaxDecisionsPerFrame <= 0)
+		return true;
 
-		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+	// Waiting NPCs keep their ticket and are only granted the slots reserved for them.
+	if (FDecisionWait* wait = mDecisionWaits.Find(npc))
+	{
+		if (wait->mTicket <= mReservedDecisionTicket)
+		{
+			mDecisionWaits.Remove(npc);
+			return true;
+		}
 
+		wait->mLastRequestFrame = mDecisionFrame;
+		mNumDeferredDecisions++;
+		return false;
+	}
+
+	if (mDecisionsThisFrame >= mMaxDecisionsPerFrame - mReservedDecisions)
+	{
+		FDecisionWait& newWait = mDecisionWaits.Add(npc);
+		newWait.mTicket = mNextDecisionWaitTicket++;
+		newWait.mLastRequestFrame = mDecisionFrame;
 
-		for (ABaseDungeonActor* actor : mpNPCs)
-			OnResetNPC(actor);
+		mNumDeferredDecisions++;
+		return false;
 	}
+
+	mDecisionsThisFrame++;
+	return true;
 }
 
-void AScenarioManagerActor::OnResetNPC(ABaseDungeonActor* actor)
+void AScenarioManagerActor::BeginDecisionFrame()
 {
-	if (!actor)
+	const uint64 previousFrame = mDecisionFrame;
+
+	mDecisionFrame = GFrameCounter;
+	mDecisionsThisFrame = 0;
+	mReservedDecisions = 0;
+
+	// Deferred NPCs ask again every frame, the ones that did not were reset or destroyed.
+	mDecisionWaitTickets.clear();
+	for (auto it = mDecisionWaits.CreateIterator(); it; ++it)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("OnResetNPC called with null actor!"));
-		return;
+		if (it.Value().mLastRequestFrame != previousFrame)
+			it.RemoveCurrent();
+		else
+			mDecisionWaitTickets.push_back(it.Value().mTicket);
 	}
 
-	int32 SpawnIndex = FMath::RandRange(0, mSpawnPoints.Num() - 1);
-	FVector SpawnLocation = mSpawnPoints[SpawnIndex];
-	actor->ResetActor(SpawnLocation);
+	if (mDecisionWaitTickets.empty())
+		return;
+
+	// The longest waiting NPCs get the slots of this frame before any new request.
+	mReservedDecisions = FMath::Min(static_cast<int32>(mDecisionWaitTickets.size()), mMaxDecisionsPerFrame);
+	std::nth_element(mDecisionWaitTickets.begin(), mDecisionWaitTickets.begin() + (mReservedDecisions - 1), mDecisionWaitTickets.end());
+	mReservedDecisionTicket = mDecisionWaitTickets[mReservedDecisions - 1];
 }
 
-std::tuple<EMoveDirection, float> AScenarioManagerActor::SelectMotion(const std::vector<float>& inputs)
+void AScenarioManagerActor::OnDecisionRequested(ALearningNPCActor* npc,
+												uint32 requestId,
+												TArrayView<const float> state)
 {
-	float randChance = mLiveLearning ? FMath::FRandRange(0.0f, 1.0f) : 1.0f;
+	if (!mpGatheringStage)
+	{
+		// Applied stages are reused, their buffers keep the capacity of earlier frames.
+		if (mFreeInferenceStages.empty())
+		{
+			mpGatheringStage = std::make_unique<FInferenceStage>();
+		}
+		else
+		{
+			mpGatheringStage = std::move(mFreeInferenceStages.back());
+			mFreeInferenceStages.pop_back();
+		}
+	}
 
-	EMoveDirection action = EMoveDirection::None;
-	float action_f = 0;
+	mpGatheringStage->mNPCs.Add(npc);
+	mpGatheringStage->mRequestIds.push_back(requestId);
+	mpGatheringStage->mStates.insert(mpGatheringStage->mStates.end(), state.begin(), state.end());
+}
 
-	if (randChance <= 0.3)
+void AScenarioManagerActor::AdvanceInferencePipeline()
+{
+	// The agents have ticked this frame, their requests run as one batch while the next frame is simulated.
+	if (mpGatheringStage)
 	{
-		// Random Exploration
-		action = static_cast<EMoveDirection>(FMath::RandRange((int)EMoveDirection::None, (int)EMoveDirection::COUNT - 1));
-		action_f = static_cast<float>(action);
+		FInferenceStage* stage = mpGatheringStage.get();
+		stage->mDispatchFrame = GFrameCounter;
+		stage->mRandom.Initialize(mPipelineRandom.GetUnsignedInt());
+		// Runs the published policy snapshot, the learner trains its own model concurrently without sharing it.
+		stage->mTask = FFunctionGraphTask::CreateAndDispatchWhenReady([stage, this]()
+		{
+			SelectMotionBatch(stage->mStates, stage->mNPCs.Num(), stage->mRandom, stage->mActions, true);
+		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+
+		mInferenceStages.push_back(std::move(mpGatheringStage));
 	}
-	else
+
+	// Actions are applied at the end of the frame before the one they take effect on.
+	const uint64 latency = static_cast<uint64>(FMath::Max(1, mPipelineLatencyFrames));
+	while (!mInferenceStages.empty() && GFrameCounter + 1 >= mInferenceStages.front()->mDispatchFrame + latency)
 	{
-		// Use Model to Decide Action
-		if (mpModel)
+		std::unique_ptr<FInferenceStage> stage = std::move(mInferenceStages.front());
+		mInferenceStages.pop_front();
+
+		stage->mTask->Wait();
+
+		for (int32 i = 0; i < stage->mNPCs.Num() && i < static_cast<int32>(stage->mActions.size()); ++i)
 		{
-			if (!mpDataBuilder)
+			if (ALearningNPCActor* npc = stage->mNPCs[i].Get())
 			{
-				UE_LOG(LogTemp, Warning, TEXT("Data Builder is not initialized!"));
-				return { EMoveDirection::None, 0.0f };
+				const auto [dir, dir_f] = stage->mActions[i];
+				npc->ApplyPipelinedDecision(stage->mRequestIds[i], dir, dir_f);
 			}
+		}
 
-			mpDataBuilder->AddInputTensor("state", inputs);
+		stage->mNPCs.Reset();
+		stage->mRequestIds.clear();
+		stage->mStates.clear();
+		stage->mActions.clear();
+		stage->mTask = nullptr;
 
+		mFreeInferenceStages.push_back(std::move(stage));
+	}
+}
+
+void AScenarioManagerActor::FlushInferencePipeline()
+{
+	for (const std::unique_ptr<FInferenceStage>& stage : mInferenceStages)
+	{
+		if (stage->mTask)
+			stage->mTask->Wait();
+	}
+
+	mInferenceStages.clear();
+	mFreeInferenceStages.clear();
+	mpGatheringStage = nullptr;
+}
+
+void AScenarioManagerActor::RecordFrameTime()
+{
+	const double now_s = FPlatformTime::Seconds();
+	const double lastFrameTime_s = mLastFrameTime_s;
+	mLastFrameTime_s = now_s;
+
+	if (lastFrameTime_s <= 0)
+		return;
+
+	const size_t window = static_cast<size_t>(FMath::Max(1, mFrameTimeWindow));
+	if (mFrameTimes_ms.size() != window)
+	{
+		mFrameTimes_ms.assign(window, 0.0f);
+		mNextFrameTime = 0;
+	}
+
+	mFrameTimes_ms[mNextFrameTime++ % window] = static_cast<float>((now_s - lastFrameTime_s) * 1000.0);
+
+	if (mNextFrameTime % window == 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Frame Time: p50 %.2fms, p95 %.2fms, p99 %.2fms (%llu decisions deferred)."),
+			   GetFrameTimePercentile(50.0f),
+			   GetFrameTimePercentile(95.0f),
+			   GetFrameTimePercentile(99.0f),
+			   mNumDeferredDecisions);
+
+		UE_LOG(LogTemp, Display, TEXT("Frame Arena: %llu bytes peak, %u heap blocks allocated."),
+			   static_cast<uint64>(mFrameArena.GetPeakBytesUsed()),
+			   mFrameArena.GetNumHeapAllocations());
+	}
+}
+
+void AScenarioManagerActor::BuildContactTargets()
+{
+	std::shared_ptr<FDungeonCoinRegistry> registry = std::make_shared<FDungeonCoinRegistry>();
+	for (AActor* coin : mCoins)
+	{
+		const FBox bounds = coin->GetComponentsBoundingBox();
+
+		registry->mIds.Add(coin, registry->mCoins.Num());
+		registry->mCoins.Add(coin);
+		registry->mLocations.Add(coin->GetActorLocation());
+		registry->mRadii.Add(FMath::Max(bounds.GetExtent().X, bounds.GetExtent().Y));
+	}
+	mpCoinRegistry = std::move(registry);
+
+	const FBox treasureBounds = mpTreasure->GetComponentsBoundingBox();
+	mTreasureRadius_cm = FMath::Max(treasureBounds.GetExtent().X, treasureBounds.GetExtent().Y);
+
+	// Hazards are tagged either on the actor or on individual components.
+	mHazardBounds.Reset();
+	for (TActorIterator<AActor> it(GetWorld()); it; ++it)
+	{
+		AActor* actor = *it;
+		if (actor->ActorHasTag("Hazard"))
+		{
+			mHazardBounds.Add(actor->GetComponentsBoundingBox());
+			continue;
+		}
+
+		TInlineComponentArray<UPrimitiveComponent*> components(actor);
+		for (UPrimitiveComponent* component : components)
+		{
+			if (component->ComponentHasTag("Hazard"))
+				mHazardBounds.Add(component->Bounds.GetBox());
+		}
+	}
+}
+
+void AScenarioManagerActor::StartPerceptionCache()
+{
+	// The occupancy grid decides which cells are free space, so their centers can be traced from.
+	if (!mpDungeonLayout && !CaptureDungeonLayout())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Perception Cache Disabled Without A Dungeon Layout!"));
+		return;
+	}
+
+	TArray<AActor*> dynamicActors(mCoins);
+	dynamicActors.Add(mpTreasure);
+	for (ABaseDungeonActor* actor : mpNPCs)
+		dynamicActors.Add(actor);
+
+	mpPerceptionCache = std::make_shared<FPerceptionCache>();
+	mpPerceptionCache->Configure(mPerceptionCacheCapacity, mPerceptionCellSize_cm, dynamicActors, mpDungeonLayout);
+
+	for (ABaseDungeonActor* actor : mpNPCs)
+	{
+		if (ALearningNPCActor* npc = Cast<ALearningNPCActor>(actor))
+			npc->SetPerceptionCache(mpPerceptionCache, mTreasureRadius_cm);
+	}
+
+	// Streaming levels in or out changes the geometry the cached rays were traced against.
+	mLevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &AScenarioManagerActor::OnLevelsChanged);
+	mLevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &AScenarioManagerActor::OnLevelsChanged);
+}
+
+void AScenarioManagerActor::InvalidatePerceptionCache()
+{
+	if (!mpPerceptionCache)
+		return;
+
+	LogPerceptionCache();
+
+	// Recaptured so cells are only cached where the changed geometry leaves free space.
+	mpDungeonLayout = nullptr;
+	if (CaptureDungeonLayout() && mKinematicMovement)
+	{
+		for (ABaseDungeonActor* npc : mpNPCs)
+			npc->SetKinematicLayout(mpDungeonLayout);
+	}
+
+	mpPerceptionCache->Invalidate(mpDungeonLayout);
+
+	UE_LOG(LogTemp, Display, TEXT("Perception Cache Invalidated."));
+}
+
+void AScenarioManagerActor::OnLevelsChanged(ULevel* level,
+											UWorld* world)
+{
+	if (world == GetWorld())
+		InvalidatePerceptionCache();
+}
+
+void AScenarioManagerActor::LogPerceptionCache() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Perception Cache: %.1f%% hit rate, %d cells cached, %llu KB allocated."),
+		   mpPerceptionCache->GetHitRate() * 100.0f,
+		   mpPerceptionCache->GetNumCells(),
+		   mpPerceptionCache->GetAllocatedBytes() / 1024);
+}
+
+void AScenarioManagerActor::DetectContacts()
+{
+	const int32 numAgents = mpNPCs.Num();
+	const int32 numCoins = mpCoinRegistry ? mpCoinRegistry->mLocations.Num() : 0;
+
+	mContactRadii.SetNumUninitialized(numAgents, EAllowShrinking::No);
+	for (int32 i = 0; i < numAgents; ++i)
+		mContactRadii[i] = mpNPCs[i]->mpCollisionComponent->GetScaledCapsuleRadius();
+
+	mAgentContacts.SetNumZeroed(numAgents, EAllowShrinking::No);
+	if (mCoinContacts.Num() != numAgents * numCoins)
+		mCoinContacts.Init(false, numAgents * numCoins);
+
+	const FVector treasureLocation = mpTreasure ? mpTreasure->GetActorLocation() : mTreasureLocation;
+
+	for (int32 i = 0; i < numAgents; ++i)
+	{
+		ABaseDungeonActor* actor = mpNPCs[i];
+		const float radius = mContactRadii[i];
+
+		// Read in turn, a contact callback earlier in the pass may have reset any of the agents.
+		const FVector location = actor->GetActorLocation();
+
+		bool touchingHazard = false;
+		for (const FBox& hazard : mHazardBounds)
+		{
+			if (FMath::SphereAABBIntersection(FSphere(location, radius), hazard))
+			{
+				touchingHazard = true;
+				break;
+			}
+		}
+
+		const bool touchingTreasure = FVector::DistSquared(location, treasureLocation) <= FMath::Square(radius + mTreasureRadius_cm);
+
+		// Like overlap events, a contact only fires when it begins, not on every tick it lasts.
+		const uint8 previousContacts = mAgentContacts[i];
+		mAgentContacts[i] = (touchingHazard ? HazardContact : 0) | (touchingTreasure ? TreasureContact : 0);
+
+		// Same event order as the overlap callbacks, a reset ends the agent's contacts for this frame.
+		if (touchingHazard && !(previousContacts & HazardContact))
+		{
+			actor->OnDeath();
+			continue;
+		}
+
+		if (touchingTreasure && !(previousContacts & TreasureContact))
+		{
+			actor->OnFoundTreasure();
+			continue;
+		}
+
+		for (int32 coin = 0; coin < numCoins; ++coin)
+		{
+			if (actor->HasVisitedCoin(coin))
+				continue;
+
+			const bool touchingCoin = FVector::DistSquared(location, mpCoinRegistry->mLocations[coin]) <= FMath::Square(radius + mpCoinRegistry->mRadii[coin]);
+
+			FBitReference coinContact = mCoinContacts[i * numCoins + coin];
+			const bool beganContact = touchingCoin && !coinContact;
+			coinContact = touchingCoin;
+
+			if (beganContact)
+				actor->TryCollectCoin(coin);
+		}
+	}
+}
+
+void AScenarioManagerActor::SpawnInstancedAgents()
+{
+	if (!CaptureDungeonLayout())
+		return;
+
+	mpAgentInstances = CreateInstancedMeshComponent(mpAgentMesh);
+	mpCoinInstances = CreateInstancedMeshComponent(mpCoinMesh);
+
+	if (!mpAgentInstances)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Instanced Agents Require An Agent Mesh!"));
+		return;
+	}
+
+	// Coins are drawn once, pickups are tracked per agent by the dungeon.
+	if (mpCoinInstances)
+	{
+		TArray<FTransform> coinTransforms;
+		for (const FVector& point : mCoinPoints)
+			coinTransforms.Emplace(FRotator::ZeroRotator, point, FVector(DungeonActorScale));
+
+		mpCoinInstances->AddInstances(coinTransforms, false, true);
+	}
+
+	mpInstancedDungeon = std::make_unique<FHeadlessDungeon>(mpDungeonLayout,
+															mHeadlessSettings,
+															mSpawnPoints,
+															mCoinPoints,
+															static_cast<int32>(mScenarioRandom.GetUnsignedInt()));
+	mpInstancedDungeon->SetAgentIdOffset(mNextAgentId);
+	mNextAgentId += mNumberOfAgents;
+
+	mAgentTransforms.Reset(mNumberOfAgents);
+	for (int32 i = 0; i < mNumberOfAgents; ++i)
+	{
+		const int32 index = mpInstancedDungeon->AddAgent(mTreasureLocation);
+		mAgentTransforms.Emplace(FRotator::ZeroRotator, mpInstancedDungeon->GetAgent(index).mLocation, FVector(DungeonActorScale));
+	}
+
+	mpAgentInstances->AddInstances(mAgentTransforms, false, true);
+
+	mInstancedRandom.Initialize(mScenarioRandom.GetUnsignedInt());
+
+	SetActorTickEnabled(true);
+}
+
+void AScenarioManagerActor::TickInstancedAgents(float deltaTime)
+{
+	mInstancedDecisions.clear();
+	mpInstancedDungeon->Step(deltaTime, mInstancedDecisions, mInstancedTransitions);
+
+	if (!mInstancedDecisions.empty())
+	{
+		mInstancedStates.clear();
+		for (int32 index : mInstancedDecisions)
+			mpInstancedDungeon->GetObservation(index, mInstancedStates);
+
+		SelectMotionBatch(mInstancedStates, static_cast<int32>(mInstancedDecisions.size()), mInstancedRandom, mInstancedActions, true);
+
+		for (size_t i = 0; i < mInstancedDecisions.size(); ++i)
+		{
+			const auto [dir, dir_f] = mInstancedActions[i];
+			mpInstancedDungeon->ApplyDecision(mInstancedDecisions[i], dir, dir_f);
+		}
+	}
+
+	if (!mInstancedTransitions.empty())
+	{
+		OnReceiveRolloutData(mInstancedTransitions);
+		mInstancedTransitions.clear();
+	}
+
+	for (int32 i = 0; i < mAgentTransforms.Num(); ++i)
+		mAgentTransforms[i].SetLocation(mpInstancedDungeon->GetAgent(i).mLocation);
+
+	mpAgentInstances->BatchUpdateInstancesTransforms(0, mAgentTransforms, true, true, true);
+}
+
+bool AScenarioManagerActor::CaptureDungeonLayout()
+{
+	if (mpDungeonLayout)
+		return true;
+
+	if (!mpLearningActorTemplate || mSpawnPoints.IsEmpty())
+		return false;
+
+	const ALearningNPCActor* agentDefaults = mpLearningActorTemplate->GetDefaultObject<ALearningNPCActor>();
+
+	mHeadlessSettings.mMoveSpeed = agentDefaults->mMoveSpeed;
+	mHeadlessSettings.mTimeBetweenDirectionSwap_s = agentDefaults->mTimeBetweenDirectionSwap_s;
+	mHeadlessSettings.mMaxTraceDistance_cm = agentDefaults->mMaxTraceDistance_cm;
+	mHeadlessSettings.mAgentRadius_cm = agentDefaults->mpCollisionComponent->GetUnscaledCapsuleRadius() * DungeonActorScale;
+	mHeadlessSettings.mPickupRadius_cm = mPickupRadius_cm;
+	mHeadlessSettings.mMaxEpisodeTime_s = mMaxEpisodeTime_s;
+	mHeadlessSettings.mpRewardKernel = mpRewardKernel;
+
+	// Capture everything the agents can reach or see.
+	FBox bounds(ForceInit);
+	for (const FVector& point : mSpawnPoints)
+		bounds += point;
+	for (const FVector& point : mCoinPoints)
+		bounds += point;
+	for (const FVector& point : mTreasurePoints)
+		bounds += point;
+	bounds = bounds.ExpandBy(mHeadlessSettings.mMaxTraceDistance_cm);
+
+	TArray<AActor*> dynamicActors(mCoins);
+	dynamicActors.Add(mpTreasure);
+	for (ABaseDungeonActor* actor : mpNPCs)
+		dynamicActors.Add(actor);
+
+	mpDungeonLayout = FDungeonLayout::Capture(GetWorld(),
+											  bounds,
+											  mLayoutCellSize_cm,
+											  agentDefaults->mTraceHeight_cm,
+											  dynamicActors);
+	if (!mpDungeonLayout)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Capture Dungeon Layout!"));
+		return false;
+	}
+	return true;
+}
+
+UHierarchicalInstancedStaticMeshComponent* AScenarioManagerActor::CreateInstancedMeshComponent(UStaticMesh* mesh)
+{
+	if (!mesh)
+		return nullptr;
+
+	UHierarchicalInstancedStaticMeshComponent* component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+	component->SetStaticMesh(mesh);
+	component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	component->SetMobility(EComponentMobility::Movable);
+	if (RootComponent)
+		component->SetupAttachment(RootComponent);
+	else
+		SetRootComponent(component);
+
+	component->RegisterComponent();
+
+	return component;
+}
+
+void AScenarioManagerActor::StartRolloutWorkers()
+{
+	if (!CaptureDungeonLayout())
+		return;
+
+	for (int32 i = 0; i < mNumRolloutWorkers; ++i)
+	{
+		// Drawn from the scenario stream like every other seed, so runs and producer processes differ.
+		std::unique_ptr<FHeadlessDungeon> dungeon = std::make_unique<FHeadlessDungeon>(mpDungeonLayout,
+																					   mHeadlessSettings,
+																					   mSpawnPoints,
+																					   mCoinPoints,
+																					   static_cast<int32>(mScenarioRandom.GetUnsignedInt()));
+		dungeon->SetAgentIdOffset(mNextAgentId);
+		mNextAgentId += mAgentsPerRolloutWorker;
+
+		for (int32 agent = 0; agent < mAgentsPerRolloutWorker; ++agent)
+			dungeon->AddAgent(mTreasureLocation);
+
+		FBatchActionSelector actionSelector = std::bind(&AScenarioManagerActor::SelectMotionBatch, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, true);
+		FTransitionSink transitionSink = std::bind(&AScenarioManagerActor::OnReceiveRolloutData, this, std::placeholders::_1);
+
+		// Population members each own a share of the workers, acting and learning with their own model.
+		if (mpPopulation)
+		{
+			const int32 member = i % mpPopulation->GetNumMembers();
+			actionSelector = std::bind(&AScenarioManagerActor::SelectPopulationMotionBatch, this, member, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+			transitionSink = std::bind(&FPopulationTrainer::OnReceiveRolloutData, mpPopulation.get(), member, std::placeholders::_1);
+		}
+
+		std::unique_ptr<FRolloutWorker> worker = std::make_unique<FRolloutWorker>(i,
+																				  std::move(dungeon),
+																				  mRolloutStepTime_s,
+																				  actionSelector,
+																				  transitionSink);
+		worker->Start();
+
+		mRolloutWorkers.emplace_back(std::move(worker));
+	}
+
+	mLastRolloutReportTime_s = FPlatformTime::Seconds();
+
+	UE_LOG(LogTemp, Display, TEXT("Started %d Rollout Workers With %d Agents Each."), mNumRolloutWorkers, mAgentsPerRolloutWorker);
+}
+
+void AScenarioManagerActor::StopRolloutWorkers()
+{
+	// Destroying a worker joins its thread, after it handed over its remaining transitions.
+	mRolloutWorkers.clear();
+}
+
+void AScenarioManagerActor::OnReceiveTrainingData(const TrainingInfo& newInfo)
+{
+	const std::scoped_lock lock(mTrainingMutex);
+
+	if (mCurrentScenario != EScenarioType::Learning)
+		return;
+
+	if (mExperienceRole == EExperienceRole::Producer)
+	{
+		ForwardToLearner(newInfo);
+		return;
+	}
+
+	AddTrainingSample(newInfo);
+	mNumSamplesReceived++;
+
+	if (!mpLearner)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Model is not initialized!"));
+		return;
+	}
+
+	if (!ShouldDispatchTraining())
+		return;
+
+	if (mContinuousTraining)
+	{
+		// Agents keep their episodes, they only reset on their own terminal events or timeouts.
+		DispatchTraining();
+	}
+	else
+	{
+		// Every NPC is about to be reset, their open trajectories are bootstrapped into this round.
+		if (mpTrajectories)
+		{
+			mpTrajectories->CloseAll(mClosedSegments);
+			FlushClosedSegments();
+		}
+
+		DispatchTraining();
+
+		for (int32 i = 0; i < mpNPCs.Num(); ++i)
+		{
+			OnResetNPC(mpNPCs[i]);
+
+			// Re-stagger the decisions of the simultaneously reset agents.
+			if (ALearningNPCActor* npc = Cast<ALearningNPCActor>(mpNPCs[i]))
+				AssignDecisionPhase(npc, i);
+		}
+	}
+}
+
+void AScenarioManagerActor::OnReceiveRolloutData(std::vector<TrainingInfo>& transitions)
+{
+	const std::scoped_lock lock(mTrainingMutex);
+
+	if (mExperienceRole == EExperienceRole::Producer)
+	{
+		for (const TrainingInfo& info : transitions)
+			ForwardToLearner(info);
+		return;
+	}
+
+	for (const TrainingInfo& info : transitions)
+		AddTrainingSample(info);
+
+	mNumSamplesReceived += transitions.size();
+
+	if (!mpLearner)
+		return;
+
+	// Headless agents keep their episodes across training rounds.
+	if (ShouldDispatchTraining())
+		DispatchTraining();
+}
+
+void AScenarioManagerActor::AddTrainingSample(const TrainingInfo& info)
+{
+	RecordEpisodeOutcome(info);
+
+	// The evolution strategies learn from their own episodes, the agents' transitions only count towards the outcomes.
+	if (mpEvolutionTrainer)
+		return;
+
+	if (!mpTrajectories)
+	{
+		mTrainingData.emplace_back(EncodeTransition(info));
+		return;
+	}
+
+	mpTrajectories->Add(info, mClosedSegments);
+	FlushClosedSegments();
+}
+
+void AScenarioManagerActor::FlushClosedSegments()
+{
+	for (const TrainingInfo& segment : mClosedSegments)
+		mTrainingData.emplace_back(EncodeTransition(segment));
+
+	mClosedSegments.clear();
+}
+
+bool AScenarioManagerActor::ShouldDispatchTraining() const
+{
+	// With a round training and another queued behind it, the samples keep gathering for the round after.
+	if (mpLearner->GetNumPendingTrainingRounds() >= MaxPendingTrainingRounds)
+		return false;
+
+	if (!mContinuousTraining)
+		return mTrainingData.size() >= mMaxTrainingBatches;
+
+	// Train as soon as the learner is idle and enough samples are pending, the full
+	// batch size is only waited on when the learner falls behind the producers.
+	const bool learnerIdle = !mpLearner->IsTraining();
+	return (learnerIdle && mTrainingData.size() >= static_cast<size_t>(FMath::Max(1, mMinTrainingBatches))) ||
+		   mTrainingData.size() >= mMaxTrainingBatches;
+}
+
+void AScenarioManagerActor::DispatchTraining()
+{
+	std::vector<FCompactTransition> localTrainingData = std::move(mTrainingData);
+
+	// Keep appending transitions without regrowing the buffer.
+	mTrainingData = std::vector<FCompactTransition>();
+	mTrainingData.reserve(mMaxTrainingBatches);
+
+	if (!mRolloutWorkers.empty())
+	{
+		uint64 rolloutTransitions = 0;
+		for (const std::unique_ptr<FRolloutWorker>& worker : mRolloutWorkers)
+			rolloutTransitions += worker->GetNumTransitions();
+
+		const double now_s = FPlatformTime::Seconds();
+		const double elapsed_s = now_s - mLastRolloutReportTime_s;
+		if (elapsed_s > 0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("Rollout Throughput: %.1f samples/s across %d workers."),
+				   (rolloutTransitions - mLastRolloutTransitions) / elapsed_s,
+				   static_cast<int32>(mRolloutWorkers.size()));
+		}
+
+		mLastRolloutTransitions = rolloutTransitions;
+		mLastRolloutReportTime_s = now_s;
+	}
+
+	// Queued behind the running round instead of waited on, the callers hold the training mutex every producer pushes through.
+	mpLearner->DispatchTraining(std::move(localTrainingData));
+}
+
+void AScenarioManagerActor::StartPopulation()
+{
+	FPopulationSettings settings;
+	settings.mPopulationSize = FMath::Min(mPopulationSize, mNumRolloutWorkers);
+	if (settings.mPopulationSize < mPopulationSize)
+		UE_LOG(LogTemp, Warning, TEXT("Population Limited To %d Members, One Per Rollout Worker."), settings.mPopulationSize);
+
+	settings.mExploitInterval = mPopulationExploitInterval;
+	settings.mExploitFraction = mPopulationExploitFraction;
+	settings.mPerturbation = mPopulationPerturbation;
+	settings.mHyperparameters = { mLearningRate, mLearningGamma, mTrainingEpochs };
+	settings.mMaxTrainingBatches = mMaxTrainingBatches;
+	settings.mFindRateWindow = mTreasureFindRateWindow;
+
+	// Member rollouts bypass the trajectory buffer, only the value head's targets are complete.
+	settings.mIndependentRows = mUseActionValueHead;
+	settings.mSeed = mScenarioRandom.GetUnsignedInt();
+
+	mpPopulation = std::make_unique<FPopulationTrainer>(settings, *mpLearner);
+	if (!mpPopulation->Start())
+		mpPopulation = nullptr;
+}
+
+void AScenarioManagerActor::StartEvolutionStrategies()
+{
+	if (!CaptureDungeonLayout())
+		return;
+
+	TArray<FVector> treasurePoints = mTreasurePoints;
+	if (treasurePoints.IsEmpty())
+		treasurePoints.Add(mTreasureLocation);
+
+	// Mirrors the Dense layers of FPolicyLearner::CreateModel.
+	const FPolicyNetwork network({ StateSize, 64, 256, 128, GetNumActionOutputs() });
+
+	FEvolutionSettings settings;
+	settings.mNumPerturbations = mEvolutionPerturbations;
+	settings.mNoiseStdDev = mEvolutionNoiseStdDev;
+	settings.mLearningRate = mEvolutionLearningRate;
+	settings.mAgentsPerEvaluation = mEvolutionAgentsPerEvaluation;
+	settings.mStepTime_s = mRolloutStepTime_s;
+	settings.mEpisodeTime_s = mEvolutionEpisodeTime_s;
+	settings.mExportInterval = mEvolutionExportInterval;
+	settings.mNumExportStates = mEvolutionExportStates;
+	settings.mSeed = static_cast<int32>(mScenarioRandom.GetUnsignedInt());
+
+	mpEvolutionTrainer = std::make_unique<FEvolutionTrainer>(mpDungeonLayout,
+															 mHeadlessSettings,
+															 mSpawnPoints,
+															 mCoinPoints,
+															 treasurePoints,
+															 network,
+															 settings,
+															 std::bind(&FPolicyLearner::ExportEvolvedPolicy, mpLearner.get(), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+	mpEvolutionTrainer->Start();
+
+	UE_LOG(LogTemp, Display, TEXT("Started Evolution Strategies: %d Parameters, %d Antithetic Pairs Of %d Agents Per Generation."),
+		   network.GetNumParameters(),
+		   mEvolutionPerturbations,
+		   mEvolutionAgentsPerEvaluation);
+}
+
+bool AScenarioManagerActor::OpenExperienceChannel()
+{
+	std::unique_ptr<FExperienceChannel> channel = mExperienceRole == EExperienceRole::Learner ?
+												  FExperienceChannel::Create(mExperienceChannelName, mExperienceChannelCapacity) :
+												  FExperienceChannel::Open(mExperienceChannelName, mExperienceChannelCapacity);
+	if (!channel)
+		return false;
+
+	if (mExperienceRole == EExperienceRole::Learner)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Created Experience Channel %s."), *mExperienceChannelName);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Display, TEXT("Opened Experience Channel %s As Producer %d."), *mExperienceChannelName, channel->GetProducerIndex());
+	}
+
+	mLastChannelReportTime_s = FPlatformTime::Seconds();
+	mLastChannelSamples = mNumSamplesReceived.load();
+
+	// Rollout workers forward under the training mutex.
+	const std::scoped_lock lock(mTrainingMutex);
+	mpExperienceChannel = std::move(channel);
+
+	// The learner publishes each trained generation to the producers.
+	if (mpLearner)
+		mpLearner->SetExperienceChannel(mpExperienceChannel.get());
+
+	return true;
+}
+
+void AScenarioManagerActor::TickExperienceChannel()
+{
+	const double now_s = FPlatformTime::Seconds();
+
+	if (!mpExperienceChannel)
+	{
+		if (mExperienceRole == EExperienceRole::Producer && now_s - mLastChannelAttempt_s >= 1.0)
+		{
+			mLastChannelAttempt_s = now_s;
+			OpenExperienceChannel();
+		}
+		return;
+	}
+
+	if (mExperienceRole == EExperienceRole::Producer)
+	{
+		if (mpLearner)
+			PollPublishedModel();
+		return;
+	}
+
+	// Bounded so a backlog of producer transitions is spread across frames instead of stalling one.
+	mChannelTransitions.clear();
+	if (mpExperienceChannel->Pop(mChannelTransitions, FMath::Min(mExperienceChannelCapacity, MaxChannelTransitionsPerTick)) > 0)
+		OnReceiveRolloutData(mChannelTransitions);
+
+	const double elapsed_s = now_s - mLastChannelReportTime_s;
+	if (elapsed_s < 5.0)
+		return;
+
+	double totalLatency_s = 0;
+	uint64 numBroadcasts = 0;
+	mpExperienceChannel->GetBroadcastLatency(totalLatency_s, numBroadcasts);
+
+	const uint64 samples = mNumSamplesReceived.load();
+	const uint64 newBroadcasts = numBroadcasts - mLastChannelBroadcasts;
+
+	UE_LOG(LogTemp, Display, TEXT("Experience Channel: %.1f samples/s from %d producers, %llu dropped, %.1fms mean model broadcast latency."),
+		   (samples - mLastChannelSamples) / elapsed_s,
+		   mpExperienceChannel->GetNumProducers(),
+		   mpExperienceChannel->GetNumDropped(),
+		   newBroadcasts > 0 ? (totalLatency_s - mLastChannelLatency_s) * 1000.0 / newBroadcasts : 0.0);
+
+	mLastChannelReportTime_s = now_s;
+	mLastChannelSamples = samples;
+	mLastChannelBroadcasts = numBroadcasts;
+	mLastChannelLatency_s = totalLatency_s;
+}
+
+void AScenarioManagerActor::PollPublishedModel()
+{
+	const uint32 version = mpExperienceChannel->GetModelVersion();
+	const uint32 loadedVersion = mLoadedModelVersion;
+	if (version == loadedVersion || (mModelReloadTask && !mModelReloadTask->IsComplete()))
+		return;
+
+	// The learner is rewriting the checkpoint, it is loaded once the save completed.
+	const uint32 saveSequence = mpExperienceChannel->GetModelSaveSequence();
+	if (saveSequence % 2 != 0)
+		return;
+
+	mLoadedModelVersion = version;
+	const double publishTime_s = mpExperienceChannel->GetModelPublishTime_s();
+
+	// Loading the model from disk would stall the game thread.
+	mModelReloadTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, version, loadedVersion, saveSequence, publishTime_s]()
+	{
+		std::unique_ptr<TF::MLModel> model = mpLearner->CreateModel(mpLearner->GetModelName());
+		if (!model)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed To Reload Published Model %u!"), version);
+			return;
+		}
+
+		// The learner saved the statistics before publishing the model, a model without them would run on raw inputs.
+		FObservationNormalizer normalizer(mNormalizationClip);
+		if (mNormalizeObservations && !mpLearner->LoadInputNormalizer(model->GetModelVersion(), normalizer))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("No Observation Statistics Saved For Published Model %u, Keeping The Previous Model!"), version);
+			return;
+		}
+
+		// The next training round started saving while the model and its statistics loaded, they may be
+		// half written. The version is polled again and loaded once that save completed.
+		if (mpExperienceChannel->GetModelSaveSequence() != saveSequence)
+		{
+			mLoadedModelVersion = loadedVersion;
+			return;
+		}
+
+		mpLearner->PublishPolicy(std::move(model), normalizer, version, TEXT("Published Model"));
+
+		// Producers report the rounds of the learner process they follow.
+		mpLearner->SetNumTrainingRounds(version);
+
+		mpExperienceChannel->RecordBroadcastLatency(FPlatformTime::Seconds() - publishTime_s);
+
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void AScenarioManagerActor::ForwardToLearner(const TrainingInfo& info)
+{
+	// Transitions produced before the learner created the channel are dropped.
+	if (mpExperienceChannel && mpExperienceChannel->Push(info))
+		mNumSamplesReceived++;
+}
+
+void AScenarioManagerActor::OnResetNPC(ABaseDungeonActor* actor)
+{
+	if (!actor)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("OnResetNPC called with null actor!"));
+		return;
+	}
+
+	int32 SpawnIndex = mScenarioRandom.RandRange(0, mSpawnPoints.Num() - 1);
+	FVector SpawnLocation = mSpawnPoints[SpawnIndex];
+	actor->ResetActor(SpawnLocation);
+}
+
+std::tuple<EMoveDirection, float> AScenarioManagerActor::SelectMotion(int32 agentId,
+																	 TArrayView<const float> inputs,
+																	 FRandomStream& random)
+{
+	float randChance = mLiveLearning ? random.FRandRange(0.0f, 1.0f) : 1.0f;
+
+	EMoveDirection action = EMoveDirection::None;
+	float action_f = 0;
+
+	// Until the startup warm-up finished the agents explore instead of waiting on the cold model.
+	if (randChance <= ExplorationRate || !IsModelWarmedUp())
+	{
+		// Random Exploration
+		std::tie(action, action_f) = DrawRandomAction(random);
+	}
+	else
+	{
+		const std::shared_ptr<const FPolicySnapshot> pPolicy = GetPolicy();
+		const uint32 generation = pPolicy ? pPolicy->mGeneration : 0;
+		const FScopedStageTimer timer(mpStageTimings.get(), EPerformanceStage::Inference);
+
+		// Use Model to Decide Action
+		if (pPolicy && !mInferenceCache.Find(inputs, generation, action, action_f))
+		{
+			if (!mpDataBuilder)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Data Builder is not initialized!"));
+				return { EMoveDirection::None, 0.0f };
+			}
+
+			mSelectionInputs.assign(inputs.begin(), inputs.end());
+			if (const FObservationNormalizer* pNormalizer = mpLearner->GetPolicyNormalizer(*pPolicy))
+				pNormalizer->Normalize(mSelectionInputs.data(), 1);
+
+			mpDataBuilder->AddInputTensor("state", mSelectionInputs);
+
+
+			TF::LabeledTensor labeled_inputs;
+			if (mpDataBuilder->CreateTensor(labeled_inputs))
+			{
+				const double runStart_s = FPlatformTime::Seconds();
+
+				TF::LabeledTensor outputs;
+				if (pPolicy->mpModel->Run(labeled_inputs, outputs))
+				{
+					const double runTime_s = FPlatformTime::Seconds() - runStart_s;
+					mInferenceCache.RecordInference(runTime_s, 1);
+					RecordFirstInference(generation, runTime_s, 1);
 
-			TF::LabeledTensor labeled_inputs;
-			if (mpDataBuilder->CreateTensor(labeled_inputs))
-			{
-				TF::LabeledTensor outputs;
-				if (mpModel->Run(labeled_inputs, outputs))
-				{
 					cppflow::tensor actionTensor = outputs["action"];
 
 					const std::vector<float> actionData = actionTensor.get_data<float>();
-					if (actionData.size() == 1)
+					if (mUseActionValueHead && actionData.size() == static_cast<size_t>(EMoveDirection::COUNT))
+					{
+						action = ActionFromValues(actionData.data());
+						action_f = static_cast<float>(action);
+						mInferenceCache.Add(inputs, generation, action, action_f);
+					}
+					else if (!mUseActionValueHead && actionData.size() == 1)
 					{
 						action_f = actionData[0];
-
-						int actionIndex = static_cast<int>(FMath::RoundToInt(action_f));
-						actionIndex = FMath::Clamp(actionIndex, (int)EMoveDirection::None, static_cast<int>(EMoveDirection::COUNT) - 1);
-
-						action = static_cast<EMoveDirection>(actionIndex);
+						action = ActionFromValue(action_f);
+						mInferenceCache.Add(inputs, generation, action, action_f);
 					}
 					else
 					{
@@ -328,5 +1717,334 @@ std::tuple<EMoveDirection, float> AScenarioManagerActor::SelectMotion(const std:
 		}
 	}
 
+	// The policy still runs when replaying so its cost is measured, the recorded decision is applied.
+	if (mpReplay)
+	{
+		if (mpReplay->NextDecision(agentId, action, action_f))
+			mNumReplayedDecisions++;
+		else
+			mNumReplayMisses++;
+	}
+
+	if (mpRecording)
+		mpRecording->AddDecision(agentId, action, action_f);
+
 	return { action, action_f };
+}
+
+void AScenarioManagerActor::DrawExplorationActions(int32 count,
+												   FRandomStream& random,
+												   bool explore,
+												   std::vector<std::tuple<EMoveDirection, float>>& outActions,
+												   std::vector<int32>& outExploitIndices) const
+{
+	outActions.assign(count, { EMoveDirection::None, 0.0f });
+	outExploitIndices.clear();
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		float randChance = explore && mLiveLearning ? random.FRandRange(0.0f, 1.0f) : 1.0f;
+
+		if (randChance <= ExplorationRate)
+		{
+			// Random Exploration
+			outActions[i] = DrawRandomAction(random);
+		}
+		else
+		{
+			outExploitIndices.push_back(i);
+		}
+	}
+}
+
+void AScenarioManagerActor::SelectMotionBatch(const std::vector<float>& states,
+											  int32 count,
+											  FRandomStream& random,
+											  std::vector<std::tuple<EMoveDirection, float>>& outActions,
+											  bool explore)
+{
+	// Exploiting samples are gathered into a single model run.
+	std::vector<int32> exploitIndices;
+	DrawExplorationActions(count, random, explore, outActions, exploitIndices);
+
+	if (exploitIndices.empty())
+		return;
+
+	// Until the startup warm-up finished the batch explores instead of waiting on the cold model.
+	if (!IsModelWarmedUp())
+	{
+		for (int32 index : exploitIndices)
+			outActions[index] = DrawRandomAction(random);
+		return;
+	}
+
+	const std::shared_ptr<const FPolicySnapshot> pPolicy = GetPolicy();
+	if (!pPolicy)
+		return;
+
+	// Observations already decided by this generation skip the model run.
+	const uint32 generation = pPolicy->mGeneration;
+	exploitIndices.erase(std::remove_if(exploitIndices.begin(), exploitIndices.end(), [&](int32 index)
+	{
+		auto& [action, action_f] = outActions[index];
+		return mInferenceCache.Find(MakeArrayView(states.data() + static_cast<size_t>(index) * StateSize, StateSize), generation, action, action_f);
+	}), exploitIndices.end());
+
+	if (exploitIndices.empty())
+		return;
+
+	std::vector<float> exploitStates;
+	GatherStates(states, exploitIndices, exploitStates);
+
+	const double runStart_s = FPlatformTime::Seconds();
+
+	std::vector<std::tuple<EMoveDirection, float>> exploitActions;
+	{
+		const FScopedStageTimer timer(mpStageTimings.get(), EPerformanceStage::Inference, static_cast<uint32>(exploitIndices.size()));
+		if (!RunPolicyBatch(*pPolicy->mpModel, mpLearner->GetPolicyNormalizer(*pPolicy), exploitStates, static_cast<int32>(exploitIndices.size()), exploitActions))
+			return;
+	}
+
+	const double runTime_s = FPlatformTime::Seconds() - runStart_s;
+	mInferenceCache.RecordInference(runTime_s, static_cast<int32>(exploitIndices.size()));
+	RecordFirstInference(generation, runTime_s, static_cast<int32>(exploitIndices.size()));
+
+	for (size_t i = 0; i < exploitIndices.size(); ++i)
+	{
+		outActions[exploitIndices[i]] = exploitActions[i];
+
+		const auto [action, action_f] = exploitActions[i];
+		mInferenceCache.Add(MakeArrayView(exploitStates.data() + i * StateSize, StateSize), generation, action, action_f);
+	}
+}
+
+void AScenarioManagerActor::SelectPopulationMotionBatch(int32 memberIndex,
+														const std::vector<float>& states,
+														int32 count,
+														FRandomStream& random,
+														std::vector<std::tuple<EMoveDirection, float>>& outActions)
+{
+	// The inference cache is keyed on the shared generation, so members always run their model.
+	std::vector<int32> exploitIndices;
+	DrawExplorationActions(count, random, true, outActions, exploitIndices);
+
+	if (exploitIndices.empty())
+		return;
+
+	// Members take raw observations, so the snapshot runs without holding the lock.
+	const std::shared_ptr<const FPolicySnapshot> pPolicy = mpPopulation->GetMemberPolicy(memberIndex);
+
+	std::vector<float> exploitStates;
+	GatherStates(states, exploitIndices, exploitStates);
+
+	std::vector<std::tuple<EMoveDirection, float>> exploitActions;
+	if (!RunPolicyBatch(*pPolicy->mpModel, nullptr, exploitStates, static_cast<int32>(exploitIndices.size()), exploitActions))
+		return;
+
+	for (size_t i = 0; i < exploitIndices.size(); ++i)
+		outActions[exploitIndices[i]] = exploitActions[i];
+}
+
+bool AScenarioManagerActor::RunPolicyBatch(TF::MLModel& model,
+										   const FObservationNormalizer* pNormalizer,
+										   const std::vector<float>& states,
+										   int32 count,
+										   std::vector<std::tuple<EMoveDirection, float>>& outActions)
+{
+	std::vector<float> actionData;
+	if (!RunModelBatch(model, pNormalizer, states, count, actionData))
+		return false;
+
+	outActions.resize(count);
+	for (size_t i = 0; i < static_cast<size_t>(count); ++i)
+	{
+		if (mUseActionValueHead)
+		{
+			const EMoveDirection action = ActionFromValues(actionData.data() + i * static_cast<size_t>(EMoveDirection::COUNT));
+			outActions[i] = { action, static_cast<float>(action) };
+		}
+		else
+		{
+			outActions[i] = { ActionFromValue(actionData[i]), actionData[i] };
+		}
+	}
+	return true;
+}
+
+bool AScenarioManagerActor::RunModelBatch(TF::MLModel& model,
+										  const FObservationNormalizer* pNormalizer,
+										  const std::vector<float>& states,
+										  int32 count,
+										  std::vector<float>& outActions)
+{
+	std::unique_ptr<FInferenceBuffers> pBuffers = mInferenceBuffers.Acquire(count);
+
+	const float* inputs = states.data();
+	if (pNormalizer)
+	{
+		const FScopedStageTimer timer(mpStageTimings.get(), EPerformanceStage::Normalization, static_cast<uint32>(count));
+		pBuffers->mInputs.assign(states.begin(), states.begin() + static_cast<size_t>(count) * StateSize);
+		pNormalizer->Normalize(pBuffers->mInputs.data(), count);
+		inputs = pBuffers->mInputs.data();
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		const float* state = inputs + static_cast<size_t>(i) * StateSize;
+		pBuffers->mSample.assign(state, state + StateSize);
+		pBuffers->mpBuilder->AddInputTensor("state", pBuffers->mSample);
+	}
+
+	TF::LabeledTensor labeled_inputs;
+	const bool created = pBuffers->mpBuilder->CreateTensor(labeled_inputs);
+	mInferenceBuffers.Release(std::move(pBuffers));
+	if (!created)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to Create Input!"));
+		return false;
+	}
+
+	TF::LabeledTensor outputs;
+	if (!model.Run(labeled_inputs, outputs))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to Run Model!"));
+		return false;
+	}
+
+	cppflow::tensor actionTensor = outputs["action"];
+
+	outActions = actionTensor.get_data<float>();
+	if (outActions.size() != static_cast<size_t>(count) * GetNumActionOutputs())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid Action Output!"));
+		return false;
+	}
+	return true;
+}
+
+std::shared_ptr<const FPolicySnapshot> AScenarioManagerActor::GetPolicy() const
+{
+	return mpLearner ? mpLearner->GetPolicy() : nullptr;
+}
+
+void AScenarioManagerActor::StartModelWarmUp()
+{
+	mModelWarmUpTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]()
+	{
+		// One buffer for every thread that may run inference at once: the game thread, the rollout
+		// workers, the inference pipeline and the training task.
+		mInferenceBuffers.Reserve(FMath::Max(0, mNumRolloutWorkers) + 3, GetWarmUpBatchSizes().back());
+
+		// Holding the snapshot keeps it alive should a trained model be swapped in meanwhile.
+		const std::shared_ptr<const FPolicySnapshot> pPolicy = GetPolicy();
+		WarmUpModel(*pPolicy->mpModel, TEXT("Startup"));
+
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+bool AScenarioManagerActor::IsModelWarmedUp() const
+{
+	return !mModelWarmUpTask || mModelWarmUpTask->IsComplete();
+}
+
+bool AScenarioManagerActor::WarmUpModel(TF::MLModel& model,
+										const TCHAR* reason)
+{
+	// A stream of its own, so warming up does not shift the scenario's random sequence.
+	FRandomStream random(StateSize);
+
+	std::vector<float> states;
+	std::vector<float> outputs;
+	FString batchTimes;
+
+	const double start_s = FPlatformTime::Seconds();
+	for (int32 batchSize : GetWarmUpBatchSizes())
+	{
+		// Observations in the ranges the agents report, so the run takes the same paths as real decisions.
+		states.resize(static_cast<size_t>(batchSize) * StateSize);
+		for (int32 i = 0; i < batchSize; ++i)
+		{
+			float* state = states.data() + static_cast<size_t>(i) * StateSize;
+			for (int32 ray = 0; ray < NumRayCasts; ++ray)
+			{
+				state[ray * 2] = random.GetFraction();
+				state[ray * 2 + 1] = static_cast<float>(random.RandRange(static_cast<int32>(RayHitType::None), static_cast<int32>(RayHitType::Treasure)));
+			}
+
+			state[NumRayCasts * 2] = random.FRandRange(0.0f, 10000.0f);
+		}
+
+		const double runStart_s = FPlatformTime::Seconds();
+		// Only the model kernels are warmed up, raw observations exercise them as well as normalized ones.
+		if (!RunModelBatch(model, nullptr, states, batchSize, outputs))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s Inference Warm-Up Failed At Batch Size %d!"), reason, batchSize);
+			return false;
+		}
+
+		batchTimes += FString::Printf(TEXT("%s%d: %.2fms"), batchTimes.IsEmpty() ? TEXT("") : TEXT(", "), batchSize, (FPlatformTime::Seconds() - runStart_s) * 1000.0);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("%s Inference Warm-Up In %.1fms (Batch Sizes %s)."), reason, (FPlatformTime::Seconds() - start_s) * 1000.0, *batchTimes);
+	return true;
+}
+
+std::vector<int32> AScenarioManagerActor::GetWarmUpBatchSizes() const
+{
+	// Single decisions, every agent deciding at once, a rollout worker's agents and the per frame decision cap.
+	std::vector<int32> batchSizes { 1, mNumberOfAgents, mAgentsPerRolloutWorker, mMaxDecisionsPerFrame };
+	batchSizes.erase(std::remove_if(batchSizes.begin(), batchSizes.end(), [](int32 batchSize) { return batchSize <= 0; }), batchSizes.end());
+
+	std::sort(batchSizes.begin(), batchSizes.end());
+	batchSizes.erase(std::unique(batchSizes.begin(), batchSizes.end()), batchSizes.end());
+	return batchSizes;
+}
+
+void AScenarioManagerActor::RecordFirstInference(uint32 generation,
+												 double time_s,
+												 int32 count)
+{
+	// Only the first run of a generation is logged, by whichever thread gets there first.
+	uint32 loggedGeneration = mFirstInferenceGeneration.load(std::memory_order_relaxed);
+	if (loggedGeneration == generation || !mFirstInferenceGeneration.compare_exchange_strong(loggedGeneration, generation))
+		return;
+
+	UE_LOG(LogTemp, Display, TEXT("First Inference Of Generation %u In %.2fms For %d States, %d Inference Buffer Reallocations."),
+		   generation,
+		   time_s * 1000.0,
+		   count,
+		   mInferenceBuffers.GetNumReallocations());
+}
+
+void AScenarioManagerActor::RecordEpisodeOutcome(const TrainingInfo& info)
+{
+	if (!info.IsTerminal())
+		return;
+
+	const bool foundTreasure = info.mEvent == ETransitionEvent::FoundTreasure;
+
+	mRecentEpisodeOutcomes.push_back(foundTreasure);
+	mRecentTreasureFinds += foundTreasure ? 1 : 0;
+
+	if (static_cast<int32>(mRecentEpisodeOutcomes.size()) > mTreasureFindRateWindow)
+	{
+		mRecentTreasureFinds -= mRecentEpisodeOutcomes.front() ? 1 : 0;
+		mRecentEpisodeOutcomes.pop_front();
+	}
+
+	if (mReachedTargetFindRate || static_cast<int32>(mRecentEpisodeOutcomes.size()) < mTreasureFindRateWindow)
+		return;
+
+	const float findRate = static_cast<float>(mRecentTreasureFinds) / mRecentEpisodeOutcomes.size();
+	if (findRate >= mTargetTreasureFindRate)
+	{
+		mReachedTargetFindRate = true;
+
+		UE_LOG(LogTemp, Display, TEXT("Reached %.0f%% Treasure Find Rate After %.1fs And %d Training Rounds (%s Head, %s Observations)."),
+			   findRate * 100.0f,
+			   FPlatformTime::Seconds() - mStartTime_s,
+			   GetNumTrainingRounds(),
+			   mUseActionValueHead ? TEXT("Action Value") : TEXT("Single Output"),
+			   mNormalizeObservations ? TEXT("Normalized") : TEXT("Raw"));
+	}
 }
\ No newline at end of file
@@ -4,16 +4,37 @@
 #include "GameFramework/Actor.h"
 
 #include "NPCDefines.h"
+#include "BaseDungeonActor.h"
+#include "AgentScheduler.h"
+#include "CompactTransition.h"
+#include "DecisionRecording.h"
+#include "EvolutionTrainer.h"
+#include "ExperienceChannel.h"
+#include "FrameArena.h"
+#include "InferenceBuffers.h"
+#include "InferenceCache.h"
+#include "ObservationNormalizer.h"
+#include "PerceptionCache.h"
+#include "PolicyEvaluator.h"
+#include "PolicyLearner.h"
+#include "PopulationTrainer.h"
+#include "TrajectoryBuffer.h"
+#include "RolloutWorker.h"
 
 #include "TFModelLib.h"
 
+#include <atomic>
+#include <deque>
 #include <mutex>
+#include <string>
 
 #include "ScenarioManagerActor.generated.h"
 
 class ABaseDungeonActor;
 class ARandomNPCActor;
 class ALearningNPCActor;
+class UHierarchicalInstancedStaticMeshComponent;
+class UStaticMesh;
 
 
 /// <summary>
@@ -27,6 +48,46 @@ enum class EScenarioType : uint8
 };
 
 
+/// <summary>
+/// The role of the sandbox process in multi-process training.
+/// </summary>
+UENUM(BlueprintType)
+enum class EExperienceRole : uint8
+{
+	None,
+	Producer,
+	Learner
+};
+
+
+/// <summary>
+/// A batch of pipelined decision requests and their inference results.
+/// </summary>
+struct FInferenceStage
+{
+	TArray<TWeakObjectPtr<ALearningNPCActor>> mNPCs;
+	std::vector<uint32> mRequestIds;
+	std::vector<float> mStates;
+
+	std::vector<std::tuple<EMoveDirection, float>> mActions;
+	FRandomStream mRandom;
+
+	FGraphEventRef mTask;
+	uint64 mDispatchFrame = 0;
+};
+
+
+/// <summary>
+/// A learning NPC denied a decision slot, waiting for one of the following frames.
+/// </summary>
+struct FDecisionWait
+{
+	// Handed out in the order the NPCs were first denied, lower tickets waited longer.
+	uint64 mTicket = 0;
+	uint64 mLastRequestFrame = 0;
+};
+
+
 /// <summary>
 /// Scenario Manager Actor for managing NPCs in the dungeon.
 /// </summary>
@@ -49,13 +110,25 @@ public:
 	/// Overridable native event for when this actor is being destroyed.
 	/// </summary>
 	virtual void BeginDestroy() override;
+
+	/// <summary>
+	/// Overridable native event for when play ends for this actor, saves the decision recording.
+	/// </summary>
+	/// <param name="EndPlayReason">The reason play ended</param>
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/// <summary>
+	/// Function called every frame on this Actor.
+	/// </summary>
+	/// <param name="DeltaSeconds">Game time elapsed during last frame modified by the time dilation</param>
+	virtual void Tick(float DeltaSeconds) override;
 public:
 	/// <summary>
-	/// Retrieves the number of NPCs currently managed by this actor.
+	/// Retrieves the number of NPCs currently managed by this actor, including instanced agents.
 	/// </summary>
 	/// <returns>The number of NPCs</returns>
 	UFUNCTION(BlueprintCallable)
-	int32 GetNumNPCs() const { return mpNPCs.Num(); }
+	int32 GetNumNPCs() const { return mpNPCs.Num() + (mpInstancedDungeon ? mpInstancedDungeon->GetNumAgents() : 0); }
 
 	/// <summary>
 	/// Retrieves the current model version number/generation.
@@ -63,7 +136,110 @@ public:
 	/// <returns>The model version</returns>
 	UFUNCTION(BlueprintCallable)
 	int32 GetModelVersion() const;
+
+	/// <summary>
+	/// Retrieves the number of completed training rounds.
+	/// </summary>
+	/// <returns>The number of training rounds</returns>
+	UFUNCTION(BlueprintCallable)
+	int32 GetNumTrainingRounds() const { return static_cast<int32>((mpLearner ? mpLearner->GetNumTrainingRounds() : 0) + (mpPopulation ? mpPopulation->GetNumTrainingRounds() : 0)); }
+
+	/// <summary>
+	/// Retrieves the number of training samples received from all agents.
+	/// </summary>
+	/// <returns>The number of samples</returns>
+	UFUNCTION(BlueprintCallable)
+	int64 GetNumSamplesReceived() const { return static_cast<int64>(mNumSamplesReceived.load() + (mpPopulation ? mpPopulation->GetNumSamplesReceived() : 0)); }
+
+	/// <summary>
+	/// Retrieves the number of samples dispatched to training rounds.
+	/// </summary>
+	/// <returns>The number of samples</returns>
+	UFUNCTION(BlueprintCallable)
+	int64 GetNumSamplesTrained() const { return mpLearner ? static_cast<int64>(mpLearner->GetNumSamplesTrained()) : 0; }
+
+	/// <summary>
+	/// Retrieves a percentile of the recorded frame times.
+	/// </summary>
+	/// <param name="percentile">The percentile in [0, 100]</param>
+	/// <returns>The frame time in milliseconds, 0 if no frames were recorded</returns>
+	UFUNCTION(BlueprintCallable)
+	float GetFrameTimePercentile(float percentile) const;
+
+	/// <summary>
+	/// Starts evaluating the latest saved model greedily across every seed, spawn and treasure
+	/// point combination on headless dungeons. Runs in the background and logs the outcome.
+	/// </summary>
+	/// <returns>True if the evaluation was queued</returns>
+	UFUNCTION(BlueprintCallable)
+	bool EvaluatePolicy();
+
+	/// <summary>
+	/// Retrieves the outcome of the last finished policy evaluation.
+	/// </summary>
+	/// <returns>The treasure find rate, 0 until an evaluation finished</returns>
+	UFUNCTION(BlueprintCallable)
+	float GetEvaluationSuccessRate() const { return mEvaluationSuccessRate.load(); }
+
+	/// <summary>
+	/// Moves every NPC along the same random direction sequence in alternating swept and
+	/// kinematic passes, restoring their locations afterwards, and logs the movement cost
+	/// per agent step of both modes and how far they diverged.
+	/// </summary>
+	/// <param name="numSteps">The number of movement steps per pass</param>
+	/// <returns>The speedup of the kinematic movement, 0 if it could not be measured</returns>
+	UFUNCTION(BlueprintCallable)
+	float BenchmarkMovement(int32 numSteps);
+
+	/// <summary>
+	/// Drops the cached static perception, to be called after moving or replacing level geometry.
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	void InvalidatePerceptionCache();
+
+	/// <summary>
+	/// Retrieves the per-stage timings of the run.
+	/// </summary>
+	/// <returns>The timings, null unless stage timings are recorded or decisions replayed</returns>
+	inline const FStageTimings* GetStageTimings() const { return mpStageTimings.get(); }
 private:
+	/// <summary>
+	/// Creates the learner and loads its model, shared by every scenario that runs the policy.
+	/// </summary>
+	void StartLearner();
+
+	/// <summary>
+	/// Logs the inference cache, reward and perception statistics and the observation lag
+	/// of a training batch, called on the training task before the round trains on it.
+	/// </summary>
+	/// <param name="trainingData">The training batch</param>
+	void ReportTrainingRound(const std::vector<FCompactTransition>& trainingData);
+
+	/// <summary>
+	/// Loads a private copy of the latest checkpoint and evaluates it on its own task, skipped while
+	/// the previous evaluation still runs. The learner takes the copy while no checkpoint is saved,
+	/// so neither the gradient rounds nor the evolution exports rewrite it meanwhile.
+	/// </summary>
+	void StartPolicyEvaluation();
+
+	/// <summary>
+	/// Runs the greedy policy evaluation over the captured dungeon layout.
+	/// </summary>
+	/// <param name="policy">The private copy of the evaluated generation</param>
+	/// <returns>The evaluation result</returns>
+	FPolicyEvaluationResult RunPolicyEvaluation(const FPolicySnapshot& policy);
+
+	/// <summary>
+	/// Appends an evaluated generation to the learning curve file, so runs of different
+	/// learners can be compared by success rate over wall time.
+	/// </summary>
+	/// <param name="checkpointTime_s">The time since BeginPlay at which the generation was saved</param>
+	/// <param name="generation">The evaluated generation</param>
+	/// <param name="result">The evaluation result</param>
+	void AppendLearningCurve(double checkpointTime_s,
+							 uint32 generation,
+							 const FPolicyEvaluationResult& result) const;
+
 	/// <summary>
 	/// Spawns NPCs based on the current scenario type.
 	/// </summary>
@@ -79,12 +255,199 @@ private:
 	/// </summary>
 	void SpawnTrainingNPCs();
 
+	/// <summary>
+	/// Spawns and registers a learning NPC.
+	/// </summary>
+	/// <param name="location">The spawn location</param>
+	/// <returns>The spawned NPC</returns>
+	ALearningNPCActor* SpawnLearningNPC(const FVector& location);
+
+	/// <summary>
+	/// Offsets the decision timer of a learning NPC by its phase bucket.
+	/// </summary>
+	/// <param name="npc">The learning NPC</param>
+	/// <param name="index">The NPC index</param>
+	void AssignDecisionPhase(ALearningNPCActor* npc,
+							 int32 index) const;
+
+	/// <summary>
+	/// Grants a decision slot while the per-frame decision budget allows, the NPCs that
+	/// waited longest are granted first so a fixed tick order cannot starve any of them.
+	/// </summary>
+	/// <param name="npc">The learning NPC requesting a decision</param>
+	/// <returns>True if the NPC may decide this frame</returns>
+	bool TryScheduleDecision(ALearningNPCActor* npc);
+
+	/// <summary>
+	/// Starts the decision budget of a new frame, dropping NPCs that stopped waiting
+	/// and reserving the slots of the ones that waited longest.
+	/// </summary>
+	void BeginDecisionFrame();
+
+	/// <summary>
+	/// Queues a learning NPC decision for the next batched inference stage.
+	/// </summary>
+	/// <param name="npc">The learning NPC</param>
+	/// <param name="requestId">The NPC's decision request id</param>
+	/// <param name="state">The state input</param>
+	void OnDecisionRequested(ALearningNPCActor* npc,
+							 uint32 requestId,
+							 TArrayView<const float> state);
+
+	/// <summary>
+	/// Dispatches the decisions gathered this frame to a background batched inference
+	/// task and applies the actions of the stages that reached the pipeline latency.
+	/// </summary>
+	void AdvanceInferencePipeline();
+
+	/// <summary>
+	/// Waits for and discards the in-flight inference stages.
+	/// </summary>
+	void FlushInferencePipeline();
+
+	/// <summary>
+	/// Records the wall time of the last frame and reports the
+	/// frame time percentiles once the window is filled.
+	/// </summary>
+	void RecordFrameTime();
+
+	/// <summary>
+	/// Assigns the coins dense ids and gathers the treasure and hazard contact volumes.
+	/// </summary>
+	void BuildContactTargets();
+
+	/// <summary>
+	/// Creates the perception cache shared by the learning NPCs, ignoring the NPCs, coins and the treasure.
+	/// </summary>
+	void StartPerceptionCache();
+
+	/// <summary>
+	/// Invalidates the perception cache when a streamed level is added to or removed from the world.
+	/// </summary>
+	/// <param name="level">The level</param>
+	/// <param name="world">The world the level belongs to</param>
+	void OnLevelsChanged(ULevel* level,
+						 UWorld* world);
+
+	/// <summary>
+	/// Logs the perception cache hit rate and memory use.
+	/// </summary>
+	void LogPerceptionCache() const;
+
+	/// <summary>
+	/// Detects the coin, treasure and hazard contacts of every agent in a single batched pass,
+	/// firing each contact once when it begins like an overlap event.
+	/// </summary>
+	void DetectContacts();
+
+	/// <summary>
+	/// Spawns the actorless instanced training agents for the learning scenario.
+	/// </summary>
+	void SpawnInstancedAgents();
+
+	/// <summary>
+	/// Steps the instanced agents and updates their instance transforms in bulk.
+	/// </summary>
+	/// <param name="deltaTime">The time step</param>
+	void TickInstancedAgents(float deltaTime);
+
+	/// <summary>
+	/// Captures the dungeon layout and the headless agent settings from the learning actor template.
+	/// </summary>
+	/// <returns>True if the layout was captured</returns>
+	bool CaptureDungeonLayout();
+
+	/// <summary>
+	/// Creates and registers an instanced static mesh component.
+	/// </summary>
+	/// <param name="mesh">The instanced mesh</param>
+	/// <returns>The component</returns>
+	UHierarchicalInstancedStaticMeshComponent* CreateInstancedMeshComponent(UStaticMesh* mesh);
+
+	/// <summary>
+	/// Captures the dungeon layout and starts the headless rollout workers.
+	/// </summary>
+	void StartRolloutWorkers();
+
+	/// <summary>
+	/// Stops and releases the headless rollout workers.
+	/// </summary>
+	void StopRolloutWorkers();
+
 	/// <summary>
 	/// On ReceiveTrainingData callback to handle training data received from NPCs.
 	/// </summary>
 	/// <param name="newInfo">The training infor</param>
 	void OnReceiveTrainingData(const TrainingInfo& newInfo);
 
+	/// <summary>
+	/// On ReceiveRolloutData callback to handle training data streamed from rollout workers.
+	/// </summary>
+	/// <param name="transitions">The transitions, moved from</param>
+	void OnReceiveRolloutData(std::vector<TrainingInfo>& transitions);
+
+	/// <summary>
+	/// Adds a received transition to the training data, through the agent's
+	/// trajectory when returns are computed per trajectory.
+	/// Expects the training mutex to be held.
+	/// </summary>
+	/// <param name="info">The received transition</param>
+	void AddTrainingSample(const TrainingInfo& info);
+
+	/// <summary>
+	/// Appends closed trajectory segments to the training data.
+	/// Expects the training mutex to be held.
+	/// </summary>
+	void FlushClosedSegments();
+
+	/// <summary>
+	/// Checks whether a training round is due, after a fixed number of samples or, when
+	/// training continuously, as soon as the learner is idle and enough samples are pending.
+	/// Expects the training mutex to be held.
+	/// </summary>
+	/// <returns>True if a training round should be dispatched</returns>
+	bool ShouldDispatchTraining() const;
+
+	/// <summary>
+	/// Hands the accumulated training data to the learner, queued behind its running round.
+	/// Expects the training mutex to be held.
+	/// </summary>
+	void DispatchTraining();
+
+	/// <summary>
+	/// Starts the population based trainer, one member per rollout worker at most.
+	/// </summary>
+	void StartPopulation();
+
+	/// <summary>
+	/// Starts the evolution strategies trainer in place of the gradient rounds, exporting into the learner's model.
+	/// </summary>
+	void StartEvolutionStrategies();
+
+	/// <summary>
+	/// Creates the experience channel as the learner or opens it as a producer.
+	/// </summary>
+	/// <returns>True if the channel is open</returns>
+	bool OpenExperienceChannel();
+
+	/// <summary>
+	/// Drains the experience channel into the training data and reports its throughput as the
+	/// learner, or picks up the published models and retries opening the channel as a producer.
+	/// </summary>
+	void TickExperienceChannel();
+
+	/// <summary>
+	/// Reloads the model on a background task when the learner published a new version.
+	/// </summary>
+	void PollPublishedModel();
+
+	/// <summary>
+	/// Writes a transition into the experience channel instead of training on it.
+	/// Expects the training mutex to be held.
+	/// </summary>
+	/// <param name="info">The transition</param>
+	void ForwardToLearner(const TrainingInfo& info);
+
 	/// <summary>
 	/// On ResetNPC callback to reset the NPC actor's position and state.
 	/// </summary>
@@ -94,9 +457,144 @@ private:
 	/// <summary>
 	/// Selects the motion direction based on the inputs provided.
 	/// </summary>
+	/// <param name="agentId">The deciding agent, its decisions are recorded or replayed</param>
 	/// <param name="inputs">The state input</param>
+	/// <param name="random">The agent's random stream</param>
 	/// <returns>The move action and float value output</returns>
-	std::tuple<EMoveDirection, float> SelectMotion(const std::vector<float>& inputs);
+	std::tuple<EMoveDirection, float> SelectMotion(int32 agentId,
+												   TArrayView<const float> inputs,
+												   FRandomStream& random);
+
+	/// <summary>
+	/// Draws the random exploration actions of a batch and gathers the samples left to the policy.
+	/// </summary>
+	/// <param name="count">The number of states</param>
+	/// <param name="random">The random stream used for exploration</param>
+	/// <param name="explore">Whether to take random exploration actions while learning</param>
+	/// <param name="outActions">The move actions, set for the exploring samples</param>
+	/// <param name="outExploitIndices">The samples the policy decides</param>
+	void DrawExplorationActions(int32 count,
+								FRandomStream& random,
+								bool explore,
+								std::vector<std::tuple<EMoveDirection, float>>& outActions,
+								std::vector<int32>& outExploitIndices) const;
+
+	/// <summary>
+	/// Selects the motion directions for a batch of flattened states with a single model run.
+	/// </summary>
+	/// <param name="states">The flattened state inputs</param>
+	/// <param name="count">The number of states</param>
+	/// <param name="random">The random stream used for exploration</param>
+	/// <param name="outActions">The move actions and float value outputs</param>
+	/// <param name="explore">Whether to take random exploration actions while learning</param>
+	void SelectMotionBatch(const std::vector<float>& states,
+						   int32 count,
+						   FRandomStream& random,
+						   std::vector<std::tuple<EMoveDirection, float>>& outActions,
+						   bool explore);
+
+	/// <summary>
+	/// Selects the motion directions of a population member's rollout agents with its own model.
+	/// </summary>
+	/// <param name="memberIndex">The population member</param>
+	/// <param name="states">The flattened state inputs</param>
+	/// <param name="count">The number of states</param>
+	/// <param name="random">The random stream used for exploration</param>
+	/// <param name="outActions">The move actions and float value outputs</param>
+	void SelectPopulationMotionBatch(int32 memberIndex,
+									 const std::vector<float>& states,
+									 int32 count,
+									 FRandomStream& random,
+									 std::vector<std::tuple<EMoveDirection, float>>& outActions);
+
+	/// <summary>
+	/// Runs a model over a batch of flattened states and maps its outputs to move actions.
+	/// </summary>
+	/// <param name="model">The model to run</param>
+	/// <param name="pNormalizer">The statistics the model inputs are normalized with, null for raw observations</param>
+	/// <param name="states">The flattened state inputs</param>
+	/// <param name="count">The number of states</param>
+	/// <param name="outActions">The move actions and float value outputs</param>
+	/// <returns>True if the model ran successfully</returns>
+	bool RunPolicyBatch(TF::MLModel& model,
+						const FObservationNormalizer* pNormalizer,
+						const std::vector<float>& states,
+						int32 count,
+						std::vector<std::tuple<EMoveDirection, float>>& outActions);
+
+	/// <summary>
+	/// Runs a model over a batch of flattened states.
+	/// </summary>
+	/// <param name="model">The model to run</param>
+	/// <param name="pNormalizer">The statistics the model inputs are normalized with, null for raw observations</param>
+	/// <param name="states">The flattened state inputs</param>
+	/// <param name="count">The number of states</param>
+	/// <param name="outActions">The flattened action outputs</param>
+	/// <returns>True if the model ran successfully</returns>
+	bool RunModelBatch(TF::MLModel& model,
+					   const FObservationNormalizer* pNormalizer,
+					   const std::vector<float>& states,
+					   int32 count,
+					   std::vector<float>& outActions);
+
+	/// <summary>
+	/// Retrieves the learner's policy snapshot decisions are run with, held by the caller for the length of its run.
+	/// </summary>
+	/// <returns>The snapshot, null if no model is loaded</returns>
+	std::shared_ptr<const FPolicySnapshot> GetPolicy() const;
+
+	/// <summary>
+	/// Pre-sizes the inference buffers and warms the loaded policy up on a background task.
+	/// </summary>
+	void StartModelWarmUp();
+
+	/// <summary>
+	/// Retrieves whether the startup warm-up finished, decisions explore randomly until it has.
+	/// </summary>
+	/// <returns>True once the policy is warmed up or when no warm-up was started</returns>
+	bool IsModelWarmedUp() const;
+
+	/// <summary>
+	/// Runs a model over representative batches of every warm-up batch size, so the
+	/// one-time initialization of the model's kernels is not paid by a decision.
+	/// </summary>
+	/// <param name="model">The model to warm up, on raw observations of the agents' ranges</param>
+	/// <param name="reason">What the model is warmed up for, for the log</param>
+	/// <returns>True if every warm-up batch ran successfully</returns>
+	bool WarmUpModel(TF::MLModel& model,
+					 const TCHAR* reason);
+
+	/// <summary>
+	/// Retrieves the batch sizes decisions are run in.
+	/// </summary>
+	/// <returns>The unique batch sizes in ascending order</returns>
+	std::vector<int32> GetWarmUpBatchSizes() const;
+
+	/// <summary>
+	/// Logs the latency of the first decision run of a model generation.
+	/// </summary>
+	/// <param name="generation">The training round the decision ran with</param>
+	/// <param name="time_s">The model run time</param>
+	/// <param name="count">The number of states in the run</param>
+	void RecordFirstInference(uint32 generation,
+							  double time_s,
+							  int32 count);
+
+	/// <summary>
+	/// Tracks the treasure find rate over the most recent episodes.
+	/// Expects the training mutex to be held.
+	/// </summary>
+	/// <param name="info">The received transition</param>
+	void RecordEpisodeOutcome(const TrainingInfo& info);
+
+	/// <summary>
+	/// Retrieves the number of model outputs per state.
+	/// </summary>
+	/// <returns>The number of outputs</returns>
+	inline int32 GetNumActionOutputs() const
+	{
+		return mUseActionValueHead ? static_cast<int32>(EMoveDirection::COUNT) : 1;
+	}
 public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML")
 	EScenarioType mCurrentScenario;
@@ -104,6 +602,9 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
 	bool mLiveLearning = false;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML")
+	bool mUseActionValueHead = false;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category= "ML|Training")
     int32 mNumberOfAgents = 100;
 
@@ -116,12 +617,195 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
     int32 mTrainingBatches = 4;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	int32 mAssemblyMinibatchSize = 256;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
     float mLearningRate =  0.001;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
     float mLearningGamma =  0.95;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	int32 mTargetUpdateInterval = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	bool mContinuousTraining = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	int32 mMinTrainingBatches = 25;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	float mMaxEpisodeTime_s = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	bool mUseTrajectoryReturns = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	int32 mReturnSteps = 5;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	int32 mMaxTrajectoryLength = 128;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	float mTargetTreasureFindRate = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Training")
+	int32 mTreasureFindRateWindow = 100;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rollout")
+	int32 mNumRolloutWorkers = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rollout")
+	int32 mAgentsPerRolloutWorker = 64;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rollout")
+	float mRolloutStepTime_s = 1.0f / 30.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rollout")
+	float mLayoutCellSize_cm = 25.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rollout")
+	float mPickupRadius_cm = 50.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Population")
+	int32 mPopulationSize = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Population")
+	int32 mPopulationExploitInterval = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Population")
+	float mPopulationExploitFraction = 0.25f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Population")
+	float mPopulationPerturbation = 0.2f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	bool mEvolutionStrategies = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	int32 mEvolutionPerturbations = 64;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	float mEvolutionNoiseStdDev = 0.05f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	float mEvolutionLearningRate = 0.01f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	int32 mEvolutionAgentsPerEvaluation = 8;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	float mEvolutionEpisodeTime_s = 60.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	int32 mEvolutionExportInterval = 10;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evolution")
+	int32 mEvolutionExportStates = 4096;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Transport")
+	EExperienceRole mExperienceRole = EExperienceRole::None;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Transport")
+	FString mExperienceChannelName = TEXT("ForgeML_DungeonExperience");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Transport")
+	int32 mExperienceChannelCapacity = 65536;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Contacts")
+	bool mBatchedContactDetection = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Rewards")
+	TArray<FRewardTerm> mRewardTerms = FRewardKernel::GetDefaultTerms();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Replay")
+	int32 mRandomSeed = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Replay")
+	FString mRecordDecisionsPath;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Replay")
+	FString mReplayDecisionsPath;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Replay")
+	bool mRecordStageTimings = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Movement")
+	bool mKinematicMovement = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Scheduling")
+	int32 mNumDecisionBuckets = 8;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Scheduling")
+	int32 mMaxDecisionsPerFrame = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Scheduling")
+	bool mReportFrameTimes = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Scheduling")
+	bool mCoroutineAgents = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Scheduling")
+	int32 mFrameTimeWindow = 600;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Inference")
+	bool mUseInferenceCache = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Inference")
+	int32 mInferenceCacheCapacity = 65536;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Inference")
+	float mInferenceCacheQuantization = 0.05f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Inference")
+	float mInferenceCacheTreasureQuantization_cm = 100.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Perception")
+	bool mUsePerceptionCache = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Perception")
+	int32 mPerceptionCacheCapacity = 65536;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Perception")
+	float mPerceptionCellSize_cm = 25.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Inference")
+	bool mWarmUpInference = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Normalization")
+	bool mNormalizeObservations = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Normalization")
+	float mNormalizationClip = 5.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Pipeline")
+	bool mPipelinedInference = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Pipeline")
+	int32 mPipelineLatencyFrames = 2;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evaluation")
+	bool mEvaluateAfterTraining = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evaluation")
+	int32 mEvaluationSeeds = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evaluation")
+	float mEvaluationEpisodeTime_s = 120.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Evaluation")
+	FString mLearningCurvePath;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Instancing")
+	bool mUseInstancedAgents = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Instancing")
+	UStaticMesh* mpAgentMesh = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML|Instancing")
+	UStaticMesh* mpCoinMesh = nullptr;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ML")
 	TSubclassOf<AActor> mpTreasureTemplate;
 
@@ -152,13 +836,116 @@ private:
 	UPROPERTY()
 	TArray<AActor*> mCoins;
 
+	UPROPERTY()
+	UHierarchicalInstancedStaticMeshComponent* mpAgentInstances = nullptr;
+
+	UPROPERTY()
+	UHierarchicalInstancedStaticMeshComponent* mpCoinInstances = nullptr;
+
 	FVector mTreasureLocation;
+	float mTreasureRadius_cm = 0;
+
+	std::shared_ptr<FPerceptionCache> mpPerceptionCache = nullptr;
+	FDelegateHandle mLevelAddedHandle;
+	FDelegateHandle mLevelRemovedHandle;
+
+	std::shared_ptr<const FDungeonCoinRegistry> mpCoinRegistry = nullptr;
+	std::shared_ptr<const FRewardKernel> mpRewardKernel = nullptr;
+	TArray<FBox> mHazardBounds;
+	TArray<float> mContactRadii;
+	TArray<uint8> mAgentContacts;
+	TBitArray<> mCoinContacts;
+
+	// Trains the model and publishes the policy snapshot decisions run with, null if no model could be loaded.
+	std::unique_ptr<FPolicyLearner> mpLearner = nullptr;
 
-	uint32_t mGeneration = 0;
-	std::unique_ptr<TF::MLModel> mpModel = nullptr;
 	std::unique_ptr<TF::FlatFloatDataBuilder> mpDataBuilder = nullptr;
+	std::vector<float> mSelectionInputs;
+
+	FFrameArena mFrameArena;
+	FInferenceCache mInferenceCache;
+	FInferenceBufferPool mInferenceBuffers;
+	FGraphEventRef mModelWarmUpTask;
+	std::atomic<uint32> mFirstInferenceGeneration = MAX_uint32;
 
 	std::mutex mTrainingMutex;
-	std::vector<TrainingInfo> mTrainingData {};
-	FGraphEventRef mTrainingTask;
+	std::vector<FCompactTransition> mTrainingData {};
+	std::unique_ptr<FTrajectoryBuffer> mpTrajectories = nullptr;
+	std::vector<TrainingInfo> mClosedSegments;
+	int32 mNextAgentId = 0;
+
+	std::mutex mEvaluationMutex;
+	FGraphEventRef mEvaluationTask;
+	std::atomic<float> mEvaluationSuccessRate = 0;
+	double mLearningCurveStart_s = 0;
+	std::atomic<uint64_t> mNumSamplesReceived = 0;
+
+	double mStartTime_s = 0;
+	std::deque<bool> mRecentEpisodeOutcomes;
+	int32 mRecentTreasureFinds = 0;
+	bool mReachedTargetFindRate = false;
+
+	std::shared_ptr<const FDungeonLayout> mpDungeonLayout = nullptr;
+	FHeadlessDungeonSettings mHeadlessSettings;
+	std::vector<std::unique_ptr<FRolloutWorker>> mRolloutWorkers;
+
+	std::unique_ptr<FEvolutionTrainer> mpEvolutionTrainer = nullptr;
+
+	std::unique_ptr<FExperienceChannel> mpExperienceChannel = nullptr;
+	std::vector<TrainingInfo> mChannelTransitions;
+	FGraphEventRef mModelReloadTask;
+	std::atomic<uint32> mLoadedModelVersion = 0;
+	double mLastChannelAttempt_s = 0;
+	double mLastChannelReportTime_s = 0;
+	uint64 mLastChannelSamples = 0;
+	uint64 mLastChannelBroadcasts = 0;
+	double mLastChannelLatency_s = 0;
+
+	// Trains the population members through the learner, null unless population based training runs.
+	std::unique_ptr<FPopulationTrainer> mpPopulation = nullptr;
+
+	std::unique_ptr<FHeadlessDungeon> mpInstancedDungeon = nullptr;
+	FRandomStream mInstancedRandom;
+	TArray<FTransform> mAgentTransforms;
+	std::vector<int32> mInstancedDecisions;
+	std::vector<float> mInstancedStates;
+	std::vector<std::tuple<EMoveDirection, float>> mInstancedActions;
+	std::vector<TrainingInfo> mInstancedTransitions;
+
+	uint64 mDecisionFrame = 0;
+	int32 mDecisionsThisFrame = 0;
+	uint64 mNumDeferredDecisions = 0;
+
+	TMap<const ALearningNPCActor*, FDecisionWait> mDecisionWaits;
+	std::vector<uint64> mDecisionWaitTickets;
+	uint64 mNextDecisionWaitTicket = 0;
+	uint64 mReservedDecisionTicket = 0;
+	int32 mReservedDecisions = 0;
+
+	std::unique_ptr<FAgentScheduler> mpAgentScheduler = nullptr;
+
+	std::unique_ptr<FInferenceStage> mpGatheringStage = nullptr;
+	std::deque<std::unique_ptr<FInferenceStage>> mInferenceStages;
+	std::vector<std::unique_ptr<FInferenceStage>> mFreeInferenceStages;
+	FRandomStream mPipelineRandom;
+
+	// Every scenario level random choice is drawn from the seeded stream.
+	int32 mScenarioSeed = 0;
+	FRandomStream mScenarioRandom;
+
+	std::unique_ptr<FDecisionRecording> mpRecording = nullptr;
+	std::unique_ptr<FDecisionRecording> mpReplay = nullptr;
+	uint64 mNumReplayedDecisions = 0;
+	uint64 mNumReplayMisses = 0;
+	bool mReplayScenarioMismatch = false;
+
+	std::unique_ptr<FStageTimings> mpStageTimings = nullptr;
+	uint64 mLastTickCycles = 0;
+
+	std::vector<float> mFrameTimes_ms;
+	size_t mNextFrameTime = 0;
+	double mLastFrameTime_s = 0;
+
+	uint64 mLastRolloutTransitions = 0;
+	double mLastRolloutReportTime_s = 0;
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "StageTimings.h"
+
+#include "Misc/FileHelper.h"
+
+double FStageTimings::GetMeanTime_us(EPerformanceStage stage) const
+{
+	const uint64 count = GetCount(stage);
+	if (count == 0)
+		return 0;
+
+	return FPlatformTime::ToSeconds64(mCycles[static_cast<size_t>(stage)].load(std::memory_order_relaxed)) * 1000000.0 / count;
+}
+
+const TCHAR* FStageTimings::GetStageName(EPerformanceStage stage)
+{
+	switch (stage)
+	{
+	case EPerformanceStage::Frame:
+		return TEXT("Frame");
+	case EPerformanceStage::Perception:
+		return TEXT("Perception");
+	case EPerformanceStage::Movement:
+		return TEXT("Movement");
+	case EPerformanceStage::Inference:
+		return TEXT("Inference");
+	case EPerformanceStage::Normalization:
+		return TEXT("Normalization");
+	case EPerformanceStage::Training:
+		return TEXT("Training");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+void FStageTimings::Log() const
+{
+	for (int32 i = 0; i < static_cast<int32>(EPerformanceStage::COUNT); ++i)
+	{
+		const EPerformanceStage stage = static_cast<EPerformanceStage>(i);
+		if (GetCount(stage) == 0)
+			continue;
+
+		UE_LOG(LogTemp, Display, TEXT("  %s: %.3fus x %llu"), GetStageName(stage), GetMeanTime_us(stage), GetCount(stage));
+	}
+}
+
+bool FStageTimings::Save(const FString& path) const
+{
+	FString report;
+	for (int32 i = 0; i < static_cast<int32>(EPerformanceStage::COUNT); ++i)
+	{
+		const EPerformanceStage stage = static_cast<EPerformanceStage>(i);
+		report += FString::Printf(TEXT("%s %f %llu\n"), GetStageName(stage), GetMeanTime_us(stage), GetCount(stage));
+	}
+
+	if (!FFileHelper::SaveStringToFile(report, *path))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Write Stage Report %s!"), *path);
+		return false;
+	}
+	return true;
+}
+
+bool FStageTimings::CompareToBaseline(const FString& path,
+									  float tolerance) const
+{
+	TArray<FString> lines;
+	if (!FFileHelper::LoadFileToStringArray(lines, *path))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed To Read Stage Baseline %s!"), *path);
+		return false;
+	}
+
+	bool passed = true;
+	for (const FString& line : lines)
+	{
+		TArray<FString> fields;
+		if (line.ParseIntoArrayWS(fields) < 3)
+			continue;
+
+		for (int32 i = 0; i < static_cast<int32>(EPerformanceStage::COUNT); ++i)
+		{
+			const EPerformanceStage stage = static_cast<EPerformanceStage>(i);
+			if (!fields[0].Equals(GetStageName(stage)))
+				continue;
+
+			// Stages only measured by one of the runs cannot be compared.
+			const double baseline_us = FCString::Atod(*fields[1]);
+			const double current_us = GetMeanTime_us(stage);
+			if (baseline_us <= 0 || current_us <= 0)
+				break;
+
+			const double change = current_us / baseline_us - 1.0;
+			if (change > tolerance)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Performance Regression In %s: %.3fus vs %.3fus Baseline (%+.1f%%)."), GetStageName(stage), current_us, baseline_us, change * 100.0);
+				passed = false;
+			}
+			else
+			{
+				UE_LOG(LogTemp, Display, TEXT("  %s: %.3fus vs %.3fus Baseline (%+.1f%%)."), GetStageName(stage), current_us, baseline_us, change * 100.0);
+			}
+			break;
+		}
+	}
+	return passed;
+}
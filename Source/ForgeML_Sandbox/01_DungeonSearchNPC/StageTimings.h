@@ -0,0 +1,133 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <array>
+#include <atomic>
+
+
+/// <summary>
+/// The sandbox stages timed for performance regression checks.
+/// </summary>
+enum class EPerformanceStage : uint8
+{
+	Frame,
+	Perception,
+	Movement,
+	Inference,
+	Normalization,
+	Training,
+
+	COUNT
+};
+
+
+/// <summary>
+/// Accumulated wall time per sandbox stage, safe to add to from multiple threads.
+/// Reports are written as one "Stage MeanTime_us Count" line per stage so runs of
+/// different builds can be compared against each other.
+/// </summary>
+class FStageTimings
+{
+public:
+	/// <summary>
+	/// Adds a measured time to a stage.
+	/// </summary>
+	/// <param name="stage">The stage</param>
+	/// <param name="cycles">The measured time in FPlatformTime cycles</param>
+	/// <param name="count">The number of work items measured</param>
+	inline void Add(EPerformanceStage stage,
+					uint64 cycles,
+					uint32 count = 1)
+	{
+		mCycles[static_cast<size_t>(stage)].fetch_add(cycles, std::memory_order_relaxed);
+		mCounts[static_cast<size_t>(stage)].fetch_add(count, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Retrieves the number of work items measured for a stage.
+	/// </summary>
+	/// <param name="stage">The stage</param>
+	/// <returns>The number of work items</returns>
+	inline uint64 GetCount(EPerformanceStage stage) const { return mCounts[static_cast<size_t>(stage)].load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Retrieves the mean time per work item of a stage.
+	/// </summary>
+	/// <param name="stage">The stage</param>
+	/// <returns>The mean time in microseconds, 0 if nothing was measured</returns>
+	double GetMeanTime_us(EPerformanceStage stage) const;
+
+	/// <summary>
+	/// Retrieves the display name of a stage.
+	/// </summary>
+	/// <param name="stage">The stage</param>
+	/// <returns>The name</returns>
+	static const TCHAR* GetStageName(EPerformanceStage stage);
+public:
+	/// <summary>
+	/// Logs the mean time and count of every measured stage.
+	/// </summary>
+	void Log() const;
+
+	/// <summary>
+	/// Writes the stage report.
+	/// </summary>
+	/// <param name="path">The report file</param>
+	/// <returns>True if written</returns>
+	bool Save(const FString& path) const;
+
+	/// <summary>
+	/// Compares the mean stage times against a baseline report, logging every stage
+	/// that got slower by more than the tolerance.
+	/// </summary>
+	/// <param name="path">The baseline report file</param>
+	/// <param name="tolerance">The allowed slowdown, 0.1 for 10%</param>
+	/// <returns>True if no stage regressed</returns>
+	bool CompareToBaseline(const FString& path,
+						   float tolerance) const;
+private:
+	std::array<std::atomic<uint64>, static_cast<size_t>(EPerformanceStage::COUNT)> mCycles {};
+	std::array<std::atomic<uint64>, static_cast<size_t>(EPerformanceStage::COUNT)> mCounts {};
+};
+
+
+/// <summary>
+/// Adds the time until it goes out of scope to a stage, does nothing without timings.
+/// </summary>
+class FScopedStageTimer
+{
+public:
+	/// <summary>
+	/// Constructor starting the measurement.
+	/// </summary>
+	/// <param name="pTimings">The timings to add to, may be null</param>
+	/// <param name="stage">The stage</param>
+	/// <param name="count">The number of work items measured</param>
+	FScopedStageTimer(FStageTimings* pTimings,
+					  EPerformanceStage stage,
+					  uint32 count = 1)
+		: mpTimings(pTimings),
+		mStage(stage),
+		mCount(count),
+		mStartCycles(pTimings ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	/// <summary>
+	/// Destructor adding the measured time.
+	/// </summary>
+	~FScopedStageTimer()
+	{
+		if (mpTimings)
+			mpTimings->Add(mStage, FPlatformTime::Cycles64() - mStartCycles, mCount);
+	}
+
+	FScopedStageTimer(const FScopedStageTimer&) = delete;
+	FScopedStageTimer& operator=(const FScopedStageTimer&) = delete;
+private:
+	FStageTimings* mpTimings;
+	EPerformanceStage mStage;
+	uint32 mCount;
+	uint64 mStartCycles;
+};
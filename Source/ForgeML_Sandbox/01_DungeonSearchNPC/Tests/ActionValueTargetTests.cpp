@@ -0,0 +1,97 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "../CompactTransition.h"
+
+#include <vector>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// The discount of the test transitions.
+static const float TestGamma = 0.9f;
+
+// The estimate every action starts out with, kept by the actions that were not taken.
+static const float TestEstimate = 0.25f;
+
+/// <summary>
+/// Creates a test transition.
+/// </summary>
+/// <param name="direction">The taken action</param>
+/// <param name="reward">The n-step return</param>
+/// <param name="event">The transition event</param>
+/// <param name="returnSteps">The rewards in the return, 0 if it ran to the end of the episode</param>
+/// <returns>The transition</returns>
+static FCompactTransition MakeTransition(EMoveDirection direction,
+										 float reward,
+										 ETransitionEvent event,
+										 uint8 returnSteps)
+{
+	FCompactTransition info;
+	info.mDirection = direction;
+	info.mDirection_f = static_cast<float>(direction);
+	info.mReward = reward;
+	info.mEvent = event;
+	info.mReturnSteps = returnSteps;
+	return info;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FActionValueTargetTest,
+								 "ForgeML.DungeonSearchNPC.ActionValueHead.NStepTargets",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FActionValueTargetTest::RunTest(const FString& parameters)
+{
+	const size_t numActions = static_cast<size_t>(EMoveDirection::COUNT);
+
+	const std::vector<FCompactTransition> trainingData =
+	{
+		MakeTransition(EMoveDirection::Right, 1.5f, ETransitionEvent::Decision, 3),
+		MakeTransition(EMoveDirection::Forward, -1.0f, ETransitionEvent::Death, 2),
+		MakeTransition(EMoveDirection::Left, 0.7f, ETransitionEvent::Decision, 0),
+		MakeTransition(EMoveDirection::Backward, -0.1f, ETransitionEvent::Timeout, 1),
+	};
+
+	// Only returns that stop short of the episode end are completed with the next state value.
+	std::vector<size_t> bootstrapIndices;
+	for (size_t i = 0; i < trainingData.size(); ++i)
+	{
+		if (trainingData[i].BootstrapsFromNextState())
+			bootstrapIndices.push_back(i);
+	}
+
+	TestEqual(TEXT("Bootstrapped transitions"), static_cast<int32>(bootstrapIndices.size()), 2);
+	TestTrue(TEXT("Windowed return bootstraps"), bootstrapIndices.size() == 2 && bootstrapIndices[0] == 0 && bootstrapIndices[1] == 3);
+
+	const std::vector<float> nextValues =
+	{
+		0.1f, 2.0f, 0.5f, -1.0f, 0.3f,
+		-0.5f, -0.2f, -0.4f, -0.3f, -0.6f,
+	};
+
+	std::vector<float> targets(trainingData.size() * numActions, TestEstimate);
+	WriteActionValueTargets(trainingData, bootstrapIndices, nextValues, TestGamma, targets);
+
+	const float expected[] =
+	{
+		1.5f + TestGamma * TestGamma * TestGamma * 2.0f,
+		-1.0f,
+		0.7f,
+		-0.1f + TestGamma * -0.2f,
+	};
+
+	for (size_t i = 0; i < trainingData.size(); ++i)
+	{
+		for (size_t action = 0; action < numActions; ++action)
+		{
+			const bool taken = action == static_cast<size_t>(trainingData[i].mDirection);
+			TestEqual(FString::Printf(TEXT("Target of transition %d, action %d"), static_cast<int32>(i), static_cast<int32>(action)),
+					  targets[i * numActions + action],
+					  taken ? expected[i] : TestEstimate,
+					  1e-5f);
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "CoreMinimal.h"
+#include "Components/StaticMeshComponent.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#include "../DungeonObjectChannels.h"
+#include "../NPCDefines.h"
+
+#include <vector>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Hit components classified per timed pass, cycling through every tag combination.
+static const int32 NumTestComponents = 64;
+
+// Timed classifications per method, roughly a second of 16 rays for a few hundred agents.
+static const int32 NumTimedClassifications = 1 << 20;
+
+/// <summary>
+/// The tag based classification perception rays used before the object channels.
+/// </summary>
+/// <param name="component">The hit component</param>
+/// <returns>The ray hit type</returns>
+static float GetTaggedHitType(const UPrimitiveComponent* component)
+{
+	float type = RayHitType::Wall;
+
+	if (component->ComponentHasTag("Hazard"))
+		type = RayHitType::Hazard;
+
+	if (component->ComponentHasTag("Coin"))
+		type = RayHitType::Coin;
+
+	if (component->ComponentHasTag("Treasure"))
+		type = RayHitType::Treasure;
+
+	return type;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDungeonObjectChannelTest,
+								 "ForgeML.DungeonSearchNPC.ObjectChannels.Classification",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDungeonObjectChannelTest::RunTest(const FString& parameters)
+{
+	static const FName DungeonTags[] = { "Hazard", "Coin", "Treasure" };
+
+	// Every combination of the dungeon tags, behind unrelated tags as level components carry them.
+	std::vector<UStaticMeshComponent*> components;
+	for (int32 i = 0; i < NumTestComponents; ++i)
+	{
+		UStaticMeshComponent* component = NewObject<UStaticMeshComponent>(GetTransientPackage());
+		component->ComponentTags.Add("Dungeon");
+		component->ComponentTags.Add("Level");
+
+		for (int32 tag = 0; tag < static_cast<int32>(UE_ARRAY_COUNT(DungeonTags)); ++tag)
+		{
+			if (i & (1 << tag))
+				component->ComponentTags.Add(DungeonTags[tag]);
+		}
+
+		component->SetCollisionObjectType(ECC_WorldStatic);
+		components.push_back(component);
+	}
+
+	std::vector<float> taggedTypes;
+	for (UStaticMeshComponent* component : components)
+	{
+		taggedTypes.push_back(GetTaggedHitType(component));
+		AssignDungeonObjectChannel(component);
+	}
+
+	for (int32 i = 0; i < NumTestComponents; ++i)
+		TestEqual(FString::Printf(TEXT("Hit type of component %d"), i), GetDungeonObjectHitType(components[i]), taggedTypes[i]);
+
+	TestEqual(TEXT("Hit type without a component"), GetDungeonObjectHitType(nullptr), RayHitType::Wall);
+
+	// The per ray cost, reported rather than asserted since it depends on the machine.
+	float checksum = 0;
+
+	const double tagStart_s = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumTimedClassifications; ++i)
+		checksum += GetTaggedHitType(components[i % NumTestComponents]);
+	const double tagTime_s = FPlatformTime::Seconds() - tagStart_s;
+
+	const double channelStart_s = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumTimedClassifications; ++i)
+		checksum -= GetDungeonObjectHitType(components[i % NumTestComponents]);
+	const double channelTime_s = FPlatformTime::Seconds() - channelStart_s;
+
+	AddInfo(FString::Printf(TEXT("Ray Hit Classification: %.2fns by tags, %.2fns by object channel (%.1fx)."),
+							tagTime_s * 1e9 / NumTimedClassifications,
+							channelTime_s * 1e9 / NumTimedClassifications,
+							channelTime_s > 0 ? tagTime_s / channelTime_s : 0.0));
+
+	TestEqual(TEXT("Both classifications sum to the same types"), checksum, 0.0f);
+
+	for (UStaticMeshComponent* component : components)
+		component->MarkAsGarbage();
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/AutomationTest.h"
+
+#include "../ExperienceChannel.h"
+
+#include <atomic>
+#include <vector>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Producers sharing the channel with the learner, as separate sandbox processes would.
+static const int32 NumTestProducers = 4;
+
+// Transitions streamed by each producer, several laps of the ring.
+static const int32 NumTransitionsPerProducer = 20000;
+
+// Ring slots, small so the producers regularly find it full.
+static const int32 TestChannelCapacity = 1024;
+
+// Time after which the learner gives up waiting for the producers.
+static const double TestTimeout_s = 30.0;
+
+// Separately mapped producers of the throughput test, as two producer processes map the region.
+static const int32 NumMappedProducers = 2;
+
+// Transitions each mapped producer pushes without waiting, as the sandbox producers do.
+static const int32 NumThroughputTransitions = 1 << 20;
+
+// Ring slots of the throughput test, the default channel capacity.
+static const int32 ThroughputChannelCapacity = 65536;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FExperienceChannelStreamTest,
+								 "ForgeML.DungeonSearchNPC.ExperienceChannel.ProducersToLearner",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FExperienceChannelStreamTest::RunTest(const FString& parameters)
+{
+	const FString name = FString::Printf(TEXT("ForgeMLChannelTest%u"), FPlatformProcess::GetCurrentProcessId());
+
+	std::unique_ptr<FExperienceChannel> learner = FExperienceChannel::Create(name, TestChannelCapacity);
+	if (!TestNotNull(TEXT("Learner channel"), learner.get()))
+		return false;
+
+	std::vector<std::unique_ptr<FExperienceChannel>> producers;
+	for (int32 i = 0; i < NumTestProducers; ++i)
+	{
+		producers.push_back(FExperienceChannel::Open(name, TestChannelCapacity));
+		if (!TestNotNull(TEXT("Producer channel"), producers.back().get()))
+			return false;
+	}
+
+	TestEqual(TEXT("Registered producers"), learner->GetNumProducers(), NumTestProducers);
+
+	// Each producer numbers its transitions through the reward, retrying whenever the ring is full.
+	FGraphEventArray producerTasks;
+	for (const std::unique_ptr<FExperienceChannel>& producer : producers)
+	{
+		FExperienceChannel* pProducer = producer.get();
+		producerTasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([pProducer]()
+		{
+			TrainingInfo info;
+			info.mAgentId = 0;
+
+			const double start_s = FPlatformTime::Seconds();
+			for (int32 i = 0; i < NumTransitionsPerProducer && FPlatformTime::Seconds() - start_s < TestTimeout_s;)
+			{
+				info.mReward = static_cast<float>(i);
+				if (pProducer->Push(info))
+					++i;
+				else
+					FPlatformProcess::Yield();
+			}
+
+		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask));
+	}
+
+	std::vector<int32> numReceived(NumTestProducers, 0);
+	bool inOrder = true;
+	bool validProducer = true;
+
+	std::vector<TrainingInfo> transitions;
+	int32 total = 0;
+
+	const double start_s = FPlatformTime::Seconds();
+	while (total < NumTestProducers * NumTransitionsPerProducer && FPlatformTime::Seconds() - start_s < TestTimeout_s)
+	{
+		transitions.clear();
+		if (learner->Pop(transitions, TestChannelCapacity) == 0)
+		{
+			FPlatformProcess::Yield();
+			continue;
+		}
+
+		for (const TrainingInfo& info : transitions)
+		{
+			const int32 producer = info.mAgentId / ProducerAgentIdStride;
+			if (producer < 0 || producer >= NumTestProducers)
+			{
+				validProducer = false;
+				continue;
+			}
+
+			// A single producer's transitions leave the ring in the order they were pushed.
+			inOrder &= static_cast<int32>(info.mReward) == numReceived[producer];
+			numReceived[producer]++;
+		}
+
+		total += static_cast<int32>(transitions.size());
+	}
+
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(producerTasks);
+
+	TestTrue(TEXT("Transitions carry their producer's agent id offset"), validProducer);
+	TestTrue(TEXT("Transitions of each producer arrive in order"), inOrder);
+	for (int32 i = 0; i < NumTestProducers; ++i)
+		TestEqual(FString::Printf(TEXT("Transitions received from producer %d"), i), numReceived[i], NumTransitionsPerProducer);
+
+	// A published model reaches every producer, a save in progress is visible to them.
+	learner->BeginModelSave();
+	for (const std::unique_ptr<FExperienceChannel>& producer : producers)
+		TestTrue(TEXT("Save in progress seen by the producer"), producer->GetModelSaveSequence() % 2 != 0);
+
+	learner->EndModelSave();
+	learner->PublishModel(7);
+
+	for (const std::unique_ptr<FExperienceChannel>& producer : producers)
+	{
+		TestEqual(TEXT("Published model version seen by the producer"), producer->GetModelVersion(), 7u);
+		TestEqual(TEXT("Completed save seen by the producer"), producer->GetModelSaveSequence(), 2u);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FExperienceChannelThroughputTest,
+								 "ForgeML.DungeonSearchNPC.ExperienceChannel.MappedProducerThroughput",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FExperienceChannelThroughputTest::RunTest(const FString& parameters)
+{
+	const FString name = FString::Printf(TEXT("ForgeMLChannelThroughput%u"), FPlatformProcess::GetCurrentProcessId());
+
+	std::unique_ptr<FExperienceChannel> learner = FExperienceChannel::Create(name, ThroughputChannelCapacity);
+	if (!TestNotNull(TEXT("Learner channel"), learner.get()))
+		return false;
+
+	// Every handle maps the named region on its own, the producers share nothing but the mapping.
+	std::vector<std::unique_ptr<FExperienceChannel>> producers;
+	for (int32 i = 0; i < NumMappedProducers; ++i)
+	{
+		producers.push_back(FExperienceChannel::Open(name, ThroughputChannelCapacity));
+		if (!TestNotNull(TEXT("Mapped producer channel"), producers.back().get()))
+			return false;
+	}
+
+	// Producers never wait for the learner, a full ring drops the transition.
+	std::atomic<int32> numRunning = NumMappedProducers;
+	FGraphEventArray producerTasks;
+	for (const std::unique_ptr<FExperienceChannel>& producer : producers)
+	{
+		FExperienceChannel* pProducer = producer.get();
+		producerTasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([pProducer, &numRunning]()
+		{
+			TrainingInfo info;
+			info.mAgentId = 0;
+
+			for (int32 i = 0; i < NumThroughputTransitions; ++i)
+			{
+				info.mReward = static_cast<float>(i);
+				pProducer->Push(info);
+			}
+
+			numRunning--;
+
+		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask));
+	}
+
+	std::vector<int32> lastReceived(NumMappedProducers, -1);
+	bool inOrder = true;
+
+	std::vector<TrainingInfo> transitions;
+	int64 numReceived = 0;
+
+	const double start_s = FPlatformTime::Seconds();
+	for (;;)
+	{
+		// Checked before popping, so everything pushed by finished producers is drained.
+		const bool producersDone = numRunning.load() == 0;
+
+		transitions.clear();
+		const int32 count = learner->Pop(transitions, ThroughputChannelCapacity);
+
+		for (const TrainingInfo& info : transitions)
+		{
+			const int32 producer = FMath::Clamp(info.mAgentId / ProducerAgentIdStride, 0, NumMappedProducers - 1);
+			const int32 index = static_cast<int32>(info.mReward);
+
+			// Drops leave gaps, but a producer's transitions never arrive out of order.
+			inOrder &= index > lastReceived[producer];
+			lastReceived[producer] = index;
+		}
+		numReceived += count;
+
+		if ((producersDone && count == 0) || FPlatformTime::Seconds() - start_s > TestTimeout_s)
+			break;
+	}
+	const double elapsed_s = FMath::Max(FPlatformTime::Seconds() - start_s, UE_DOUBLE_SMALL_NUMBER);
+
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(producerTasks);
+
+	const int64 numPushed = static_cast<int64>(NumMappedProducers) * NumThroughputTransitions;
+	const int64 numDropped = static_cast<int64>(learner->GetNumDropped());
+
+	AddInfo(FString::Printf(TEXT("Mapped Producers: %d x %d transitions in %.2fs, %.2fM received/s, %lld dropped (%.1f%%)."),
+							NumMappedProducers,
+							NumThroughputTransitions,
+							elapsed_s,
+							numReceived / elapsed_s / 1000000.0,
+							numDropped,
+							numDropped * 100.0 / numPushed));
+
+	TestTrue(TEXT("Transitions of each producer arrive in order"), inOrder);
+	TestEqual(TEXT("Every pushed transition is either received or counted as dropped"), numReceived + numDropped, numPushed);
+
+	return true;
+}
+
+#endif
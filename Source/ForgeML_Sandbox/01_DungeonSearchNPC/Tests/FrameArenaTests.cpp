@@ -0,0 +1,216 @@
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/AutomationTest.h"
+
+#include "../FrameArena.h"
+#include "../NPCDefines.h"
+
+#include <atomic>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Frames simulated once the arena is warmed up.
+static const int32 NumSteadyFrames = 64;
+
+// Decisions requested per simulated frame.
+static const int32 NumDecisionsPerFrame = 128;
+
+/// <summary>
+/// Forwards to the engine allocator and counts the allocations made by a single thread,
+/// so allocations of other engine threads running meanwhile are not attributed to the test.
+/// </summary>
+class FCountingMalloc final : public FMalloc
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FCountingMalloc instance.
+	/// </summary>
+	/// <param name="pInner">The allocator every call is forwarded to</param>
+	explicit FCountingMalloc(FMalloc* pInner)
+		: mpInner(pInner),
+		mThreadId(FPlatformTLS::GetCurrentThreadId())
+	{
+	}
+public:
+	virtual void* Malloc(SIZE_T size,
+						 uint32 alignment) override
+	{
+		Count();
+		return mpInner->Malloc(size, alignment);
+	}
+
+	virtual void* TryMalloc(SIZE_T size,
+							uint32 alignment) override
+	{
+		Count();
+		return mpInner->TryMalloc(size, alignment);
+	}
+
+	virtual void* Realloc(void* pOriginal,
+						  SIZE_T size,
+						  uint32 alignment) override
+	{
+		Count();
+		return mpInner->Realloc(pOriginal, size, alignment);
+	}
+
+	virtual void* TryRealloc(void* pOriginal,
+							 SIZE_T size,
+							 uint32 alignment) override
+	{
+		Count();
+		return mpInner->TryRealloc(pOriginal, size, alignment);
+	}
+
+	virtual void Free(void* pOriginal) override
+	{
+		mpInner->Free(pOriginal);
+	}
+
+	virtual bool GetAllocationSize(void* pOriginal,
+								   SIZE_T& outSize) override
+	{
+		return mpInner->GetAllocationSize(pOriginal, outSize);
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return mpInner->IsInternallyThreadSafe();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return TEXT("CountingMalloc");
+	}
+public:
+	/// <summary>
+	/// Retrieves the number of allocations the counted thread made so far.
+	/// </summary>
+	/// <returns>The number of allocations</returns>
+	inline uint64 GetNumAllocations() const { return mNumAllocations.load(); }
+private:
+	/// <summary>
+	/// Counts an allocation when it was made by the counted thread.
+	/// </summary>
+	void Count()
+	{
+		if (FPlatformTLS::GetCurrentThreadId() == mThreadId)
+			mNumAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+private:
+	FMalloc* mpInner = nullptr;
+	uint32 mThreadId = 0;
+
+	std::atomic<uint64> mNumAllocations = 0;
+};
+
+/// <summary>
+/// Installs a FCountingMalloc as the engine allocator for its lifetime.
+/// </summary>
+class FScopedAllocationCounter
+{
+public:
+	FScopedAllocationCounter()
+		: mpPrevious(GMalloc),
+		mCounter(GMalloc)
+	{
+		GMalloc = &mCounter;
+	}
+
+	~FScopedAllocationCounter()
+	{
+		GMalloc = mpPrevious;
+	}
+
+	FScopedAllocationCounter(const FScopedAllocationCounter&) = delete;
+	FScopedAllocationCounter& operator=(const FScopedAllocationCounter&) = delete;
+public:
+	/// <summary>
+	/// Retrieves the number of allocations the installing thread made so far.
+	/// </summary>
+	/// <returns>The number of allocations</returns>
+	inline uint64 GetNumAllocations() const { return mCounter.GetNumAllocations(); }
+private:
+	FMalloc* mpPrevious = nullptr;
+	FCountingMalloc mCounter;
+};
+
+/// <summary>
+/// Simulates the decision inputs of one frame the way learning NPCs request them.
+/// </summary>
+/// <param name="arena">The frame arena</param>
+/// <param name="state">The observed state</param>
+/// <returns>The sum of the written inputs, so the writes are not optimized away</returns>
+static float SimulateDecisionFrame(FFrameArena& arena,
+								   const TrainingStateInfo& state)
+{
+	float checksum = 0;
+	for (int32 decision = 0; decision < NumDecisionsPerFrame; ++decision)
+	{
+		TArrayView<float> stateInfo = arena.AllocateArray<float>(StateSize);
+		WriteStateInputs(state, stateInfo);
+
+		checksum += stateInfo[decision % StateSize];
+	}
+
+	arena.Reset();
+	return checksum;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFrameArenaSteadyStateTest,
+								 "ForgeML.DungeonSearchNPC.FrameArena.SteadyStateAllocations",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FFrameArenaSteadyStateTest::RunTest(const FString& parameters)
+{
+	TrainingStateInfo state;
+	state.mRayCollisionDistances.fill(0.5f);
+	state.mTreasureDistance = 1.0f;
+
+	// Small enough that the first frame overflows and the blocks are merged on reset.
+	FFrameArena arena(256);
+	float checksum = SimulateDecisionFrame(arena, state);
+
+	const uint32 numWarmUpBlocks = arena.GetNumHeapAllocations();
+	TestTrue(TEXT("The first frame overflows the initial block"), numWarmUpBlocks > 1);
+
+	uint64 numAllocations = 0;
+	{
+		const FScopedAllocationCounter counter;
+
+		for (int32 frame = 0; frame < NumSteadyFrames; ++frame)
+			checksum += SimulateDecisionFrame(arena, state);
+
+		numAllocations = counter.GetNumAllocations();
+	}
+
+	TestEqual(TEXT("Heap allocations of warmed up decision frames"), numAllocations, static_cast<uint64>(0));
+	TestEqual(TEXT("Arena blocks added after warm up"), arena.GetNumHeapAllocations(), numWarmUpBlocks);
+	TestTrue(TEXT("Decision inputs are written"), checksum > 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFrameArenaCounterTest,
+								 "ForgeML.DungeonSearchNPC.FrameArena.AllocationCounter",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FFrameArenaCounterTest::RunTest(const FString& parameters)
+{
+	// The counter must see a heap allocation, otherwise a zero count above proves nothing.
+	uint64 numAllocations = 0;
+	{
+		const FScopedAllocationCounter counter;
+
+		void* pData = FMemory::Malloc(64);
+		FMemory::Free(pData);
+
+		numAllocations = counter.GetNumAllocations();
+	}
+
+	TestEqual(TEXT("Counted heap allocations"), numAllocations, static_cast<uint64>(1));
+	return true;
+}
+
+#endif
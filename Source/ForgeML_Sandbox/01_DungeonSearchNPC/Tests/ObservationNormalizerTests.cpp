@@ -0,0 +1,107 @@
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#include "../ObservationNormalizer.h"
+
+#include <algorithm>
+#include <vector>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// States the statistics are gathered from.
+static const int32 NumTestStates = 1000;
+
+// The range normalized inputs are clipped to.
+static const float TestClip = 5.0f;
+
+/// <summary>
+/// Creates states whose inputs each have their own mean and spread, the last input never varies.
+/// </summary>
+/// <returns>The flattened states</returns>
+static std::vector<float> MakeTestStates()
+{
+	FRandomStream random(7);
+
+	std::vector<float> states(static_cast<size_t>(NumTestStates) * StateSize);
+	for (int32 s = 0; s < NumTestStates; ++s)
+	{
+		for (int32 i = 0; i < StateSize; ++i)
+		{
+			const float value = i + 1 < StateSize ? 100.0f * i + random.FRandRange(-1.0f, 1.0f) * (i + 1) : 3.0f;
+			states[static_cast<size_t>(s) * StateSize + i] = value;
+		}
+	}
+	return states;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FObservationNormalizerTest,
+								 "ForgeML.DungeonSearchNPC.ObservationNormalizer.Statistics",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FObservationNormalizerTest::RunTest(const FString& parameters)
+{
+	const std::vector<float> states = MakeTestStates();
+
+	// Without statistics the states pass through unchanged.
+	FObservationNormalizer whole(TestClip);
+
+	std::vector<float> passThrough(states.begin(), states.begin() + StateSize);
+	whole.Normalize(passThrough.data(), 1);
+	TestTrue(TEXT("States pass through before the first update"), std::equal(passThrough.begin(), passThrough.end(), states.begin()));
+
+	whole.Update(states.data(), NumTestStates);
+	TestEqual(TEXT("Gathered states"), static_cast<int32>(whole.GetCount()), NumTestStates);
+
+	// Merging uneven batches gives the statistics of the whole batch.
+	FObservationNormalizer merged(TestClip);
+	const int32 batchSizes[] = { 1, 37, 462, NumTestStates - 500 };
+
+	int32 offset = 0;
+	for (int32 batchSize : batchSizes)
+	{
+		merged.Update(states.data() + static_cast<size_t>(offset) * StateSize, batchSize);
+		offset += batchSize;
+	}
+
+	std::vector<float> normalized = states;
+	whole.Normalize(normalized.data(), NumTestStates);
+
+	std::vector<float> mergedNormalized = states;
+	merged.Normalize(mergedNormalized.data(), NumTestStates);
+
+	float maxDifference = 0;
+	for (size_t i = 0; i < normalized.size(); ++i)
+		maxDifference = FMath::Max(maxDifference, FMath::Abs(normalized[i] - mergedNormalized[i]));
+
+	TestTrue(FString::Printf(TEXT("Merged batches match the whole batch (%g apart)"), maxDifference), maxDifference < 1e-3f);
+
+	// Every varying input reaches the model with zero mean and unit variance, the constant one at zero.
+	for (int32 i = 0; i < StateSize; ++i)
+	{
+		double sum = 0;
+		double sumSquares = 0;
+		for (int32 s = 0; s < NumTestStates; ++s)
+		{
+			const double value = normalized[static_cast<size_t>(s) * StateSize + i];
+			sum += value;
+			sumSquares += value * value;
+		}
+
+		const double mean = sum / NumTestStates;
+		const double variance = sumSquares / NumTestStates - mean * mean;
+
+		TestEqual(FString::Printf(TEXT("Mean of input %d"), i), mean, 0.0, 1e-3);
+		TestEqual(FString::Printf(TEXT("Variance of input %d"), i), variance, i + 1 < StateSize ? 1.0 : 0.0, 1e-2);
+	}
+
+	// Outliers are clipped to the configured range.
+	std::vector<float> outlier(StateSize, 1e6f);
+	whole.Normalize(outlier.data(), 1);
+	for (int32 i = 0; i + 1 < StateSize; ++i)
+		TestEqual(FString::Printf(TEXT("Clipped input %d"), i), outlier[i], TestClip);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "TrajectoryBuffer.h"
+
+FTrajectoryBuffer::FTrajectoryBuffer(float gamma,
+									 int32 returnSteps,
+									 int32 maxLength)
+	: mGamma(gamma),
+	mReturnSteps(FMath::Clamp(returnSteps, 0, static_cast<int32>(MAX_uint8))),
+	mMaxLength(FMath::Clamp(maxLength, 1, static_cast<int32>(MAX_uint8)))
+{
+}
+
+void FTrajectoryBuffer::Add(const TrainingInfo& info,
+							std::vector<TrainingInfo>& outSegments)
+{
+	// Transitions without an agent cannot be ordered, they pass through as one-step returns.
+	if (info.mAgentId < 0)
+	{
+		outSegments.push_back(info);
+		return;
+	}
+
+	if (static_cast<size_t>(info.mAgentId) >= mTrajectories.size())
+		mTrajectories.resize(info.mAgentId + 1);
+
+	std::vector<TrainingInfo>& trajectory = mTrajectories[info.mAgentId];
+	trajectory.push_back(info);
+
+	if (info.IsTerminal() || info.mEvent == ETransitionEvent::Timeout || static_cast<int32>(trajectory.size()) >= mMaxLength)
+		Close(info.mAgentId, outSegments);
+}
+
+void FTrajectoryBuffer::Close(int32 agentId,
+							  std::vector<TrainingInfo>& outSegments)
+{
+	if (agentId < 0 || static_cast<size_t>(agentId) >= mTrajectories.size())
+		return;
+
+	std::vector<TrainingInfo>& trajectory = mTrajectories[agentId];
+	if (trajectory.empty())
+		return;
+
+	ComputeReturns(trajectory);
+
+	outSegments.insert(outSegments.end(), trajectory.begin(), trajectory.end());
+	trajectory.clear();
+}
+
+void FTrajectoryBuffer::CloseAll(std::vector<TrainingInfo>& outSegments)
+{
+	for (int32 agentId = 0; agentId < static_cast<int32>(mTrajectories.size()); ++agentId)
+		Close(agentId, outSegments);
+}
+
+void FTrajectoryBuffer::ComputeReturns(std::vector<TrainingInfo>& trajectory)
+{
+	const int32 length = static_cast<int32>(trajectory.size());
+	const int32 steps = mReturnSteps > 0 ? FMath::Min(mReturnSteps, length) : length;
+	const bool terminated = trajectory.back().IsTerminal();
+
+	mRewards.resize(length);
+	for (int32 t = 0; t < length; ++t)
+		mRewards[t] = trajectory[t].mReward;
+
+	// Forward, so each window end still holds its own next state when it is read.
+	for (int32 t = 0; t < length; ++t)
+	{
+		TrainingInfo& info = trajectory[t];
+		const int32 windowEnd = FMath::Min(t + steps, length);
+
+		if (terminated && windowEnd == length)
+		{
+			info.mReturnSteps = 0;
+		}
+		else
+		{
+			// Bootstrap from the state following the last reward of the window.
+			info.mReturnSteps = static_cast<uint8>(windowEnd - t);
+			info.mNextState = trajectory[windowEnd - 1].mNextState;
+		}
+	}
+
+	mReturns.assign(length, 0.0f);
+	if (mReturnSteps > 0)
+	{
+		// G(t) = sum of gamma^k * r(t + k) over the window, accumulated one discount at a time
+		// so the inner loop runs over contiguous rewards without a loop carried dependency.
+		float discount = 1.0f;
+		for (int32 k = 0; k < steps; ++k)
+		{
+			float* returns = mReturns.data();
+			const float* rewards = mRewards.data() + k;
+
+			const int32 count = length - k;
+			for (int32 t = 0; t < count; ++t)
+				returns[t] += discount * rewards[t];
+
+			discount *= mGamma;
+		}
+	}
+	else
+	{
+		// G(t) = r(t) + gamma * G(t + 1), the full episode return is a recurrence and stays a backward pass.
+		float nextReturn = 0;
+		for (int32 t = length - 1; t >= 0; --t)
+		{
+			nextReturn = mRewards[t] + mGamma * nextReturn;
+			mReturns[t] = nextReturn;
+		}
+	}
+
+	for (int32 t = 0; t < length; ++t)
+		trajectory[t].mReward = mReturns[t];
+}
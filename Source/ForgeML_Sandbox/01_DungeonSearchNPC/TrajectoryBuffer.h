@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NPCDefines.h"
+
+#include <vector>
+
+
+/// <summary>
+/// Collects the transitions of each agent in order and emits them once the
+/// trajectory closes, with every reward replaced by its discounted n-step return.
+/// </summary>
+class FTrajectoryBuffer
+{
+public:
+	/// <summary>
+	/// Constructor initializing a FTrajectoryBuffer instance.
+	/// </summary>
+	/// <param name="gamma">The discount factor</param>
+	/// <param name="returnSteps">The number of rewards per return, 0 for the full episode return</param>
+	/// <param name="maxLength">The length at which an open trajectory is closed and bootstrapped</param>
+	FTrajectoryBuffer(float gamma,
+					  int32 returnSteps,
+					  int32 maxLength);
+public:
+	/// <summary>
+	/// Appends a transition to its agent's trajectory, closing the trajectory on
+	/// terminal or timed out transitions or when it reaches the maximum length.
+	/// </summary>
+	/// <param name="info">The transition, mAgentId selects the trajectory</param>
+	/// <param name="outSegments">The return annotated transitions of closed trajectories</param>
+	void Add(const TrainingInfo& info,
+			 std::vector<TrainingInfo>& outSegments);
+
+	/// <summary>
+	/// Closes an agent's open trajectory, bootstrapping the returns from its last state.
+	/// </summary>
+	/// <param name="agentId">The agent id</param>
+	/// <param name="outSegments">The return annotated transitions</param>
+	void Close(int32 agentId,
+			   std::vector<TrainingInfo>& outSegments);
+
+	/// <summary>
+	/// Closes every open trajectory.
+	/// </summary>
+	/// <param name="outSegments">The return annotated transitions</param>
+	void CloseAll(std::vector<TrainingInfo>& outSegments);
+private:
+	/// <summary>
+	/// Replaces the rewards of a trajectory with their n-step returns and points each
+	/// transition at the state its return bootstraps from.
+	/// </summary>
+	/// <param name="trajectory">The trajectory</param>
+	void ComputeReturns(std::vector<TrainingInfo>& trajectory);
+private:
+	float mGamma = 0.95f;
+	int32 mReturnSteps = 0;
+	int32 mMaxLength = 256;
+
+	std::vector<std::vector<TrainingInfo>> mTrajectories;
+	std::vector<float> mRewards;
+	std::vector<float> mReturns;
+};